@@ -0,0 +1,279 @@
+#include "BlockCompression.h"
+#include "../VulkanCourseApp/Ktx2.h"
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	const uint32_t BC7_WEIGHTS[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Ends of the block's principal axis, a few power iterations on the covariance are plenty for 16 texels.
+	void fitAxis(const uint8_t *block, uint32_t channels, float *low, float *high) {
+		float mean[4]{};
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			for (uint32_t c{ 0 }; c < channels; c++) {
+				mean[c] += block[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float cov[4][4]{};
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			for (uint32_t a{ 0 }; a < channels; a++) {
+				for (uint32_t b{ 0 }; b < channels; b++) {
+					cov[a][b] += (block[i * 4 + a] - mean[a]) * (block[i * 4 + b] - mean[b]);
+				}
+			}
+		}
+
+		float axis[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+		for (int iteration{ 0 }; iteration < 8; iteration++) {
+			float next[4]{};
+			float length{ 0.0f };
+			for (uint32_t a{ 0 }; a < channels; a++) {
+				for (uint32_t b{ 0 }; b < channels; b++) {
+					next[a] += cov[a][b] * axis[b];
+				}
+				length = std::max(length, std::abs(next[a]));
+			}
+			// Flat block, any axis does.
+			if (length == 0.0f) {
+				break;
+			}
+			for (uint32_t c{ 0 }; c < channels; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minDot{ 0.0f };
+		float maxDot{ 0.0f };
+		float axisLength{ 0.0f };
+		for (uint32_t c{ 0 }; c < channels; c++) {
+			axisLength += axis[c] * axis[c];
+		}
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			float dot{ 0.0f };
+			for (uint32_t c{ 0 }; c < channels; c++) {
+				dot += (block[i * 4 + c] - mean[c]) * axis[c];
+			}
+			minDot = std::min(minDot, dot / axisLength);
+			maxDot = std::max(maxDot, dot / axisLength);
+		}
+		for (uint32_t c{ 0 }; c < channels; c++) {
+			low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minDot));
+			high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxDot));
+		}
+	}
+
+	uint32_t nearestIndex(const uint8_t *texel, const int palette[][4], uint32_t paletteSize, uint32_t channels) {
+		uint32_t best{ 0 };
+		int bestError{ INT_MAX };
+		for (uint32_t p{ 0 }; p < paletteSize; p++) {
+			int error{ 0 };
+			for (uint32_t c{ 0 }; c < channels; c++) {
+				const int diff{ texel[c] - palette[p][c] };
+				error += diff * diff;
+			}
+			if (error < bestError) {
+				bestError = error;
+				best = p;
+			}
+		}
+		return best;
+	}
+
+	uint16_t packRGB565(const float *color) {
+		const uint32_t r{ static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f) };
+		const uint32_t g{ static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f) };
+		const uint32_t b{ static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f) };
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(uint16_t packed, int *color) {
+		color[0] = ((packed >> 11) & 31) * 255 / 31;
+		color[1] = ((packed >> 5) & 63) * 255 / 63;
+		color[2] = (packed & 31) * 255 / 31;
+		color[3] = 255;
+	}
+
+	// Little endian bit stream over a 16 byte BC7 block.
+	void writeBits(uint8_t *out, uint32_t &position, uint32_t value, uint32_t count) {
+		for (uint32_t i{ 0 }; i < count; i++, position++) {
+			if (value & (1u << i)) {
+				out[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+			}
+		}
+	}
+
+	// Endpoint as 7 bits per channel and a shared p-bit, whichever p-bit lands closer.
+	void quantizeBC7Endpoint(const float *color, uint32_t *channels, uint32_t *pBit) {
+		float bestError{ -1.0f };
+		for (uint32_t p{ 0 }; p < 2; p++) {
+			uint32_t candidate[4];
+			float error{ 0.0f };
+			for (uint32_t c{ 0 }; c < 4; c++) {
+				const int value{ static_cast<int>((color[c] - p) / 2.0f + 0.5f) };
+				candidate[c] = static_cast<uint32_t>(std::min(127, std::max(0, value)));
+				const float diff{ color[c] - static_cast<float>((candidate[c] << 1) | p) };
+				error += diff * diff;
+			}
+			if (bestError < 0.0f || error < bestError) {
+				bestError = error;
+				std::memcpy(channels, candidate, sizeof(candidate));
+				*pBit = p;
+			}
+		}
+	}
+}
+
+vector<uint8_t> BlockCompression::compress(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format) {
+	const VkDeviceSize blockSize{ Ktx2::getBlockSize(format) };
+	if (blockSize == 0) {
+		throw std::runtime_error("No block encoder for format " + std::to_string(format));
+	}
+
+	const uint32_t blocksX{ (width + 3) / 4 };
+	const uint32_t blocksY{ (height + 3) / 4 };
+	vector<uint8_t> result(static_cast<size_t>(blocksX) * blocksY * blockSize);
+	uint8_t *out{ result.data() };
+	for (uint32_t by{ 0 }; by < blocksY; by++) {
+		for (uint32_t bx{ 0 }; bx < blocksX; bx++, out += blockSize) {
+			uint8_t block[64];
+			for (uint32_t y{ 0 }; y < 4; y++) {
+				for (uint32_t x{ 0 }; x < 4; x++) {
+					const uint32_t srcX{ std::min(bx * 4 + x, width - 1) };
+					const uint32_t srcY{ std::min(by * 4 + y, height - 1) };
+					std::memcpy(block + (y * 4 + x) * 4, pixels + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+				}
+			}
+
+			switch (format) {
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+				encodeBC1(block, out);
+				break;
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				encodeBC4(block, 0, out);
+				break;
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+				encodeBC4(block, 0, out);
+				encodeBC4(block, 1, out + 8);
+				break;
+			default:
+				encodeBC7(block, out);
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+void BlockCompression::encodeBC1(const uint8_t *block, uint8_t *out) {
+	float low[3];
+	float high[3];
+	fitAxis(block, 3, low, high);
+	uint16_t color0{ packRGB565(high) };
+	uint16_t color1{ packRGB565(low) };
+	// color0 > color1 picks the four colour mode, no transparent index.
+	if (color0 < color1) {
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices{ 0 };
+	if (color0 != color1) {
+		int palette[4][4];
+		unpackRGB565(color0, palette[0]);
+		unpackRGB565(color1, palette[1]);
+		for (uint32_t c{ 0 }; c < 4; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			indices |= nearestIndex(block + i * 4, palette, 4, 3) << (i * 2);
+		}
+	}
+
+	std::memcpy(out, &color0, 2);
+	std::memcpy(out + 2, &color1, 2);
+	std::memcpy(out + 4, &indices, 4);
+}
+
+void BlockCompression::encodeBC4(const uint8_t *block, uint32_t channel, uint8_t *out) {
+	uint8_t red0{ 0 };
+	uint8_t red1{ 255 };
+	for (uint32_t i{ 0 }; i < 16; i++) {
+		red0 = std::max(red0, block[i * 4 + channel]);
+		red1 = std::min(red1, block[i * 4 + channel]);
+	}
+
+	// red0 > red1 picks eight interpolated values. Equal ends leave every index 0.
+	uint64_t indices{ 0 };
+	if (red0 != red1) {
+		int palette[8][4]{};
+		palette[0][0] = red0;
+		palette[1][0] = red1;
+		for (uint32_t p{ 2 }; p < 8; p++) {
+			palette[p][0] = ((8 - p) * red0 + (p - 1) * red1) / 7;
+		}
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			const uint8_t value{ block[i * 4 + channel] };
+			indices |= static_cast<uint64_t>(nearestIndex(&value, palette, 8, 1)) << (i * 3);
+		}
+	}
+
+	out[0] = red0;
+	out[1] = red1;
+	for (uint32_t i{ 0 }; i < 6; i++) {
+		out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+void BlockCompression::encodeBC7(const uint8_t *block, uint8_t *out) {
+	float low[4];
+	float high[4];
+	fitAxis(block, 4, low, high);
+
+	uint32_t endpoints[2][4];
+	uint32_t pBits[2];
+	quantizeBC7Endpoint(low, endpoints[0], &pBits[0]);
+	quantizeBC7Endpoint(high, endpoints[1], &pBits[1]);
+
+	int palette[16][4];
+	for (uint32_t w{ 0 }; w < 16; w++) {
+		for (uint32_t c{ 0 }; c < 4; c++) {
+			const uint32_t e0{ (endpoints[0][c] << 1) | pBits[0] };
+			const uint32_t e1{ (endpoints[1][c] << 1) | pBits[1] };
+			palette[w][c] = static_cast<int>(((64 - BC7_WEIGHTS[w]) * e0 + BC7_WEIGHTS[w] * e1 + 32) >> 6);
+		}
+	}
+	uint32_t indices[16];
+	for (uint32_t i{ 0 }; i < 16; i++) {
+		indices[i] = nearestIndex(block + i * 4, palette, 16, 4);
+	}
+
+	// The first index is stored without its top bit, swapping the endpoints flips it when it's set.
+	if (indices[0] & 8) {
+		std::swap(endpoints[0], endpoints[1]);
+		std::swap(pBits[0], pBits[1]);
+		for (uint32_t i{ 0 }; i < 16; i++) {
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	std::memset(out, 0, 16);
+	uint32_t position{ 0 };
+	writeBits(out, position, 1u << 6, 7); // Mode 6.
+	for (uint32_t c{ 0 }; c < 4; c++) {
+		writeBits(out, position, endpoints[0][c], 7);
+		writeBits(out, position, endpoints[1][c], 7);
+	}
+	writeBits(out, position, pBits[0], 1);
+	writeBits(out, position, pBits[1], 1);
+	writeBits(out, position, indices[0], 3);
+	for (uint32_t i{ 1 }; i < 16; i++) {
+		writeBits(out, position, indices[i], 4);
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+using std::vector;
+
+// CPU block compression for the KTX2 textures. Quick rather than best quality: BC1 and BC4 fit their endpoints to
+// the block's range, BC7 only uses mode 6 (one subset, RGBA endpoints, 4 bit indices).
+class BlockCompression
+{
+public:
+	// pixels are RGBA8, the result is every 4x4 block of the image in row order. Edge blocks repeat the last texel.
+	static vector<uint8_t> compress(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format);
+
+private:
+	// Block is 16 RGBA texels.
+	static void encodeBC1(const uint8_t *block, uint8_t *out);
+	static void encodeBC4(const uint8_t *block, uint32_t channel, uint8_t *out);
+	static void encodeBC7(const uint8_t *block, uint8_t *out);
+};
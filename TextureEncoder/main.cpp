@@ -0,0 +1,133 @@
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+
+#include "../VulkanCourseApp/Utilities.h"
+#include "../VulkanCourseApp/Ktx2.h"
+#include "../VulkanCourseApp/TextureDecoder.h"
+#include "../VulkanCourseApp/ThreadPool.h"
+#include "BlockCompression.h"
+
+using std::string;
+using std::vector;
+namespace fs = std::filesystem;
+
+// Normal maps keep two channels, grey opaque images one, opaque colour goes to BC1 and anything with alpha to BC7.
+VkFormat chooseFormat(const fs::path &path, const TextureDecoder::Image &image, bool preferBC7) {
+	string stem{ path.stem().string() };
+	std::transform(stem.begin(), stem.end(), stem.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	const auto endsWith = [&stem](const string &suffix) {
+		return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+	};
+	if (endsWith("_n") || endsWith("_normal")) {
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	}
+
+	bool opaque{ true };
+	bool grey{ true };
+	const size_t texelCount{ static_cast<size_t>(image.width) * image.height };
+	for (size_t i{ 0 }; i < texelCount; i++) {
+		const stbi_uc *texel{ image.pixels + i * 4 };
+		opaque = opaque && texel[3] == 255;
+		grey = grey && texel[0] == texel[1] && texel[1] == texel[2];
+	}
+	if (!opaque || preferBC7) {
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	}
+	return grey ? VK_FORMAT_BC4_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+}
+
+void encodeTexture(const fs::path &source, const fs::path &target, bool preferBC7) {
+	// Left on the heap, there's no staging here.
+	TextureDecoder::Image image{ TextureDecoder::decodeFile(source.string(), [](VkDeviceSize) { return nullptr; }) };
+	const uint32_t width{ static_cast<uint32_t>(image.width) };
+	const uint32_t height{ static_cast<uint32_t>(image.height) };
+	const VkFormat format{ chooseFormat(source, image, preferBC7) };
+
+	// Same box filtered chain the renderer builds when it can't blit.
+	const uint32_t mipLevels{ getMipLevelCount(width, height) };
+	const vector<uint8_t> chain{ buildMipChain(image.pixels, width, height, mipLevels) };
+
+	vector<vector<uint8_t>> levels;
+	levels.push_back(BlockCompression::compress(image.pixels, width, height, format));
+	size_t offset{ 0 };
+	for (uint32_t level{ 1 }; level < mipLevels; level++) {
+		const uint32_t levelWidth{ std::max(width >> level, 1u) };
+		const uint32_t levelHeight{ std::max(height >> level, 1u) };
+		levels.push_back(BlockCompression::compress(chain.data() + offset, levelWidth, levelHeight, format));
+		offset += static_cast<size_t>(levelWidth) * levelHeight * 4;
+	}
+	stbi_image_free(image.pixels);
+
+	Ktx2::write(target.string(), format, width, height, levels);
+}
+
+// Converts every jpg/png under the directory (Textures by default) to a KTX2 next to it, skipping ones that are
+// already newer than their source. --bc7 encodes colour textures as BC7 instead of BC1.
+int main(int argc, char **argv) {
+	fs::path directory{ "Textures" };
+	bool preferBC7{ false };
+	for (int i{ 1 }; i < argc; i++) {
+		const string arg{ argv[i] };
+		if (arg == "--bc7") {
+			preferBC7 = true;
+		}
+		else {
+			directory = arg;
+		}
+	}
+
+	vector<fs::path> sources;
+	try {
+		for (const fs::directory_entry &entry : fs::directory_iterator(directory)) {
+			string extension{ entry.path().extension().string() };
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+			if (!entry.is_regular_file() || (extension != ".jpg" && extension != ".jpeg" && extension != ".png")) {
+				continue;
+			}
+			fs::path target{ entry.path() };
+			target.replace_extension(".ktx2");
+			if (!fs::exists(target) || fs::last_write_time(target) < entry.last_write_time()) {
+				sources.push_back(entry.path());
+			}
+		}
+	}
+	catch (const std::exception &e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// A texture per job, the encoder itself is single threaded.
+	ThreadPool threadPool{ std::max(std::thread::hardware_concurrency(), 1u) };
+	std::mutex outputMutex;
+	int failures{ 0 };
+	try {
+		threadPool.parallelFor(static_cast<uint32_t>(sources.size()), [&](uint32_t index, uint32_t) {
+			fs::path target{ sources[index] };
+			target.replace_extension(".ktx2");
+			try {
+				encodeTexture(sources[index], target, preferBC7);
+				std::lock_guard<std::mutex> lock{ outputMutex };
+				std::cout << sources[index].string() << " -> " << target.string() << std::endl;
+			}
+			catch (const std::exception &e) {
+				std::lock_guard<std::mutex> lock{ outputMutex };
+				std::cout << "ERROR: " << sources[index].string() << ": " << e.what() << std::endl;
+				failures++;
+			}
+		});
+	}
+	catch (const std::exception &e) {
+		std::cout << "ERROR: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << sources.size() - failures << " of " << sources.size() << " textures encoded" << std::endl;
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,93 @@
+#include "AtlasPacker.h"
+
+AtlasPacker::AtlasPacker() {
+}
+
+AtlasPacker::AtlasPacker(uint32_t width, uint32_t height) {
+	_width = width;
+	_height = height;
+	_skyline.push_back({ 0, 0, width });
+}
+
+bool AtlasPacker::insert(uint32_t width, uint32_t height, uint32_t *x, uint32_t *y) {
+	size_t bestIndex{ _skyline.size() };
+	uint32_t bestY{ 0 };
+	uint32_t bestTop{ UINT32_MAX };
+	uint32_t bestWidth{ UINT32_MAX };
+	for (size_t i{ 0 }; i < _skyline.size(); i++) {
+		uint32_t fitY;
+		if (!fit(i, width, height, &fitY)) {
+			continue;
+		}
+		if (fitY + height < bestTop || (fitY + height == bestTop && _skyline[i].width < bestWidth)) {
+			bestIndex = i;
+			bestY = fitY;
+			bestTop = fitY + height;
+			bestWidth = _skyline[i].width;
+		}
+	}
+	if (bestIndex == _skyline.size()) {
+		return false;
+	}
+
+	const Segment placed{ _skyline[bestIndex].x, bestTop, width };
+	_skyline.insert(_skyline.begin() + bestIndex, placed);
+
+	// Segments it now covers are cut back or dropped.
+	const uint32_t placedRight{ placed.x + placed.width };
+	for (size_t i{ bestIndex + 1 }; i < _skyline.size();) {
+		Segment &segment{ _skyline[i] };
+		if (segment.x >= placedRight) {
+			break;
+		}
+		const uint32_t covered{ placedRight - segment.x };
+		if (covered < segment.width) {
+			segment.x += covered;
+			segment.width -= covered;
+			break;
+		}
+		_skyline.erase(_skyline.begin() + i);
+	}
+
+	// Neighbours at the same height become one.
+	for (size_t i{ 0 }; i + 1 < _skyline.size();) {
+		if (_skyline[i].y == _skyline[i + 1].y) {
+			_skyline[i].width += _skyline[i + 1].width;
+			_skyline.erase(_skyline.begin() + i + 1);
+		}
+		else {
+			i++;
+		}
+	}
+
+	*x = placed.x;
+	*y = bestY;
+	_usedHeight = std::max(_usedHeight, bestTop);
+	return true;
+}
+
+uint32_t AtlasPacker::getUsedHeight() {
+	return _usedHeight;
+}
+
+bool AtlasPacker::fit(size_t index, uint32_t width, uint32_t height, uint32_t *y) {
+	if (_skyline[index].x + width > _width) {
+		return false;
+	}
+
+	// It rests on the highest segment it spans. The skyline covers the full width, so it can't run out.
+	uint32_t top{ 0 };
+	uint32_t remaining{ width };
+	for (size_t i{ index }; remaining > 0; i++) {
+		top = std::max(top, _skyline[i].y);
+		if (top + height > _height) {
+			return false;
+		}
+		remaining -= std::min(remaining, _skyline[i].width);
+	}
+	*y = top;
+	return true;
+}
+
+AtlasPacker::~AtlasPacker() {
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+using std::vector;
+
+// Skyline rectangle packer. The packed area is kept as the outline of its top edge, a rect goes where its top
+// ends up lowest, on the narrowest segment when that ties. Good for rects sorted tallest first.
+class AtlasPacker
+{
+public:
+	AtlasPacker();
+	AtlasPacker(uint32_t width, uint32_t height);
+
+	// False when there's no room left for it.
+	bool insert(uint32_t width, uint32_t height, uint32_t *x, uint32_t *y);
+	// Top of the highest rect, rows past it are unused.
+	uint32_t getUsedHeight();
+
+	~AtlasPacker();
+private:
+	struct Segment {
+		uint32_t x;
+		uint32_t y; // Top of what's packed under it.
+		uint32_t width;
+	};
+
+	uint32_t _width{ 0 };
+	uint32_t _height{ 0 };
+	uint32_t _usedHeight{ 0 };
+	vector<Segment> _skyline;
+
+	// Where a rect with its left edge on the segment would sit, false when it runs off the right or the top.
+	bool fit(size_t index, uint32_t width, uint32_t height, uint32_t *y);
+};
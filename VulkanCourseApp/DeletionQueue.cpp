@@ -0,0 +1,39 @@
+#include "DeletionQueue.h"
+
+DeletionQueue::DeletionQueue() {
+}
+
+void DeletionQueue::push(TimelineScheduler::Point lastUse, std::function<void()> destroyFunc) {
+	_entries.push_back({ lastUse, destroyFunc });
+}
+
+void DeletionQueue::collect(TimelineScheduler &scheduler) {
+	// Points from different queues don't complete in push order, so check each one. Kept in order otherwise.
+	size_t kept{ 0 };
+	for (size_t i{ 0 }; i < _entries.size(); i++) {
+		if (scheduler.isComplete(_entries[i].lastUse)) {
+			_entries[i].destroyFunc();
+		}
+		else {
+			if (kept != i) {
+				_entries[kept] = std::move(_entries[i]);
+			}
+			kept++;
+		}
+	}
+	_entries.resize(kept);
+}
+
+void DeletionQueue::flush() {
+	for (auto &entry : _entries) {
+		entry.destroyFunc();
+	}
+	_entries.clear();
+}
+
+size_t DeletionQueue::getPendingCount() {
+	return _entries.size();
+}
+
+DeletionQueue::~DeletionQueue() {
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+
+#include "TimelineScheduler.h"
+
+using std::vector;
+
+// Vulkan objects freed at runtime, each destroyed once the timeline point of the last submit that could use it
+// has been reached. Lets models and textures go while frames keep running, without idling the device.
+class DeletionQueue
+{
+public:
+	DeletionQueue();
+
+	void push(TimelineScheduler::Point lastUse, std::function<void()> destroyFunc);
+	// Runs everything whose point has been reached. Cheap enough to call every frame.
+	void collect(TimelineScheduler &scheduler);
+	// Runs the lot, only once the device is idle.
+	void flush();
+	size_t getPendingCount();
+
+	~DeletionQueue();
+private:
+	struct Entry {
+		TimelineScheduler::Point lastUse;
+		std::function<void()> destroyFunc;
+	};
+
+	vector<Entry> _entries;
+};
@@ -0,0 +1,122 @@
+#include "DynamicResolution.h"
+
+DynamicResolution::DynamicResolution() {
+}
+
+DynamicResolution::DynamicResolution(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount) {
+	_device = device;
+	_recorded.resize(frameCount, false);
+
+	// Timestamps need to be supported on the queue family the frame is submitted to.
+	uint32_t queueFamilyCount{ 0 };
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	const uint32_t validBits{ queueFamilies[queueFamilyIndex].timestampValidBits };
+	if (validBits == 0) {
+		// No timestamps, stay at native resolution.
+		return;
+	}
+	_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties deviceProps{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+	_timestampPeriod = deviceProps.limits.timestampPeriod;
+
+	// Begin and end timestamp for each frame in flight.
+	VkQueryPoolCreateInfo queryPoolCreateInfo{};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = frameCount * 2;
+
+	if (vkCreateQueryPool(_device, &queryPoolCreateInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a timestamp query pool.");
+	}
+
+	_supported = true;
+}
+
+void DynamicResolution::setFrameBudget(float frameBudgetMs) {
+	_frameBudgetMs = frameBudgetMs;
+}
+
+bool DynamicResolution::isSupported() {
+	return _supported;
+}
+
+void DynamicResolution::cmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (!_supported) {
+		return;
+	}
+
+	// Queries must be reset before they can be written again.
+	vkCmdResetQueryPool(commandBuffer, _queryPool, frame * 2, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, frame * 2);
+}
+
+void DynamicResolution::cmdEndFrame(VkCommandBuffer commandBuffer, uint32_t frame) {
+	if (!_supported) {
+		return;
+	}
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, frame * 2 + 1);
+	_recorded[frame] = true;
+}
+
+void DynamicResolution::update(uint32_t frame) {
+	if (!_supported || !_recorded[frame]) {
+		return;
+	}
+
+	// Frame's last submit has completed, so the results are already available and this won't stall.
+	uint64_t timestamps[2]{};
+	if (vkGetQueryPoolResults(_device, _queryPool, frame * 2, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return;
+	}
+
+	const uint64_t ticks{ (timestamps[1] - timestamps[0]) & _timestampMask };
+	const float frameMs{ static_cast<float>(ticks) * _timestampPeriod / 1000000.0f };
+
+	// Moving average so a single slow frame doesn't drop the resolution.
+	_gpuTimeMs = _gpuTimeMs == 0.0f ? frameMs : _gpuTimeMs + (frameMs - _gpuTimeMs) * FRAME_TIME_SMOOTHING;
+	if (_gpuTimeMs <= 0.0f) {
+		return;
+	}
+
+	// Scale that would land the frame at the (headroomed) budget.
+	float targetScale{ _scale * std::sqrt(_frameBudgetMs * RESOLUTION_HEADROOM / _gpuTimeMs) };
+	targetScale = std::min(std::max(targetScale, MIN_RESOLUTION_SCALE), 1.0f);
+	if (std::abs(targetScale - _scale) < RESOLUTION_DEADBAND) {
+		return;
+	}
+
+	// Approach it gradually, the average lags behind the change anyway.
+	_scale += (targetScale - _scale) * 0.25f;
+}
+
+float DynamicResolution::getScale() {
+	return _scale;
+}
+
+float DynamicResolution::getGpuTimeMs() {
+	return _gpuTimeMs;
+}
+
+VkExtent2D DynamicResolution::getRenderExtent(VkExtent2D fullExtent) {
+	VkExtent2D renderExtent{};
+	renderExtent.width = std::max(1u, static_cast<uint32_t>(fullExtent.width * _scale));
+	renderExtent.height = std::max(1u, static_cast<uint32_t>(fullExtent.height * _scale));
+	return renderExtent;
+}
+
+void DynamicResolution::destroyQueryPool() {
+	if (_queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(_device, _queryPool, nullptr);
+		_queryPool = VK_NULL_HANDLE;
+	}
+}
+
+DynamicResolution::~DynamicResolution() {
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "Utilities.h"
+
+using std::vector;
+
+const float MIN_RESOLUTION_SCALE = 0.5f;
+const float RESOLUTION_HEADROOM = 0.9f; // Aim under the budget so a spike doesn't miss the frame.
+const float RESOLUTION_DEADBAND = 0.05f; // Ignore changes smaller than this to stop the resolution shimmering.
+const float FRAME_TIME_SMOOTHING = 0.1f; // Weight of the newest sample in the moving average.
+
+// Picks the fraction of the swapchain extent the scene renders at, from GPU frame times
+// measured with timestamp queries. Pixel cost scales with area, so the scale moves by sqrt(budget / time).
+class DynamicResolution
+{
+public:
+	DynamicResolution();
+	DynamicResolution(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount);
+
+	void setFrameBudget(float frameBudgetMs);
+	bool isSupported();
+
+	// Record around the whole frame. Queries are per frame in flight, so results are ready once its last submit completes.
+	void cmdBeginFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+	void cmdEndFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+
+	// Read back the frame's timings (after its last submit completes) and move the scale towards the budget.
+	void update(uint32_t frame);
+
+	float getScale();
+	float getGpuTimeMs();
+	VkExtent2D getRenderExtent(VkExtent2D fullExtent);
+
+	void destroyQueryPool();
+
+	~DynamicResolution();
+private:
+	VkDevice _device;
+	VkQueryPool _queryPool{ VK_NULL_HANDLE };
+	bool _supported{ false };
+	float _timestampPeriod{ 1.0f }; // Nanoseconds per timestamp tick.
+	uint64_t _timestampMask{ 0 }; // Only timestampValidBits of each result are meaningful.
+
+	vector<bool> _recorded; // Frame's command buffers write timestamps. Stays set, they're submitted again without re-recording.
+
+	float _frameBudgetMs{ 1000.0f / 60.0f };
+	float _gpuTimeMs{ 0.0f }; // Smoothed GPU frame time.
+	float _scale{ 1.0f };
+};
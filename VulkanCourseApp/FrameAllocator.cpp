@@ -0,0 +1,137 @@
+#include "FrameAllocator.h"
+
+FrameAllocator::FrameAllocator() {
+}
+
+FrameAllocator::FrameAllocator(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount, VkDeviceSize frameSize) {
+	_device = device;
+
+	// Offsets have to suit either binding. Both limits are powers of two, so the larger is a multiple of the smaller.
+	VkPhysicalDeviceProperties deviceProps{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+	_alignment = std::max(deviceProps.limits.minUniformBufferOffsetAlignment, deviceProps.limits.minStorageBufferOffsetAlignment);
+	_frameSize = (frameSize + _alignment - 1) & ~(_alignment - 1);
+	_uniformRange = std::min(_frameSize, static_cast<VkDeviceSize>(deviceProps.limits.maxUniformBufferRange));
+
+	// A frame's worth of padding on the end, so a range bound at the last offset of the last frame stays in the buffer.
+	createBuffer(physicalDevice, _device, _frameSize * (frameCount + 1),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		&_buffer, &_bufferMem);
+
+	// Mapped for as long as it lives.
+	void *data;
+	if (vkMapMemory(_device, _bufferMem, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map the frame allocator buffer.");
+	}
+	_mapped = static_cast<uint8_t *>(data);
+
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1] = bindings[0];
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = 2;
+	layoutCreateInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(_device, &layoutCreateInfo, nullptr, &_setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the frame allocator descriptor set layout.");
+	}
+
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	poolSizes[0].descriptorCount = 1;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+	poolSizes[1].descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the frame allocator descriptor pool.");
+	}
+
+	VkDescriptorSetAllocateInfo setAllocInfo{};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = _descPool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &_setLayout;
+
+	if (vkAllocateDescriptorSets(_device, &setAllocInfo, &_descSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate the frame allocator descriptor set.");
+	}
+
+	// Written once, everything after is a dynamic offset.
+	VkDescriptorBufferInfo bufferInfos[2]{};
+	bufferInfos[0].buffer = _buffer;
+	bufferInfos[0].range = _uniformRange;
+	bufferInfos[1].buffer = _buffer;
+	bufferInfos[1].range = _frameSize;
+
+	VkWriteDescriptorSet setWrites[2]{};
+	for (uint32_t i{ 0 }; i < 2; i++) {
+		setWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		setWrites[i].dstSet = _descSet;
+		setWrites[i].dstBinding = i;
+		setWrites[i].descriptorCount = 1;
+		setWrites[i].descriptorType = bindings[i].descriptorType;
+		setWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(_device, 2, setWrites, 0, nullptr);
+}
+
+void FrameAllocator::reset(uint32_t frame) {
+	_frameBegin = _frameSize * frame;
+	_head = _frameBegin;
+}
+
+FrameAllocator::Allocation FrameAllocator::allocate(VkDeviceSize size) {
+	const VkDeviceSize offset{ (_head + _alignment - 1) & ~(_alignment - 1) };
+	if (offset + size > _frameBegin + _frameSize) {
+		throw std::runtime_error("Frame allocator is out of space for this frame.");
+	}
+	_head = offset + size;
+
+	Allocation allocation{};
+	allocation.data = _mapped + offset;
+	allocation.offset = static_cast<uint32_t>(offset);
+	return allocation;
+}
+
+VkDescriptorSetLayout FrameAllocator::getDescriptorSetLayout() {
+	return _setLayout;
+}
+
+VkDescriptorSet FrameAllocator::getDescriptorSet() {
+	return _descSet;
+}
+
+VkDeviceSize FrameAllocator::getUniformRange() {
+	return _uniformRange;
+}
+
+VkDeviceSize FrameAllocator::getStorageRange() {
+	return _frameSize;
+}
+
+void FrameAllocator::destroy() {
+	vkDestroyDescriptorPool(_device, _descPool, nullptr);
+	vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+
+	vkUnmapMemory(_device, _bufferMem);
+	vkDestroyBuffer(_device, _buffer, nullptr);
+	vkFreeMemory(_device, _bufferMem, nullptr);
+	_mapped = nullptr;
+}
+
+FrameAllocator::~FrameAllocator() {
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <algorithm>
+
+#include "Utilities.h"
+
+using std::vector;
+
+// Per frame data uploaded with a pointer bump. One persistently mapped, host coherent buffer split into a region
+// per frame in flight. reset() once the frame's last submit has completed, then allocate() as much as the frame needs.
+// Offsets are aligned for both uniform and storage binding and are given as dynamic offsets to the one set.
+class FrameAllocator
+{
+public:
+	struct Allocation {
+		void *data; // Write straight into this, nothing to flush.
+		uint32_t offset; // Dynamic offset, the same for both bindings.
+	};
+
+	FrameAllocator();
+	FrameAllocator(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount, VkDeviceSize frameSize);
+
+	// Start of a frame, drops everything allocated the last time this frame was used.
+	void reset(uint32_t frame);
+	Allocation allocate(VkDeviceSize size);
+
+	// Uniform buffer at binding 0, storage buffer at binding 1, both dynamic. Shaders see getUniformRange()
+	// and getStorageRange() bytes from the offset they're bound at.
+	VkDescriptorSetLayout getDescriptorSetLayout();
+	VkDescriptorSet getDescriptorSet();
+	VkDeviceSize getUniformRange();
+	VkDeviceSize getStorageRange();
+
+	void destroy();
+
+	~FrameAllocator();
+private:
+	VkDevice _device;
+	VkDeviceSize _frameSize{ 0 };
+	VkDeviceSize _alignment{ 1 };
+	VkDeviceSize _uniformRange{ 0 };
+
+	VkBuffer _buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory _bufferMem{ VK_NULL_HANDLE };
+	uint8_t *_mapped{ nullptr };
+
+	// Current frame's region.
+	VkDeviceSize _frameBegin{ 0 };
+	VkDeviceSize _head{ 0 };
+
+	VkDescriptorSetLayout _setLayout{ VK_NULL_HANDLE };
+	VkDescriptorPool _descPool{ VK_NULL_HANDLE };
+	VkDescriptorSet _descSet{ VK_NULL_HANDLE };
+};
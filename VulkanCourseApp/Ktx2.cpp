@@ -0,0 +1,184 @@
+#include "Ktx2.h"
+
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	const unsigned char KTX2_IDENTIFIER[12]{ 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Header {
+		unsigned char identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct LevelIndex {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	// Data format descriptor colour models and channels from the Khronos data format spec.
+	const uint32_t KHR_DF_MODEL_BC1A{ 128 };
+	const uint32_t KHR_DF_MODEL_BC4{ 131 };
+	const uint32_t KHR_DF_MODEL_BC5{ 132 };
+	const uint32_t KHR_DF_MODEL_BC7{ 134 };
+	const uint32_t KHR_DF_CHANNEL_RED{ 0 };
+	const uint32_t KHR_DF_CHANNEL_GREEN{ 1 };
+	const uint32_t KHR_DF_PRIMARIES_BT709{ 1 };
+	const uint32_t KHR_DF_TRANSFER_LINEAR{ 1 };
+}
+
+Ktx2::Info Ktx2::parse(const unsigned char *data, size_t size, const string &filePath) {
+	Header header{};
+	if (size < sizeof(Header)) {
+		throw std::runtime_error("KTX2 file is too small, file=" + filePath);
+	}
+	memcpy(&header, data, sizeof(Header));
+	if (memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+		throw std::runtime_error("Not a KTX2 file, file=" + filePath);
+	}
+	if (header.supercompressionScheme != 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) {
+		throw std::runtime_error("KTX2 file isn't a plain 2D texture, file=" + filePath);
+	}
+
+	Info info{};
+	info.format = static_cast<VkFormat>(header.vkFormat);
+	info.width = header.pixelWidth;
+	info.height = header.pixelHeight;
+	const VkDeviceSize blockSize{ getBlockSize(info.format) };
+	if (blockSize == 0) {
+		throw std::runtime_error("KTX2 file has an unsupported format=" + std::to_string(header.vkFormat) + ", file=" + filePath);
+	}
+	if (info.width == 0 || info.height == 0) {
+		throw std::runtime_error("KTX2 file has no pixels, file=" + filePath);
+	}
+
+	// 0 levels means the loader should generate them, there's still a base level. No more than down to 1x1.
+	const uint32_t levelCount{ header.levelCount > 0 ? header.levelCount : 1 };
+	uint32_t maxLevelCount{ 1 };
+	for (uint32_t extent{ info.width > info.height ? info.width : info.height }; extent > 1; extent /= 2) {
+		maxLevelCount++;
+	}
+	if (levelCount > maxLevelCount) {
+		throw std::runtime_error("KTX2 file has more levels than its size allows, file=" + filePath);
+	}
+	if (sizeof(Header) + levelCount * sizeof(LevelIndex) > size) {
+		throw std::runtime_error("KTX2 level index is cut off, file=" + filePath);
+	}
+	for (uint32_t level{ 0 }; level < levelCount; level++) {
+		LevelIndex index{};
+		memcpy(&index, data + sizeof(Header) + level * sizeof(LevelIndex), sizeof(LevelIndex));
+		if (index.byteOffset > size || index.byteLength > size - index.byteOffset) {
+			throw std::runtime_error("KTX2 level data is cut off, file=" + filePath);
+		}
+		const uint32_t width{ info.width >> level > 0 ? info.width >> level : 1 };
+		const uint32_t height{ info.height >> level > 0 ? info.height >> level : 1 };
+		// Uploads copy whole blocks, a short level would have them read past its data.
+		if (index.byteLength < static_cast<uint64_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize) {
+			throw std::runtime_error("KTX2 level " + std::to_string(level) + " is too small, file=" + filePath);
+		}
+		info.levels.push_back({ index.byteOffset, index.byteLength, width, height });
+	}
+	return info;
+}
+
+void Ktx2::write(const string &filePath, VkFormat format, uint32_t width, uint32_t height, const vector<vector<uint8_t>> &levels) {
+	const VkDeviceSize blockSize{ getBlockSize(format) };
+	if (blockSize == 0) {
+		throw std::runtime_error("Can't write KTX2 with format=" + std::to_string(format));
+	}
+
+	// Basic data format descriptor block, one sample per channel the blocks hold.
+	uint32_t colorModel;
+	vector<uint32_t> channels;
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK: colorModel = KHR_DF_MODEL_BC1A; channels = { KHR_DF_CHANNEL_RED }; break;
+	case VK_FORMAT_BC4_UNORM_BLOCK: colorModel = KHR_DF_MODEL_BC4; channels = { KHR_DF_CHANNEL_RED }; break;
+	case VK_FORMAT_BC5_UNORM_BLOCK: colorModel = KHR_DF_MODEL_BC5; channels = { KHR_DF_CHANNEL_RED, KHR_DF_CHANNEL_GREEN }; break;
+	default: colorModel = KHR_DF_MODEL_BC7; channels = { KHR_DF_CHANNEL_RED }; break;
+	}
+	const uint32_t sampleBits{ static_cast<uint32_t>(blockSize * 8 / channels.size()) };
+	vector<uint32_t> dfd{
+		0, // Total size, filled in below.
+		0, // Vendor and descriptor type, both Khronos basic.
+		2 | ((24 + 16 * static_cast<uint32_t>(channels.size())) << 16), // Version and block size.
+		colorModel | (KHR_DF_PRIMARIES_BT709 << 8) | (KHR_DF_TRANSFER_LINEAR << 16),
+		3 | (3 << 8), // 4x4 texel blocks.
+		static_cast<uint32_t>(blockSize),
+		0,
+	};
+	for (size_t i{ 0 }; i < channels.size(); i++) {
+		dfd.push_back(static_cast<uint32_t>(i * sampleBits) | ((sampleBits - 1) << 16) | (channels[i] << 24));
+		dfd.push_back(0);
+		dfd.push_back(0);
+		dfd.push_back(0xFFFFFFFF);
+	}
+	dfd[0] = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+
+	Header header{};
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = format;
+	header.typeSize = 1;
+	header.pixelWidth = width;
+	header.pixelHeight = height;
+	header.faceCount = 1;
+	header.levelCount = static_cast<uint32_t>(levels.size());
+	header.dfdByteOffset = static_cast<uint32_t>(sizeof(Header) + levels.size() * sizeof(LevelIndex));
+	header.dfdByteLength = dfd[0];
+
+	// Level data goes smallest first, each aligned to the block size.
+	vector<LevelIndex> index(levels.size());
+	uint64_t offset{ header.dfdByteOffset + header.dfdByteLength };
+	for (size_t level{ levels.size() }; level-- > 0;) {
+		offset = (offset + blockSize - 1) / blockSize * blockSize;
+		index[level] = { offset, levels[level].size(), levels[level].size() };
+		offset += levels[level].size();
+	}
+
+	std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		throw std::runtime_error("Failed to open file for writing=" + filePath);
+	}
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(LevelIndex));
+	file.write(reinterpret_cast<const char *>(dfd.data()), dfd.size() * sizeof(uint32_t));
+	for (size_t level{ levels.size() }; level-- > 0;) {
+		// Padding up to the aligned offset.
+		while (static_cast<uint64_t>(file.tellp()) < index[level].byteOffset) {
+			file.put(0);
+		}
+		file.write(reinterpret_cast<const char *>(levels[level].data()), levels[level].size());
+	}
+	if (!file) {
+		throw std::runtime_error("Failed to write file=" + filePath);
+	}
+}
+
+VkDeviceSize Ktx2::getBlockSize(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+		return 8;
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return 16;
+	default:
+		return 0;
+	}
+}
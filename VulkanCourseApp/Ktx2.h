@@ -0,0 +1,38 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+
+using std::vector;
+using std::string;
+
+// KTX2 container, the subset block compressed textures need: 2D, one layer, one face, no supercompression.
+// Shared by the loader and the offline encoder.
+class Ktx2
+{
+public:
+	struct Level {
+		VkDeviceSize offset; // From the start of the file.
+		VkDeviceSize size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct Info {
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		vector<Level> levels; // Largest first.
+	};
+
+	// Throws on anything outside the subset.
+	static Info parse(const unsigned char *data, size_t size, const string &filePath);
+	// levels are largest first, each a whole number of blocks.
+	static void write(const string &filePath, VkFormat format, uint32_t width, uint32_t height, const vector<vector<uint8_t>> &levels);
+
+	// Bytes per 4x4 block, 0 for formats it doesn't handle.
+	static VkDeviceSize getBlockSize(VkFormat format);
+};
@@ -0,0 +1,84 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const string &filePath) {
+#ifdef _WIN32
+	HANDLE file{ CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open file=" + filePath);
+	}
+	_file = file;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map empty or unreadable file=" + filePath);
+	}
+	_size = static_cast<size_t>(fileSize.QuadPart);
+
+	HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+	if (!mapping) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map file=" + filePath);
+	}
+	_mapping = mapping;
+
+	_data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		throw std::runtime_error("Failed to map file=" + filePath);
+	}
+#else
+	_fd = open(filePath.c_str(), O_RDONLY);
+	if (_fd < 0) {
+		throw std::runtime_error("Failed to open file=" + filePath);
+	}
+
+	struct stat fileStat{};
+	if (fstat(_fd, &fileStat) != 0 || fileStat.st_size == 0) {
+		close(_fd);
+		throw std::runtime_error("Failed to map empty or unreadable file=" + filePath);
+	}
+	_size = static_cast<size_t>(fileStat.st_size);
+
+	void *data{ mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0) };
+	if (data == MAP_FAILED) {
+		close(_fd);
+		throw std::runtime_error("Failed to map file=" + filePath);
+	}
+	_data = static_cast<const unsigned char *>(data);
+#endif
+}
+
+const unsigned char *MappedFile::getData() {
+	return _data;
+}
+
+size_t MappedFile::getSize() {
+	return _size;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	UnmapViewOfFile(_data);
+	CloseHandle(static_cast<HANDLE>(_mapping));
+	CloseHandle(static_cast<HANDLE>(_file));
+#else
+	munmap(const_cast<unsigned char *>(_data), _size);
+	close(_fd);
+#endif
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+using std::string;
+
+// Read only view of a whole file through the OS file mapping. Pages come in as they're touched, nothing is copied
+// into a buffer of ours first.
+class MappedFile
+{
+public:
+	MappedFile(const string &filePath);
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const unsigned char *getData();
+	size_t getSize();
+
+	~MappedFile();
+private:
+	const unsigned char *_data{ nullptr };
+	size_t _size{ 0 };
+	// Kept as plain pointers and ints so the OS headers stay out of here.
+	void *_file{ nullptr };
+	void *_mapping{ nullptr };
+	int _fd{ -1 };
+};
@@ -1,18 +1,35 @@
 #include "Mesh.h"
 
+#include <algorithm>
+
 Mesh::Mesh() {
 }
 
 Mesh::Mesh(VkPhysicalDevice physicalDevice, VkDevice device,
-	VkQueue transferQueue, VkCommandPool transferCommandPool,
+	UploadScheduler &uploadScheduler,
 	vector<Vertex> *vertices, vector<uint32_t> *indices,
 	int newTexId) : _texId(newTexId) {
 	_vertexCount = vertices->size();
 	_indexCount = indices->size();
 	_physicalDevice = physicalDevice;
 	_device = device;
-	createVertexBuffer(transferQueue, transferCommandPool, vertices);
-	createIndexBuffer(transferQueue, transferCommandPool, indices);
+
+	// Box center, then the furthest vertex from it.
+	if (!vertices->empty()) {
+		glm::vec3 boundsMin{ (*vertices)[0].pos };
+		glm::vec3 boundsMax{ (*vertices)[0].pos };
+		for (const auto &vertex : *vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
+		}
+		_boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		for (const auto &vertex : *vertices) {
+			_boundsRadius = std::max(_boundsRadius, glm::length(vertex.pos - _boundsCenter));
+		}
+	}
+
+	createVertexBuffer(uploadScheduler, vertices);
+	createIndexBuffer(uploadScheduler, indices);
 
 	_model.model = glm::mat4(1.0f);
 }
@@ -37,6 +54,18 @@ int Mesh::getTexId() {
 	return _texId;
 }
 
+void Mesh::setTexId(int texId) {
+	_texId = texId;
+}
+
+glm::vec3 Mesh::getBoundsCenter() {
+	return _boundsCenter;
+}
+
+float Mesh::getBoundsRadius() {
+	return _boundsRadius;
+}
+
 VkBuffer Mesh::getVertexBuffer() {
 	return _vertexBuffer;
 }
@@ -55,7 +84,7 @@ void Mesh::destroyBuffers() {
 Mesh::~Mesh() {
 }
 
-void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, vector<Vertex> *vertices) {
+void Mesh::createVertexBuffer(UploadScheduler &uploadScheduler, vector<Vertex> *vertices) {
 	// Get size of buffer needed for vertices.
 	VkDeviceSize bufferSize = sizeof(Vertex) * vertices->size();
 
@@ -87,14 +116,17 @@ void Mesh::createVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
 
 	// Graphics family per vulkan standard should include a transfer family.
 
-	// Copy staging buffer to vertex buffer on GPU.
-	copyBuffer(_device, transferQueue, transferCommandPool, stagingBuffer, _vertexBuffer, bufferSize);
-
-	vkDestroyBuffer(_device, stagingBuffer, nullptr);
-	vkFreeMemory(_device, stagingBufMem, nullptr);
+	// Copy staging buffer to vertex buffer on GPU, over as many frames as it takes. Staging goes once it's landed.
+	vector<UploadScheduler::Step> steps;
+	UploadScheduler::addBufferCopy(steps, stagingBuffer, 0, _vertexBuffer, bufferSize);
+	VkDevice device{ _device };
+	uploadScheduler.enqueue(steps, [device, stagingBuffer, stagingBufMem]() {
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufMem, nullptr);
+	});
 }
 
-void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, vector<uint32_t> *indices) {
+void Mesh::createIndexBuffer(UploadScheduler &uploadScheduler, vector<uint32_t> *indices) {
 	// Get size of buffer needed for indices.
 	VkDeviceSize bufferSize{ sizeof(uint32_t) * indices->size() };
 
@@ -121,8 +153,11 @@ void Mesh::createIndexBuffer(VkQueue transferQueue, VkCommandPool transferComman
 		&_indexBuffer, &_indexBufferMemory);
 
 	// Copy staging buffer to index buffer on GPU.
-	copyBuffer(_device, transferQueue, transferCommandPool, stagingBuffer, _indexBuffer, bufferSize);
-
-	vkDestroyBuffer(_device, stagingBuffer, nullptr);
-	vkFreeMemory(_device, stagingBufMem, nullptr);
+	vector<UploadScheduler::Step> steps;
+	UploadScheduler::addBufferCopy(steps, stagingBuffer, 0, _indexBuffer, bufferSize);
+	VkDevice device{ _device };
+	uploadScheduler.enqueue(steps, [device, stagingBuffer, stagingBufMem]() {
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufMem, nullptr);
+	});
 }
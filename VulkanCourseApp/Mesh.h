@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "Utilities.h"
+#include "UploadScheduler.h"
 
 using std::vector;
 
@@ -17,8 +18,9 @@ class Mesh
 {
 public:
 	Mesh();
+	// Buffers are filled by the upload scheduler, they're only usable once its last batch has landed.
 	Mesh(VkPhysicalDevice physicalDevice, VkDevice device, 
-		VkQueue transferQueue, VkCommandPool transferCommandPool, 
+		UploadScheduler &uploadScheduler, 
 		vector<Vertex> *vertices, vector<uint32_t> *indices,
 		int newTexId);
 
@@ -28,6 +30,11 @@ public:
 	int getVertexCount();
 	int getIndexCount();
 	int getTexId();
+	// Texture streaming moves textures to new array elements.
+	void setTexId(int texId);
+	// Sphere around the vertices, in model space.
+	glm::vec3 getBoundsCenter();
+	float getBoundsRadius();
 	VkBuffer getVertexBuffer();
 	VkBuffer getIndexBuffer();
 
@@ -37,6 +44,8 @@ public:
 private:
 	int _vertexCount;
 	int _texId;
+	glm::vec3 _boundsCenter{ 0.0f };
+	float _boundsRadius{ 0.0f };
 	VkBuffer _vertexBuffer;
 	VkDeviceMemory _vertexBufferMemory;
 	VkPhysicalDevice _physicalDevice;
@@ -49,7 +58,7 @@ private:
 
 	Model _model;
 
-	void createVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, vector<Vertex> *vertices);
-	void createIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, vector<uint32_t> *indices);
+	void createVertexBuffer(UploadScheduler &uploadScheduler, vector<Vertex> *vertices);
+	void createIndexBuffer(UploadScheduler &uploadScheduler, vector<uint32_t> *indices);
 };
 
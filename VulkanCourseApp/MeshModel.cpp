@@ -6,7 +6,6 @@ MeshModel::MeshModel() {
 
 MeshModel::MeshModel(vector<Mesh> meshes) {
 	_meshes = meshes;
-	_model = glm::mat4(1.0f);
 }
 
 MeshModel::~MeshModel() {
@@ -23,12 +22,20 @@ Mesh *MeshModel::getMesh(size_t index) {
 	return &_meshes[index];
 }
 
-glm::mat4 MeshModel::getModel() {
-	return _model;
+vector<TextureHandle> MeshModel::getTextures() {
+	return _textures;
 }
 
-void MeshModel::setModel(glm::mat4 model) {
-	_model = model;
+void MeshModel::setTextures(vector<TextureHandle> textures) {
+	_textures = textures;
+}
+
+uint64_t MeshModel::getUploadBatch() {
+	return _uploadBatch;
+}
+
+void MeshModel::setUploadBatch(uint64_t uploadBatch) {
+	_uploadBatch = uploadBatch;
 }
 
 void MeshModel::destroyMeshModel() {
@@ -86,21 +93,41 @@ vector<string> MeshModel::LoadMaterials(const aiScene *scene) {
 	return textures;
 }
 
-std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice physDev, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, aiNode *node, const aiScene *scene, vector<int> matToTex) {
-	vector<Mesh> meshes;
+vector<bool> MeshModel::FindTiledMaterials(const aiScene *scene) {
+	// A little past the edge still counts as inside, exporters round.
+	const float epsilon{ 0.001f };
+	vector<bool> tiled(scene->mNumMaterials, false);
+	for (size_t i{ 0 }; i < scene->mNumMeshes; i++) {
+		const aiMesh *mesh{ scene->mMeshes[i] };
+		if (!mesh->mTextureCoords[0] || tiled[mesh->mMaterialIndex]) {
+			continue;
+		}
+		for (size_t j{ 0 }; j < mesh->mNumVertices; j++) {
+			const aiVector3D &uv{ mesh->mTextureCoords[0][j] };
+			if (uv.x < -epsilon || uv.x > 1.0f + epsilon || uv.y < -epsilon || uv.y > 1.0f + epsilon) {
+				tiled[mesh->mMaterialIndex] = true;
+				break;
+			}
+		}
+	}
+	return tiled;
+}
+
+vector<MeshModel::MeshData> MeshModel::LoadNode(aiNode *node, const aiScene *scene) {
+	vector<MeshData> meshes;
 	// Go through each mesh at this node and create it, then add it to our meshes.
 	for (size_t i{ 0 }; i < node->mNumMeshes; i++) {
 		// Load mesh here.
 		uint32_t meshId{ node->mMeshes[i] };
 		meshes.push_back(
-			LoadMesh(physDev, device, transferQueue, transferCommandPool, scene->mMeshes[meshId], scene, matToTex)
+			LoadMesh(scene->mMeshes[meshId], scene)
 		);
 	}
 
 	// Go through each node attached to this node and append their meshes to this node's mesh list.
 	for (size_t i{ 0 }; i < node->mNumChildren; i++) {
-		vector<Mesh> newMeshes{
-			LoadNode(physDev, device, transferQueue, transferCommandPool, node->mChildren[i], scene, matToTex)
+		vector<MeshData> newMeshes{
+			LoadNode(node->mChildren[i], scene)
 		};
 
 		meshes.insert(meshes.end(), newMeshes.begin(), newMeshes.end());
@@ -109,9 +136,12 @@ std::vector<Mesh> MeshModel::LoadNode(VkPhysicalDevice physDev, VkDevice device,
 	return meshes;
 }
 
-Mesh MeshModel::LoadMesh(VkPhysicalDevice physDev, VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, aiMesh *mesh, const aiScene *scene, vector<int> matToTex) {
-	vector<Vertex> vertices(mesh->mNumVertices);
-	vector<uint32_t> indices;
+MeshModel::MeshData MeshModel::LoadMesh(aiMesh *mesh, const aiScene *scene) {
+	MeshData meshData{};
+	meshData.materialIndex = mesh->mMaterialIndex;
+	vector<Vertex> &vertices{ meshData.vertices };
+	vector<uint32_t> &indices{ meshData.indices };
+	vertices.resize(mesh->mNumVertices);
 
 	// Go through each vertex and copy it across to our vertices.
 	for (size_t i{ 0 }; i < mesh->mNumVertices; i++) {
@@ -138,6 +168,13 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice physDev, VkDevice device, VkQueue tran
 			vertices[i].col = { 1.0f, 1.0f, 1.0f };
 		}
 
+		// Set normal (generated on import if the file has none, points lines/points have none at all).
+		if (mesh->mNormals) {
+			vertices[i].norm = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
+		}
+		else {
+			vertices[i].norm = { 0.0f, 0.0f, 1.0f };
+		}
 	}
 
 	// Iterate over indices through faces and copy across.
@@ -151,12 +188,26 @@ Mesh MeshModel::LoadMesh(VkPhysicalDevice physDev, VkDevice device, VkQueue tran
 		}
 	}
 
-	// Create new mesh with details and return it.
-	Mesh newMesh{
-		physDev, device, transferQueue, transferCommandPool, &vertices, &indices, matToTex[mesh->mMaterialIndex]
-	};
+	return meshData;
+}
+
+vector<Mesh> MeshModel::CreateMeshes(VkPhysicalDevice physDev, VkDevice device, UploadScheduler &uploadScheduler,
+	vector<MeshData> &meshData, vector<int> matToTex, vector<glm::vec4> matToUv) {
+	vector<Mesh> meshes;
+	for (auto &data : meshData) {
+		// Into the texture's spot when it's packed in an atlas.
+		const glm::vec4 uvTransform{ matToUv[data.materialIndex] };
+		for (auto &vertex : data.vertices) {
+			vertex.tex = {
+				uvTransform.x + vertex.tex.x * uvTransform.z, uvTransform.y + vertex.tex.y * uvTransform.w
+			};
+		}
 
-	// Return new mesh.
-	return newMesh;
+		// Create new mesh with details.
+		meshes.push_back(Mesh{
+			physDev, device, uploadScheduler, &data.vertices, &data.indices, matToTex[data.materialIndex]
+		});
+	}
+	return meshes;
 }
 
@@ -6,8 +6,14 @@
 #include <assimp/scene.h>
 
 #include "Mesh.h"
+#include "TextureCache.h"
 using std::vector;
 
+// How a model file is brought in, see VulkanRenderer::createMeshModel.
+struct ModelImportOptions {
+	bool atlasTextures{ false }; // Pack small textures into shared pages, see TextureAtlas.
+};
+
 class MeshModel
 {
 public:
@@ -18,19 +24,33 @@ public:
 	size_t getMeshCount();
 	Mesh *getMesh(size_t index);
 
-	glm::mat4 getModel();
-	void setModel(glm::mat4 model);
+	// Textures loaded for its materials, released along with it.
+	vector<TextureHandle> getTextures();
+	void setTextures(vector<TextureHandle> textures);
+	// Last upload batch it needs, it's drawn once that's complete.
+	uint64_t getUploadBatch();
+	void setUploadBatch(uint64_t uploadBatch);
 
 	void destroyMeshModel();
 
 	static vector<string> LoadMaterials(const aiScene *scene);
-	static std::vector<Mesh> LoadNode(VkPhysicalDevice physDev, VkDevice device, VkQueue transferQueue,
-		VkCommandPool transferCommandPool, aiNode *node, const aiScene *scene, vector<int> matToTex);
-	static Mesh LoadMesh(VkPhysicalDevice physDev, VkDevice device, VkQueue transferQueue,
-		VkCommandPool transferCommandPool, aiMesh *mesh, const aiScene *scene, vector<int> matToTex);
+	// Materials used by a mesh with UVs outside 0-1, those rely on repeat addressing.
+	static vector<bool> FindTiledMaterials(const aiScene *scene);
+	// A mesh as read from the scene, nothing on the GPU yet so it can be loaded on any thread.
+	struct MeshData {
+		vector<Vertex> vertices;
+		vector<uint32_t> indices;
+		uint32_t materialIndex;
+	};
+	static vector<MeshData> LoadNode(aiNode *node, const aiScene *scene);
+	static MeshData LoadMesh(aiMesh *mesh, const aiScene *scene);
+	// matToUv takes each material's UVs to where its texture is, offset in xy and scale in zw.
+	static vector<Mesh> CreateMeshes(VkPhysicalDevice physDev, VkDevice device, UploadScheduler &uploadScheduler,
+		vector<MeshData> &meshData, vector<int> matToTex, vector<glm::vec4> matToUv);
 
 private:
 	vector<Mesh> _meshes;
-	glm::mat4 _model;
+	vector<TextureHandle> _textures;
+	uint64_t _uploadBatch{ 0 };
 };
 
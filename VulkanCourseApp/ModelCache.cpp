@@ -0,0 +1,67 @@
+#include "ModelCache.h"
+
+ModelCache::ModelCache() {
+}
+
+AssetHandle ModelCache::find(const string &path) {
+	auto it{ _byPath.find(path) };
+	return it != _byPath.end() ? it->second : AssetHandle{};
+}
+
+AssetHandle ModelCache::findByContent(uint64_t contentHash) {
+	auto it{ _byContent.find(contentHash) };
+	return it != _byContent.end() ? it->second : AssetHandle{};
+}
+
+bool ModelCache::contains(AssetHandle asset) {
+	return _assets.contains(asset);
+}
+
+AssetHandle ModelCache::add(const string &path, uint64_t contentHash, const MeshModel &meshModel) {
+	AssetHandle asset{ _assets.insert({ meshModel, contentHash, { path }, 0 }) };
+	_byPath[path] = asset;
+	_byContent[contentHash] = asset;
+	return asset;
+}
+
+void ModelCache::addPath(AssetHandle asset, const string &path) {
+	_assets.at(asset).paths.push_back(path);
+	_byPath[path] = asset;
+}
+
+void ModelCache::acquire(AssetHandle asset) {
+	_assets.at(asset).refCount++;
+}
+
+bool ModelCache::release(AssetHandle asset) {
+	ModelAsset &entry{ _assets.at(asset) };
+	if (entry.refCount == 0) {
+		throw std::runtime_error("Released a model asset with no references, index=" + std::to_string(asset.index));
+	}
+	return --entry.refCount == 0;
+}
+
+MeshModel ModelCache::remove(AssetHandle asset) {
+	ModelAsset entry{ _assets.at(asset) };
+	for (const auto &path : entry.paths) {
+		_byPath.erase(path);
+	}
+	_byContent.erase(entry.contentHash);
+	_assets.erase(asset);
+	return entry.meshModel;
+}
+
+MeshModel &ModelCache::get(AssetHandle asset) {
+	return _assets.at(asset).meshModel;
+}
+
+size_t ModelCache::getAssetCount() {
+	return _assets.size();
+}
+
+SlotMap<ModelAsset> &ModelCache::getAssets() {
+	return _assets;
+}
+
+ModelCache::~ModelCache() {
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "MeshModel.h"
+
+using std::vector;
+using std::string;
+
+// Loaded model file, shared by every instance of it.
+struct ModelAsset {
+	MeshModel meshModel;
+	uint64_t contentHash;
+	vector<string> paths; // Normalized paths it's been loaded under.
+	uint32_t refCount;
+};
+
+typedef Handle<ModelAsset> AssetHandle;
+
+// One placement of an asset in the scene, what a ModelHandle refers to.
+struct ModelInstance {
+	AssetHandle asset;
+	glm::mat4 model;
+};
+
+// Model files already on the GPU, keyed by normalized path and by content hash. Loading one again only adds a
+// reference, the geometry is destroyed once the last reference goes.
+class ModelCache
+{
+public:
+	ModelCache();
+
+	// Stale (default) handle when it isn't loaded.
+	AssetHandle find(const string &path);
+	AssetHandle findByContent(uint64_t contentHash);
+	bool contains(AssetHandle asset);
+
+	// Starts with no references, acquire it.
+	AssetHandle add(const string &path, uint64_t contentHash, const MeshModel &meshModel);
+	// Another path for content that's already loaded.
+	void addPath(AssetHandle asset, const string &path);
+
+	void acquire(AssetHandle asset);
+	// True when that was the last reference, it's then up to the caller to remove it.
+	bool release(AssetHandle asset);
+	// Drops it from the cache, the geometry is handed back for destroying.
+	MeshModel remove(AssetHandle asset);
+
+	MeshModel &get(AssetHandle asset);
+	size_t getAssetCount();
+	// For destroying whatever is left at shutdown.
+	SlotMap<ModelAsset> &getAssets();
+
+	~ModelCache();
+private:
+	SlotMap<ModelAsset> _assets;
+	std::unordered_map<string, AssetHandle> _byPath;
+	std::unordered_map<uint64_t, AssetHandle> _byContent;
+};
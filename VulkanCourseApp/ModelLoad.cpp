@@ -0,0 +1,53 @@
+#include "ModelLoad.h"
+
+ModelLoad::ModelLoad() {
+}
+
+ModelLoad::ModelLoad(std::shared_ptr<ModelLoadState> state) {
+	_state = state;
+}
+
+bool ModelLoad::isDone() {
+	if (!_state) {
+		throw std::runtime_error("Model load has no state");
+	}
+	return _state->stage != ModelLoadState::Stage::Importing && _state->stage != ModelLoadState::Stage::Uploading;
+}
+
+ModelHandle ModelLoad::get() {
+	if (!isDone()) {
+		throw std::runtime_error("Model load not finished, modelFile=" + _state->modelFile);
+	}
+	if (_state->stage == ModelLoadState::Stage::Cancelled) {
+		throw std::runtime_error("Model load cancelled, modelFile=" + _state->modelFile);
+	}
+	if (_state->stage == ModelLoadState::Stage::Failed) {
+		std::lock_guard<std::mutex> lock(_state->errorMutex);
+		throw std::runtime_error("Failed to load model=" + _state->modelFile + ": " + _state->error);
+	}
+	return _state->model;
+}
+
+void ModelLoad::cancel() {
+	if (!isDone()) {
+		_state->cancelRequested = true;
+	}
+}
+
+bool ModelLoad::await_ready() {
+	return isDone();
+}
+
+void ModelLoad::await_suspend(std::coroutine_handle<> continuation) {
+	if (_state->continuation) {
+		throw std::runtime_error("Model load already awaited, modelFile=" + _state->modelFile);
+	}
+	_state->continuation = continuation;
+}
+
+ModelHandle ModelLoad::await_resume() {
+	return get();
+}
+
+ModelLoad::~ModelLoad() {
+}
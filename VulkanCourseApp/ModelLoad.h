@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <coroutine>
+
+#include <glm/glm.hpp>
+
+#include "Utilities.h"
+#include "MeshModel.h"
+#include "TextureDecoder.h"
+
+using std::vector;
+using std::string;
+
+// A model file read into memory, everything it needs from the GPU still to be made. Nothing in it touches the
+// device, so it can be built on any thread, see VulkanRenderer::importModel.
+struct ModelImport {
+	vector<string> textureNames; // Per material, empty for none.
+	vector<MeshModel::MeshData> meshes;
+
+	// Small textures packed together, pages on the heap, and where each packed file went.
+	struct AtlasPlacement {
+		uint32_t page;
+		glm::vec4 uvTransform; // See TextureAtlas::getUvTransform.
+	};
+	vector<TextureDecoder::Image> atlasPages;
+	std::unordered_map<string, AtlasPlacement> atlasPlacements;
+
+	// The other textures when they were decoded ahead, anything left out is loaded when the model is created.
+	struct DecodedTexture {
+		string fileName;
+		uint64_t contentHash; // 0 without content hashing.
+		TextureDecoder::Image image;
+	};
+	vector<DecodedTexture> textures;
+};
+
+// Shared by a ModelLoad, the worker jobs importing its file, and the renderer finishing it.
+struct ModelLoadState {
+	enum class Stage {
+		Importing, // On the workers.
+		Uploading, // Created, waiting for its copies to land.
+		Done,
+		Failed,
+		Cancelled
+	};
+
+	string modelFile;
+	ModelImportOptions options;
+	std::atomic<bool> cancelRequested{ false };
+	// Worker jobs still running for it, the last one to finish hands it back to the renderer.
+	std::atomic<uint32_t> pendingJobs{ 1 };
+
+	// Written by the workers until they hand it back.
+	uint64_t contentHash{ 0 };
+	ModelImport modelImport;
+	std::mutex errorMutex;
+	string error; // Empty unless it failed.
+
+	// Render thread only.
+	Stage stage{ Stage::Importing };
+	ModelHandle model;
+	std::coroutine_handle<> continuation; // Resumed once it's done.
+};
+
+// A model loading in the background, from VulkanRenderer::createMeshModelAsync. Either poll it or co_await it,
+// it finishes during a draw() and an awaiting coroutine is resumed there, on the render thread. The model is
+// drawn from then on.
+class ModelLoad
+{
+public:
+	ModelLoad();
+	ModelLoad(std::shared_ptr<ModelLoadState> state);
+
+	// Done, failed or cancelled.
+	bool isDone();
+	// Throws unless it's done and succeeded.
+	ModelHandle get();
+	// Stops it at its next step, a model it already created is destroyed again. No effect once it's done.
+	void cancel();
+
+	// Awaitable, by one coroutine at a time. Resumes with the model, or throws what get would.
+	bool await_ready();
+	void await_suspend(std::coroutine_handle<> continuation);
+	ModelHandle await_resume();
+
+	~ModelLoad();
+
+private:
+	std::shared_ptr<ModelLoadState> _state;
+};
@@ -0,0 +1,1208 @@
+#include "RenderGraph.h"
+
+#include <map>
+
+RenderGraph::RenderGraph() {
+}
+
+RenderGraph::RenderGraph(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount) {
+	_physicalDevice = physicalDevice;
+	_device = device;
+	_frameCount = frameCount;
+}
+
+void RenderGraph::setQueueFamilies(uint32_t graphicsFamily, int computeFamily) {
+	_graphicsFamily = graphicsFamily;
+	_computeFamily = computeFamily;
+
+	// Timestamps need to be supported on the queue family each pass is submitted to.
+	uint32_t queueFamilyCount{ 0 };
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, nullptr);
+	vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	auto timestampMask{ [](uint32_t validBits) -> uint64_t {
+		return validBits == 0 ? 0 : validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+	} };
+	_graphicsTimestampMask = timestampMask(queueFamilies[graphicsFamily].timestampValidBits);
+	_computeTimestampMask = computeFamily >= 0 ? timestampMask(queueFamilies[computeFamily].timestampValidBits) : 0;
+
+	VkPhysicalDeviceProperties deviceProps{};
+	vkGetPhysicalDeviceProperties(_physicalDevice, &deviceProps);
+	_timestampPeriod = deviceProps.limits.timestampPeriod;
+}
+
+int RenderGraph::addImage(const string &name, VkFormat format, bool depth) {
+	Image image{};
+	image.name = name;
+	image.format = format;
+	image.depth = depth;
+	_images.push_back(image);
+	return static_cast<int>(_images.size() - 1);
+}
+
+int RenderGraph::importSwapchain(const string &name, VkFormat format) {
+	// Swapchain is the graph output, anything that doesn't end up in it gets culled.
+	Image image{};
+	image.name = name;
+	image.format = format;
+	image.imported = true;
+	_images.push_back(image);
+	return static_cast<int>(_images.size() - 1);
+}
+
+int RenderGraph::importBuffer(const string &name) {
+	_buffers.push_back(name);
+	return static_cast<int>(_buffers.size() - 1);
+}
+
+int RenderGraph::addPass(const string &name, RecordFunc record) {
+	Pass pass{};
+	pass.name = name;
+	pass.record = record;
+	_passes.push_back(pass);
+	return static_cast<int>(_passes.size() - 1);
+}
+
+int RenderGraph::addComputePass(const string &name, RecordFunc record, bool async) {
+	Pass pass{};
+	pass.name = name;
+	pass.record = record;
+	pass.compute = true;
+	pass.async = async;
+	_passes.push_back(pass);
+	return static_cast<int>(_passes.size() - 1);
+}
+
+void RenderGraph::writeColor(int pass, int image, bool clear, VkClearValue clearValue) {
+	_passes[pass].accesses.push_back({ image, Access::ColorWrite, clear, clearValue, VK_NULL_HANDLE });
+}
+
+void RenderGraph::writeDepth(int pass, int image, bool clear, VkClearValue clearValue) {
+	_passes[pass].accesses.push_back({ image, Access::DepthWrite, clear, clearValue, VK_NULL_HANDLE });
+}
+
+void RenderGraph::writeStorage(int pass, int image) {
+	_passes[pass].accesses.push_back({ image, Access::StorageWrite, false, {}, VK_NULL_HANDLE });
+}
+
+void RenderGraph::readInput(int pass, int image) {
+	_passes[pass].accesses.push_back({ image, Access::InputRead, false, {}, VK_NULL_HANDLE });
+}
+
+void RenderGraph::readSampled(int pass, int image, VkSampler sampler) {
+	_passes[pass].accesses.push_back({ image, Access::SampledRead, false, {}, sampler });
+}
+
+void RenderGraph::writeBuffer(int pass, int buffer) {
+	_passes[pass].bufferWrites.push_back(buffer);
+}
+
+void RenderGraph::readBuffer(int pass, int buffer) {
+	_passes[pass].bufferReads.push_back(buffer);
+}
+
+int RenderGraph::addRenderArea(ExtentFunc renderArea) {
+	_renderAreas.push_back(renderArea);
+	return static_cast<int>(_renderAreas.size() - 1);
+}
+
+void RenderGraph::setRenderArea(int pass, int area) {
+	_passes[pass].area = area;
+}
+
+void RenderGraph::setSecondaryContents(int pass) {
+	_passes[pass].secondary = true;
+}
+
+void RenderGraph::compile() {
+	cullPasses();
+	groupPasses();
+
+	// Lifetimes in render passes, and usage from every access.
+	for (auto &image : _images) {
+		image.firstGroup = -1;
+		image.lastGroup = -1;
+		image.usage = 0;
+		image.async = false;
+	}
+	for (const auto &pass : _passes) {
+		if (pass.culled) {
+			continue;
+		}
+		for (const auto &access : pass.accesses) {
+			Image &image{ _images[access.image] };
+			if (image.firstGroup < 0) {
+				image.firstGroup = pass.group;
+			}
+			image.lastGroup = pass.group;
+
+			image.async = image.async || _groups[pass.group].async;
+
+			switch (access.access) {
+			case Access::ColorWrite: image.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+			case Access::DepthWrite: image.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+			case Access::StorageWrite: image.usage |= VK_IMAGE_USAGE_STORAGE_BIT; break;
+			case Access::InputRead: image.usage |= VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT; break;
+			case Access::SampledRead: image.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+			}
+		}
+	}
+
+	// Never leaving one render pass means it never needs to be in memory, tiled GPUs keep it on chip.
+	for (auto &image : _images) {
+		image.transient = !image.imported && image.firstGroup >= 0 && image.firstGroup == image.lastGroup
+			&& !(image.usage & (VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT));
+		if (image.transient) {
+			image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+	}
+
+	// In execution order, each one leaves images in the layouts the next expects.
+	for (size_t i{ 0 }; i < _groups.size(); i++) {
+		if (_groups[i].compute) {
+			createComputeBarriers(_groups[i]);
+		}
+		else {
+			createRenderPass(_groups[i], static_cast<int>(i));
+		}
+	}
+
+	// New segment every time work moves to the other queue.
+	_segments.clear();
+	for (size_t i{ 0 }; i < _groups.size(); i++) {
+		if (_segments.empty() || _segments.back().async != _groups[i].async) {
+			_segments.push_back(Segment{});
+			_segments.back().async = _groups[i].async;
+		}
+		_segments.back().groups.push_back(static_cast<int>(i));
+	}
+
+	createDescriptorSetLayouts();
+	createQueryPool();
+}
+
+void RenderGraph::cullPasses() {
+	// Walk backwards from the outputs, a pass is only needed if something needed reads what it writes.
+	set<int> needed;
+	set<int> neededBuffers;
+	for (size_t i{ 0 }; i < _images.size(); i++) {
+		if (_images[i].imported) {
+			needed.insert(static_cast<int>(i));
+		}
+	}
+
+	for (int p{ static_cast<int>(_passes.size()) - 1 }; p >= 0; p--) {
+		Pass &pass{ _passes[p] };
+		pass.culled = true;
+		for (const auto &access : pass.accesses) {
+			if (isWrite(access.access) && needed.count(access.image)) {
+				pass.culled = false;
+			}
+		}
+		for (int buffer : pass.bufferWrites) {
+			if (neededBuffers.count(buffer)) {
+				pass.culled = false;
+			}
+		}
+
+		if (!pass.culled) {
+			for (const auto &access : pass.accesses) {
+				if (!isWrite(access.access)) {
+					needed.insert(access.image);
+				}
+			}
+			neededBuffers.insert(pass.bufferReads.begin(), pass.bufferReads.end());
+		}
+	}
+}
+
+void RenderGraph::groupPasses() {
+	_groups.clear();
+	_hasCompute = false;
+	set<int> writtenInGroup;
+	set<int> buffersWrittenInGroup;
+	for (size_t p{ 0 }; p < _passes.size(); p++) {
+		Pass &pass{ _passes[p] };
+		if (pass.culled) {
+			continue;
+		}
+
+		// Sampling can read any pixel, so whatever wrote it has to have finished its render pass.
+		// Render area is per render pass, and compute passes don't run in one at all.
+		bool newGroup{ _groups.empty() || pass.compute || _groups.back().compute || pass.area != _groups.back().area };
+		for (const auto &access : pass.accesses) {
+			if (access.access == Access::SampledRead && writtenInGroup.count(access.image)) {
+				newGroup = true;
+			}
+		}
+		// Same for buffers, a shader can read any part of them.
+		for (int buffer : pass.bufferReads) {
+			if (buffersWrittenInGroup.count(buffer)) {
+				newGroup = true;
+			}
+		}
+
+		if (newGroup) {
+			_groups.push_back(Group{});
+			_groups.back().area = pass.area;
+			_groups.back().compute = pass.compute;
+			_groups.back().async = pass.async && _computeFamily >= 0;
+			writtenInGroup.clear();
+			buffersWrittenInGroup.clear();
+		}
+		buffersWrittenInGroup.insert(pass.bufferWrites.begin(), pass.bufferWrites.end());
+		_hasCompute = _hasCompute || pass.compute;
+
+		Group &group{ _groups.back() };
+		pass.group = static_cast<int>(_groups.size() - 1);
+		pass.subpass = static_cast<uint32_t>(group.passes.size());
+		group.passes.push_back(static_cast<int>(p));
+
+		for (const auto &access : pass.accesses) {
+			if (isWrite(access.access)) {
+				writtenInGroup.insert(access.image);
+			}
+			if (isAttachment(access.access)
+				&& std::find(group.attachments.begin(), group.attachments.end(), access.image) == group.attachments.end()) {
+				group.attachments.push_back(access.image);
+				group.hasSwapchain = group.hasSwapchain || _images[access.image].imported;
+			}
+		}
+	}
+}
+
+void RenderGraph::createRenderPass(Group &group, int groupIndex) {
+	// Does a later render pass read this image? Then it has to be stored.
+	auto readLater{ [&](int image, Access kind) {
+		for (const auto &pass : _passes) {
+			if (pass.culled || pass.group <= groupIndex) {
+				continue;
+			}
+			for (const auto &access : pass.accesses) {
+				if (access.image == image && access.access == kind) {
+					return true;
+				}
+			}
+		}
+		return false;
+	} };
+
+	// ATTACHMENTS
+	vector<VkAttachmentDescription> attachmentDescs(group.attachments.size());
+	group.clearValues.assign(group.attachments.size(), VkClearValue{});
+
+	for (size_t a{ 0 }; a < group.attachments.size(); a++) {
+		const int imageIndex{ group.attachments[a] };
+		Image &image{ _images[imageIndex] };
+
+		// First and last use of the image inside this render pass.
+		const PassAccess *firstAccess{ nullptr };
+		VkImageLayout lastLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		for (int p : group.passes) {
+			for (const auto &access : _passes[p].accesses) {
+				if (access.image != imageIndex || !isAttachment(access.access)) {
+					continue;
+				}
+				if (firstAccess == nullptr) {
+					firstAccess = &access;
+				}
+				lastLayout = getAttachmentLayout(image, access.access);
+			}
+		}
+
+		VkAttachmentDescription &desc{ attachmentDescs[a] };
+		desc.format = image.format;
+		desc.samples = VK_SAMPLE_COUNT_1_BIT;
+		desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+		// Clear if asked, keep if an earlier render pass made it and it's read first, otherwise don't care (pass covers it all).
+		if (isWrite(firstAccess->access) && firstAccess->clear) {
+			desc.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			group.clearValues[a] = firstAccess->clearValue;
+		}
+		else if (!isWrite(firstAccess->access) && image.firstGroup < groupIndex) {
+			desc.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		}
+		else {
+			desc.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		}
+		desc.initialLayout = desc.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? image.readLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+		// Store only what's presented or read by a later render pass.
+		const bool sampledLater{ readLater(imageIndex, Access::SampledRead) };
+		const bool neededLater{ image.imported || sampledLater || readLater(imageIndex, Access::InputRead) };
+		desc.storeOp = neededLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+		if (image.imported) {
+			desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		}
+		else if (sampledLater) {
+			desc.finalLayout = image.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		}
+		else {
+			desc.finalLayout = lastLayout;
+		}
+		image.readLayout = desc.finalLayout;
+	}
+
+	// SUBPASSES
+	// References need to stay alive until the render pass is created.
+	const size_t subpassCount{ group.passes.size() };
+	vector<vector<VkAttachmentReference>> colorRefs(subpassCount);
+	vector<vector<VkAttachmentReference>> inputRefs(subpassCount);
+	vector<VkAttachmentReference> depthRefs(subpassCount);
+	vector<vector<uint32_t>> preserves(subpassCount);
+	vector<VkSubpassDescription> subpasses(subpassCount);
+
+	auto attachmentIndex{ [&](int image) {
+		return static_cast<uint32_t>(std::find(group.attachments.begin(), group.attachments.end(), image) - group.attachments.begin());
+	} };
+
+	for (size_t s{ 0 }; s < subpassCount; s++) {
+		const Pass &pass{ _passes[group.passes[s]] };
+		bool hasDepth{ false };
+		for (const auto &access : pass.accesses) {
+			if (!isAttachment(access.access)) {
+				continue;
+			}
+			VkAttachmentReference ref{};
+			ref.attachment = attachmentIndex(access.image);
+			ref.layout = getAttachmentLayout(_images[access.image], access.access);
+
+			switch (access.access) {
+			case Access::ColorWrite: colorRefs[s].push_back(ref); break;
+			case Access::DepthWrite: depthRefs[s] = ref; hasDepth = true; break;
+			case Access::InputRead: inputRefs[s].push_back(ref); break;
+			default: break;
+			}
+		}
+
+		subpasses[s].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpasses[s].colorAttachmentCount = static_cast<uint32_t>(colorRefs[s].size());
+		subpasses[s].pColorAttachments = colorRefs[s].data();
+		subpasses[s].inputAttachmentCount = static_cast<uint32_t>(inputRefs[s].size());
+		subpasses[s].pInputAttachments = inputRefs[s].data();
+		subpasses[s].pDepthStencilAttachment = hasDepth ? &depthRefs[s] : nullptr;
+	}
+
+	// Attachments used before and after a subpass that doesn't touch them must be preserved through it.
+	for (size_t a{ 0 }; a < group.attachments.size(); a++) {
+		size_t first{ subpassCount }, last{ 0 };
+		vector<bool> used(subpassCount, false);
+		for (size_t s{ 0 }; s < subpassCount; s++) {
+			for (const auto &access : _passes[group.passes[s]].accesses) {
+				if (access.image == group.attachments[a] && isAttachment(access.access)) {
+					used[s] = true;
+					first = std::min(first, s);
+					last = std::max(last, s);
+				}
+			}
+		}
+		for (size_t s{ first + 1 }; s < last; s++) {
+			if (!used[s]) {
+				preserves[s].push_back(static_cast<uint32_t>(a));
+			}
+		}
+	}
+	for (size_t s{ 0 }; s < subpassCount; s++) {
+		subpasses[s].preserveAttachmentCount = static_cast<uint32_t>(preserves[s].size());
+		subpasses[s].pPreserveAttachments = preserves[s].data();
+	}
+
+	// DEPENDENCIES
+	// What a previous use has to finish (src) and what the next use waits on (dst).
+	auto srcStage{ [](Access access) -> VkPipelineStageFlags {
+		switch (access) {
+		case Access::ColorWrite: return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+		case Access::DepthWrite: return VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		default: return VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		}
+	} };
+	auto srcAccess{ [](Access access) -> VkAccessFlags {
+		switch (access) {
+		case Access::ColorWrite: return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		case Access::DepthWrite: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		default: return 0; // Read after read / write after read only need execution order.
+		}
+	} };
+	auto dstAccess{ [](Access access) -> VkAccessFlags {
+		switch (access) {
+		case Access::ColorWrite: return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		case Access::DepthWrite: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		case Access::InputRead: return VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+		default: return VK_ACCESS_SHADER_READ_BIT;
+		}
+	} };
+
+	// Anything before this render pass: last frame's use of the same images, aliased images, swapchain acquire.
+	// Compute passes on the same queue read and write images outside render passes too.
+	const VkPipelineStageFlags externalStages{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+		| VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+		| (_hasCompute ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : 0) };
+	const VkAccessFlags externalWrites{ VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| (_hasCompute ? VK_ACCESS_SHADER_WRITE_BIT : 0) };
+
+	std::map<std::pair<uint32_t, uint32_t>, VkSubpassDependency> dependencies;
+	auto addDependency{ [&](uint32_t src, uint32_t dst, VkPipelineStageFlags srcStages, VkAccessFlags srcAccesses,
+		VkPipelineStageFlags dstStages, VkAccessFlags dstAccesses, bool byRegion) {
+		VkSubpassDependency &dep{ dependencies[{ src, dst }] };
+		dep.srcSubpass = src;
+		dep.dstSubpass = dst;
+		dep.srcStageMask |= srcStages;
+		dep.srcAccessMask |= srcAccesses;
+		dep.dstStageMask |= dstStages;
+		dep.dstAccessMask |= dstAccesses;
+		if (byRegion) {
+			dep.dependencyFlags |= VK_DEPENDENCY_BY_REGION_BIT;
+		}
+	} };
+
+	for (size_t a{ 0 }; a < group.attachments.size(); a++) {
+		int lastSubpass{ -1 };
+		Access lastAccess{ Access::InputRead };
+		for (size_t s{ 0 }; s < subpassCount; s++) {
+			for (const auto &access : _passes[group.passes[s]].accesses) {
+				if (access.image != group.attachments[a] || !isAttachment(access.access)) {
+					continue;
+				}
+				const uint32_t subpass{ static_cast<uint32_t>(s) };
+				if (lastSubpass < 0) {
+					// First use waits on everything outside, including the layout transition.
+					addDependency(VK_SUBPASS_EXTERNAL, subpass, externalStages, externalWrites,
+						srcStage(access.access), dstAccess(access.access), false);
+				}
+				else if (lastSubpass != static_cast<int>(s) && (isWrite(lastAccess) || isWrite(access.access))) {
+					// Input attachments read the same pixel, so it only has to wait for its own region.
+					addDependency(static_cast<uint32_t>(lastSubpass), subpass, srcStage(lastAccess), srcAccess(lastAccess),
+						srcStage(access.access), dstAccess(access.access), true);
+				}
+				lastSubpass = static_cast<int>(s);
+				lastAccess = access.access;
+			}
+		}
+
+		// Later render passes (or next frame) read or overwrite it after the last use.
+		addDependency(static_cast<uint32_t>(lastSubpass), VK_SUBPASS_EXTERNAL, srcStage(lastAccess), srcAccess(lastAccess),
+			externalStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+			| VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+			| externalWrites, false);
+	}
+
+	// Buffers are written outside the render pass (or in another one), subpasses reading them wait on that.
+	// Writes from inside it are made visible to whatever comes after.
+	for (size_t s{ 0 }; s < subpassCount; s++) {
+		const Pass &pass{ _passes[group.passes[s]] };
+		const uint32_t subpass{ static_cast<uint32_t>(s) };
+		if (!pass.bufferReads.empty() || !pass.bufferWrites.empty()) {
+			addDependency(VK_SUBPASS_EXTERNAL, subpass, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+				| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, false);
+		}
+		if (!pass.bufferWrites.empty()) {
+			addDependency(subpass, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				VK_ACCESS_SHADER_WRITE_BIT, externalStages | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+				VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, false);
+		}
+	}
+
+	vector<VkSubpassDependency> subpassDependencies;
+	for (const auto &dep : dependencies) {
+		subpassDependencies.push_back(dep.second);
+	}
+
+	// Create info for render pass.
+	VkRenderPassCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	createInfo.attachmentCount = static_cast<uint32_t>(attachmentDescs.size());
+	createInfo.pAttachments = attachmentDescs.data();
+	createInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	createInfo.pSubpasses = subpasses.data();
+	createInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+	createInfo.pDependencies = subpassDependencies.data();
+
+	if (vkCreateRenderPass(_device, &createInfo, nullptr, &group.renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a render graph render pass.");
+	}
+}
+
+void RenderGraph::createComputeBarriers(Group &group) {
+	// Async passes are ordered against the graphics queue by semaphores, they only need to wait on earlier compute work.
+	const VkPipelineStageFlags srcStages{ group.async ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		: VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+		| VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT };
+	const VkAccessFlags srcAccess{ group.async ? VK_ACCESS_SHADER_WRITE_BIT
+		: VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+
+	for (const auto &access : _passes[group.passes[0]].accesses) {
+		Image &image{ _images[access.image] };
+
+		ComputeBarrier barrier{};
+		barrier.image = access.image;
+		barrier.srcStages = srcStages;
+		barrier.srcAccess = srcAccess;
+		if (access.access == Access::StorageWrite) {
+			// Whole image gets rewritten, so whatever was in it (or in an aliased image) is dropped.
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.dstAccess = VK_ACCESS_SHADER_WRITE_BIT;
+			image.readLayout = VK_IMAGE_LAYOUT_GENERAL; // Sampling works in GENERAL, later readers take it as is.
+		}
+		else {
+			// Already in a sampleable layout, left there by whoever wrote it.
+			barrier.oldLayout = image.readLayout;
+			barrier.newLayout = image.readLayout;
+			barrier.dstAccess = VK_ACCESS_SHADER_READ_BIT;
+		}
+		group.barriers.push_back(barrier);
+	}
+
+	// Buffers aren't tracked per writer, one global barrier covers them all.
+	const Pass &pass{ _passes[group.passes[0]] };
+	if (!pass.bufferReads.empty() || !pass.bufferWrites.empty()) {
+		ComputeBarrier barrier{};
+		barrier.image = -1;
+		barrier.srcStages = srcStages | (group.async ? 0 : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+		barrier.srcAccess = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		group.barriers.push_back(barrier);
+	}
+}
+
+void RenderGraph::createDescriptorSetLayouts() {
+	for (auto &pass : _passes) {
+		if (pass.culled) {
+			continue;
+		}
+
+		// One binding per read or storage write, in the order they were declared.
+		vector<VkDescriptorSetLayoutBinding> bindings;
+		for (const auto &access : pass.accesses) {
+			if (!isDescriptor(access.access)) {
+				continue;
+			}
+			VkDescriptorSetLayoutBinding binding{};
+			binding.binding = static_cast<uint32_t>(bindings.size());
+			binding.descriptorType = getDescriptorType(access.access);
+			binding.descriptorCount = 1;
+			binding.stageFlags = pass.compute ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+			bindings.push_back(binding);
+		}
+
+		if (bindings.empty()) {
+			continue;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+		layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+		layoutCreateInfo.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(_device, &layoutCreateInfo, nullptr, &pass.setLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a render graph descriptor set layout.");
+		}
+
+		// Sets are rewritten on every swapchain rebuild, from a packed array of image infos.
+		vector<VkDescriptorUpdateTemplateEntry> templateEntries(bindings.size());
+		for (size_t b{ 0 }; b < bindings.size(); b++) {
+			templateEntries[b].dstBinding = bindings[b].binding;
+			templateEntries[b].dstArrayElement = 0;
+			templateEntries[b].descriptorCount = 1;
+			templateEntries[b].descriptorType = bindings[b].descriptorType;
+			templateEntries[b].offset = b * sizeof(VkDescriptorImageInfo);
+			templateEntries[b].stride = sizeof(VkDescriptorImageInfo);
+		}
+
+		VkDescriptorUpdateTemplateCreateInfo templateCreateInfo{};
+		templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateCreateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+		templateCreateInfo.pDescriptorUpdateEntries = templateEntries.data();
+		templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateCreateInfo.descriptorSetLayout = pass.setLayout;
+
+		if (vkCreateDescriptorUpdateTemplate(_device, &templateCreateInfo, nullptr, &pass.updateTemplate) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a render graph descriptor update template.");
+		}
+	}
+}
+
+void RenderGraph::createQueryPool() {
+	// No timestamps on the graphics queue, no timings at all. Passes on a compute queue without them just go untimed.
+	_timingCount = 0;
+	for (auto &pass : _passes) {
+		pass.timing = -1;
+		pass.gpuTimeMs = 0.0f;
+		// Timestamps can't go in the primary inside a subpass of secondaries.
+		if (pass.culled || pass.secondary || _graphicsTimestampMask == 0 || (_groups[pass.group].async && _computeTimestampMask == 0)) {
+			continue;
+		}
+		pass.timing = static_cast<int>(_timingCount++);
+	}
+
+	if (_timingCount == 0) {
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo{};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = _timingCount * 2 * _frameCount;
+
+	if (vkCreateQueryPool(_device, &queryPoolCreateInfo, nullptr, &_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a render graph timestamp query pool.");
+	}
+	_timingsRecorded.assign(_frameCount, false);
+}
+
+void RenderGraph::createResources(VkExtent2D extent, const vector<SwapchainImage> &swapchainImages) {
+	_extent = extent;
+	_swapchainImageCount = swapchainImages.size();
+
+	createImages();
+	createFramebuffers(swapchainImages);
+	createDescriptorSets();
+}
+
+void RenderGraph::createImages() {
+	// Create the images first, aliasing needs their memory requirements.
+	vector<VkMemoryRequirements> memReqs(_images.size());
+	vector<int> order;
+	for (size_t i{ 0 }; i < _images.size(); i++) {
+		Image &image{ _images[i] };
+		if (image.imported || image.firstGroup < 0) {
+			continue;
+		}
+
+		image.images.resize(_frameCount);
+		image.views.resize(_frameCount);
+		for (uint32_t frame{ 0 }; frame < _frameCount; frame++) {
+			VkImageCreateInfo imageCreateInfo{};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.extent.width = _extent.width;
+			imageCreateInfo.extent.height = _extent.height;
+			imageCreateInfo.extent.depth = 1;
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.format = image.format;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.usage = image.usage;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			// Shared with the async compute queue. Concurrent saves ownership transfers on both queues.
+			const uint32_t queueFamilies[]{ _graphicsFamily, static_cast<uint32_t>(_computeFamily) };
+			if (image.async && _computeFamily >= 0 && static_cast<uint32_t>(_computeFamily) != _graphicsFamily) {
+				imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+				imageCreateInfo.queueFamilyIndexCount = 2;
+				imageCreateInfo.pQueueFamilyIndices = queueFamilies;
+			}
+
+			if (vkCreateImage(_device, &imageCreateInfo, nullptr, &image.images[frame]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a render graph image.");
+			}
+		}
+		vkGetImageMemoryRequirements(_device, image.images[0], &memReqs[i]);
+		order.push_back(static_cast<int>(i));
+	}
+
+	// Give each image the first slot whose images are all done before it starts. Images in one render pass always overlap.
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return _images[a].firstGroup < _images[b].firstGroup; });
+	_aliasSlots.clear();
+	for (int i : order) {
+		Image &image{ _images[i] };
+		image.aliasSlot = -1;
+		for (size_t s{ 0 }; s < _aliasSlots.size(); s++) {
+			AliasSlot &slot{ _aliasSlots[s] };
+			if (slot.lastGroup < image.firstGroup && slot.transient == image.transient
+				&& (slot.memoryTypeBits & memReqs[i].memoryTypeBits) != 0) {
+				image.aliasSlot = static_cast<int>(s);
+				break;
+			}
+		}
+		if (image.aliasSlot < 0) {
+			_aliasSlots.push_back(AliasSlot{});
+			_aliasSlots.back().transient = image.transient;
+			image.aliasSlot = static_cast<int>(_aliasSlots.size() - 1);
+		}
+
+		AliasSlot &slot{ _aliasSlots[image.aliasSlot] };
+		slot.lastGroup = image.lastGroup;
+		slot.size = std::max(slot.size, memReqs[i].size);
+		slot.memoryTypeBits &= memReqs[i].memoryTypeBits;
+	}
+
+	// Allocate each slot once per frame in flight.
+	for (auto &slot : _aliasSlots) {
+		VkMemoryPropertyFlags memPropFlags{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT };
+		if (slot.transient && hasMemoryType(_physicalDevice, slot.memoryTypeBits, memPropFlags | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+			memPropFlags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		}
+
+		VkMemoryAllocateInfo memAllocInfo{};
+		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memAllocInfo.allocationSize = slot.size;
+		memAllocInfo.memoryTypeIndex = findMemoryTypeIndex(_physicalDevice, slot.memoryTypeBits, memPropFlags);
+
+		slot.memory.resize(_frameCount);
+		for (uint32_t frame{ 0 }; frame < _frameCount; frame++) {
+			if (vkAllocateMemory(_device, &memAllocInfo, nullptr, &slot.memory[frame]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate render graph memory.");
+			}
+		}
+	}
+
+	// Bind every image to the start of its slot and create its view.
+	for (int i : order) {
+		Image &image{ _images[i] };
+		for (uint32_t frame{ 0 }; frame < _frameCount; frame++) {
+			if (vkBindImageMemory(_device, image.images[frame], _aliasSlots[image.aliasSlot].memory[frame], 0) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to bind render graph image memory.");
+			}
+
+			VkImageViewCreateInfo viewCreateInfo{};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.image = image.images[frame];
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = image.format;
+			viewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+			viewCreateInfo.subresourceRange.aspectMask = image.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+			viewCreateInfo.subresourceRange.baseMipLevel = 0;
+			viewCreateInfo.subresourceRange.levelCount = 1;
+			viewCreateInfo.subresourceRange.baseArrayLayer = 0;
+			viewCreateInfo.subresourceRange.layerCount = 1;
+
+			if (vkCreateImageView(_device, &viewCreateInfo, nullptr, &image.views[frame]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a render graph image view.");
+			}
+		}
+	}
+}
+
+void RenderGraph::createFramebuffers(const vector<SwapchainImage> &swapchainImages) {
+	for (auto &group : _groups) {
+		if (group.compute) {
+			continue;
+		}
+
+		// Drawing to the swapchain needs one per swapchain image for each frame in flight.
+		const size_t imageCount{ group.hasSwapchain ? swapchainImages.size() : 1 };
+		group.framebuffers.resize(_frameCount * imageCount);
+
+		for (uint32_t frame{ 0 }; frame < _frameCount; frame++) {
+			for (size_t swapchainIndex{ 0 }; swapchainIndex < imageCount; swapchainIndex++) {
+				vector<VkImageView> attachments;
+				for (int image : group.attachments) {
+					attachments.push_back(_images[image].imported
+						? swapchainImages[swapchainIndex].imageView : _images[image].views[frame]);
+				}
+
+				VkFramebufferCreateInfo info{};
+				info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+				info.renderPass = group.renderPass;
+				info.attachmentCount = static_cast<uint32_t>(attachments.size());
+				info.pAttachments = attachments.data();
+				info.width = _extent.width;
+				info.height = _extent.height;
+				info.layers = 1;
+
+				if (vkCreateFramebuffer(_device, &info, nullptr, &group.framebuffers[frame * imageCount + swapchainIndex]) != VK_SUCCESS) {
+					throw std::runtime_error("Failed to create a render graph frame buffer.");
+				}
+			}
+		}
+	}
+}
+
+void RenderGraph::createDescriptorSets() {
+	// Size the pool from every descriptor of every live pass.
+	std::map<VkDescriptorType, uint32_t> descriptorCounts;
+	uint32_t setCount{ 0 };
+	for (const auto &pass : _passes) {
+		if (pass.culled || pass.setLayout == VK_NULL_HANDLE) {
+			continue;
+		}
+		setCount += _frameCount;
+		for (const auto &access : pass.accesses) {
+			if (isDescriptor(access.access)) {
+				descriptorCounts[getDescriptorType(access.access)] += _frameCount;
+			}
+		}
+	}
+
+	if (setCount == 0) {
+		return;
+	}
+
+	vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto &count : descriptorCounts) {
+		poolSizes.push_back({ count.first, count.second });
+	}
+
+	VkDescriptorPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = setCount;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a render graph descriptor pool.");
+	}
+
+	for (auto &pass : _passes) {
+		if (pass.culled || pass.setLayout == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		pass.descSets.resize(_frameCount);
+		vector<VkDescriptorSetLayout> setLayouts(_frameCount, pass.setLayout);
+
+		VkDescriptorSetAllocateInfo setAllocInfo{};
+		setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		setAllocInfo.descriptorPool = _descPool;
+		setAllocInfo.descriptorSetCount = _frameCount;
+		setAllocInfo.pSetLayouts = setLayouts.data();
+
+		if (vkAllocateDescriptorSets(_device, &setAllocInfo, pass.descSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate render graph descriptor sets.");
+		}
+
+		for (uint32_t frame{ 0 }; frame < _frameCount; frame++) {
+			vector<VkDescriptorImageInfo> imageInfos;
+			for (const auto &access : pass.accesses) {
+				if (!isDescriptor(access.access)) {
+					continue;
+				}
+				const Image &image{ _images[access.image] };
+
+				// Layout matches the subpass reference for input attachments, where the producer left it for sampling,
+				// or GENERAL for storage.
+				VkDescriptorImageInfo imageInfo{};
+				imageInfo.imageView = image.views[frame];
+				imageInfo.sampler = access.sampler;
+				switch (access.access) {
+				case Access::InputRead: imageInfo.imageLayout = getAttachmentLayout(image, Access::InputRead); break;
+				case Access::StorageWrite: imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL; break;
+				default: imageInfo.imageLayout = image.readLayout; break;
+				}
+				imageInfos.push_back(imageInfo);
+			}
+
+			vkUpdateDescriptorSetWithTemplate(_device, pass.descSets[frame], pass.updateTemplate, imageInfos.data());
+		}
+	}
+}
+
+uint32_t RenderGraph::getSegmentCount() {
+	return static_cast<uint32_t>(_segments.size());
+}
+
+bool RenderGraph::isAsyncSegment(uint32_t segment) {
+	return _segments[segment].async;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, uint32_t segment, uint32_t frame, uint32_t imageIndex) {
+	// Reset the frame's queries before any pass writes them, later segments wait on this one.
+	if (segment == 0 && _queryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(commandBuffer, _queryPool, frame * _timingCount * 2, _timingCount * 2);
+		_timingsRecorded[frame] = true;
+	}
+
+	for (int g : _segments[segment].groups) {
+		const Group &group{ _groups[g] };
+
+		if (group.compute) {
+			vector<VkImageMemoryBarrier> imageBarriers;
+			vector<VkMemoryBarrier> memoryBarriers;
+			VkPipelineStageFlags srcStages{ 0 };
+			for (const auto &barrier : group.barriers) {
+				srcStages |= barrier.srcStages;
+				if (barrier.image < 0) {
+					VkMemoryBarrier memoryBarrier{};
+					memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+					memoryBarrier.srcAccessMask = barrier.srcAccess;
+					memoryBarrier.dstAccessMask = barrier.dstAccess;
+					memoryBarriers.push_back(memoryBarrier);
+					continue;
+				}
+				const Image &image{ _images[barrier.image] };
+
+				VkImageMemoryBarrier imageBarrier{};
+				imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+				imageBarrier.oldLayout = barrier.oldLayout;
+				imageBarrier.newLayout = barrier.newLayout;
+				imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				imageBarrier.image = image.images[frame];
+				imageBarrier.subresourceRange.aspectMask = image.depth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+				imageBarrier.subresourceRange.baseMipLevel = 0;
+				imageBarrier.subresourceRange.levelCount = 1;
+				imageBarrier.subresourceRange.baseArrayLayer = 0;
+				imageBarrier.subresourceRange.layerCount = 1;
+				imageBarrier.srcAccessMask = barrier.srcAccess;
+				imageBarrier.dstAccessMask = barrier.dstAccess;
+				imageBarriers.push_back(imageBarrier);
+			}
+
+			if (!group.barriers.empty()) {
+				vkCmdPipelineBarrier(commandBuffer, srcStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+					static_cast<uint32_t>(memoryBarriers.size()), memoryBarriers.data(), 0, nullptr,
+					static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+			}
+
+			const Pass &pass{ _passes[group.passes[0]] };
+			cmdBeginTiming(commandBuffer, pass, frame);
+			pass.record(commandBuffer, frame, imageIndex);
+			cmdEndTiming(commandBuffer, pass, frame);
+			continue;
+		}
+
+		const VkExtent2D renderArea{ getRenderArea(group.area) };
+
+		VkRenderPassBeginInfo renderPassBeginInfo{};
+		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassBeginInfo.renderPass = group.renderPass;
+		renderPassBeginInfo.framebuffer = getFramebuffer(group, frame, imageIndex);
+		renderPassBeginInfo.renderArea.offset = { 0, 0 };
+		renderPassBeginInfo.renderArea.extent = renderArea;
+		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(group.clearValues.size());
+		renderPassBeginInfo.pClearValues = group.clearValues.data();
+
+		for (size_t s{ 0 }; s < group.passes.size(); s++) {
+			const Pass &pass{ _passes[group.passes[s]] };
+			const VkSubpassContents contents{ pass.secondary ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE };
+			if (s == 0) {
+				vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, contents);
+			} else {
+				vkCmdNextSubpass(commandBuffer, contents);
+			}
+
+			// Only vkCmdExecuteCommands is allowed here, the secondaries carry the rest.
+			if (pass.secondary) {
+				pass.record(commandBuffer, frame, imageIndex);
+				continue;
+			}
+
+			// Pipelines use dynamic viewport/scissor, cover the render area.
+			VkViewport viewport{};
+			viewport.x = 0.0f;
+			viewport.y = 0.0f;
+			viewport.width = (float)renderArea.width;
+			viewport.height = (float)renderArea.height;
+			viewport.minDepth = 0.0f;
+			viewport.maxDepth = 1.0f;
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+			VkRect2D scissor{};
+			scissor.offset = { 0, 0 };
+			scissor.extent = renderArea;
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+			// Subpasses of one render pass overlap on tiled GPUs, their times are only a rough split.
+			cmdBeginTiming(commandBuffer, pass, frame);
+			pass.record(commandBuffer, frame, imageIndex);
+			cmdEndTiming(commandBuffer, pass, frame);
+		}
+
+		vkCmdEndRenderPass(commandBuffer);
+	}
+}
+
+void RenderGraph::updateTimings(uint32_t frame) {
+	if (_queryPool == VK_NULL_HANDLE || !_timingsRecorded[frame]) {
+		return;
+	}
+
+	// Frame's last submit has completed, so the results are already available and this won't stall.
+	for (auto &pass : _passes) {
+		if (pass.timing < 0) {
+			continue;
+		}
+
+		uint64_t timestamps[2]{};
+		const uint32_t firstQuery{ (frame * _timingCount + static_cast<uint32_t>(pass.timing)) * 2 };
+		if (vkGetQueryPoolResults(_device, _queryPool, firstQuery, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+			continue;
+		}
+
+		const uint64_t mask{ _groups[pass.group].async ? _computeTimestampMask : _graphicsTimestampMask };
+		pass.gpuTimeMs = static_cast<float>((timestamps[1] - timestamps[0]) & mask) * _timestampPeriod / 1000000.0f;
+	}
+}
+
+vector<PassTiming> RenderGraph::getTimings() {
+	vector<PassTiming> timings;
+	for (const auto &pass : _passes) {
+		if (!pass.culled) {
+			timings.push_back({ pass.name, pass.gpuTimeMs });
+		}
+	}
+	return timings;
+}
+
+bool RenderGraph::isCulled(int pass) {
+	return _passes[pass].culled;
+}
+
+VkRenderPass RenderGraph::getRenderPass(int pass) {
+	return _groups[_passes[pass].group].renderPass;
+}
+
+uint32_t RenderGraph::getSubpass(int pass) {
+	return _passes[pass].subpass;
+}
+
+VkCommandBufferInheritanceInfo RenderGraph::getInheritanceInfo(int pass, uint32_t frame, uint32_t imageIndex) {
+	const Group &group{ _groups[_passes[pass].group] };
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = group.renderPass;
+	inheritanceInfo.subpass = _passes[pass].subpass;
+	inheritanceInfo.framebuffer = getFramebuffer(group, frame, imageIndex);
+	return inheritanceInfo;
+}
+
+VkExtent2D RenderGraph::getPassExtent(int pass) {
+	return getRenderArea(_groups[_passes[pass].group].area);
+}
+
+VkDescriptorSetLayout RenderGraph::getDescriptorSetLayout(int pass) {
+	return _passes[pass].setLayout;
+}
+
+VkDescriptorSet RenderGraph::getDescriptorSet(int pass, uint32_t frame) {
+	return _passes[pass].descSets[frame];
+}
+
+VkDeviceSize RenderGraph::getAllocatedBytes() {
+	VkDeviceSize bytes{ 0 };
+	for (const auto &slot : _aliasSlots) {
+		bytes += slot.size * slot.memory.size();
+	}
+	return bytes;
+}
+
+void RenderGraph::destroyResources() {
+	if (_descPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(_device, _descPool, nullptr);
+		_descPool = VK_NULL_HANDLE;
+	}
+	for (auto &pass : _passes) {
+		pass.descSets.clear();
+	}
+
+	for (auto &group : _groups) {
+		for (auto framebuffer : group.framebuffers) {
+			vkDestroyFramebuffer(_device, framebuffer, nullptr);
+		}
+		group.framebuffers.clear();
+	}
+
+	for (auto &image : _images) {
+		for (size_t i{ 0 }; i < image.images.size(); i++) {
+			vkDestroyImageView(_device, image.views[i], nullptr);
+			vkDestroyImage(_device, image.images[i], nullptr);
+		}
+		image.images.clear();
+		image.views.clear();
+	}
+
+	for (auto &slot : _aliasSlots) {
+		for (auto memory : slot.memory) {
+			vkFreeMemory(_device, memory, nullptr);
+		}
+	}
+	_aliasSlots.clear();
+}
+
+void RenderGraph::destroy() {
+	destroyResources();
+
+	if (_queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(_device, _queryPool, nullptr);
+		_queryPool = VK_NULL_HANDLE;
+	}
+
+	for (auto &pass : _passes) {
+		if (pass.updateTemplate != VK_NULL_HANDLE) {
+			vkDestroyDescriptorUpdateTemplate(_device, pass.updateTemplate, nullptr);
+		}
+		if (pass.setLayout != VK_NULL_HANDLE) {
+			vkDestroyDescriptorSetLayout(_device, pass.setLayout, nullptr);
+		}
+	}
+	for (auto &group : _groups) {
+		if (group.renderPass != VK_NULL_HANDLE) {
+			vkDestroyRenderPass(_device, group.renderPass, nullptr);
+		}
+	}
+
+	_passes.clear();
+	_images.clear();
+	_buffers.clear();
+	_renderAreas.clear();
+	_groups.clear();
+	_segments.clear();
+}
+
+RenderGraph::~RenderGraph() {
+}
+
+bool RenderGraph::isWrite(Access access) {
+	return access == Access::ColorWrite || access == Access::DepthWrite || access == Access::StorageWrite;
+}
+
+bool RenderGraph::isAttachment(Access access) {
+	return access == Access::ColorWrite || access == Access::DepthWrite || access == Access::InputRead;
+}
+
+bool RenderGraph::isDescriptor(Access access) {
+	return access == Access::InputRead || access == Access::SampledRead || access == Access::StorageWrite;
+}
+
+VkDescriptorType RenderGraph::getDescriptorType(Access access) {
+	switch (access) {
+	case Access::InputRead: return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+	case Access::StorageWrite: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	default: return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	}
+}
+
+VkExtent2D RenderGraph::getRenderArea(int area) {
+	return area >= 0 ? _renderAreas[area]() : _extent;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(const Group &group, uint32_t frame, uint32_t imageIndex) {
+	const size_t imageCount{ group.hasSwapchain ? _swapchainImageCount : 1 };
+	return group.framebuffers[frame * imageCount + (group.hasSwapchain ? imageIndex : 0)];
+}
+
+void RenderGraph::cmdBeginTiming(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t frame) {
+	if (pass.timing >= 0) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool,
+			(frame * _timingCount + static_cast<uint32_t>(pass.timing)) * 2);
+	}
+}
+
+void RenderGraph::cmdEndTiming(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t frame) {
+	if (pass.timing >= 0) {
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool,
+			(frame * _timingCount + static_cast<uint32_t>(pass.timing)) * 2 + 1);
+	}
+}
+
+VkImageLayout RenderGraph::getAttachmentLayout(const Image &image, Access access) {
+	switch (access) {
+	case Access::ColorWrite: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	case Access::DepthWrite: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	case Access::InputRead: return image.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	default: return image.readLayout;
+	}
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <set>
+#include <functional>
+#include <algorithm>
+
+#include "Utilities.h"
+
+using std::vector;
+using std::string;
+using std::set;
+
+// GPU time of one pass, from timestamps around its commands.
+struct PassTiming {
+	string name;
+	float gpuTimeMs;
+};
+
+// Frame described as passes reading and writing images. compile() works out the rest:
+// - Culls passes whose outputs nothing reads.
+// - Merges passes into subpasses of one render pass unless a pass samples something written in it.
+// - Load/store ops and layouts from who reads an image next, subpass dependencies between users.
+// - Images only used inside one render pass are transient, images whose lifetimes don't overlap share memory.
+// - A descriptor set per pass for everything it reads or stores to, bindings in the order they were declared.
+// - Barriers for compute passes, and segments split wherever work moves between the graphics and async compute queue.
+// - Buffers are only tracked for ordering, passes using them get memory barriers/dependencies against their writers.
+class RenderGraph
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex)> RecordFunc;
+	typedef std::function<VkExtent2D()> ExtentFunc;
+
+	RenderGraph();
+	RenderGraph(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount);
+
+	// Without a separate compute family (computeFamily < 0) async passes run on the graphics queue.
+	void setQueueFamilies(uint32_t graphicsFamily, int computeFamily);
+
+	// - Declare resources. Graph images are swapchain sized, one per frame in flight.
+	int addImage(const string &name, VkFormat format, bool depth);
+	int importSwapchain(const string &name, VkFormat format);
+	int importBuffer(const string &name); // Owned by the caller, along with its descriptors.
+
+	// - Declare passes, in execution order.
+	int addPass(const string &name, RecordFunc record);
+	int addComputePass(const string &name, RecordFunc record, bool async);
+	// Without clear the pass must write every pixel, previous contents are dropped.
+	void writeColor(int pass, int image, bool clear, VkClearValue clearValue = {});
+	void writeDepth(int pass, int image, bool clear, VkClearValue clearValue = {});
+	void writeStorage(int pass, int image); // Compute only, contents are dropped too.
+	void readInput(int pass, int image); // Same pixel only, as an input attachment.
+	void readSampled(int pass, int image, VkSampler sampler);
+	void writeBuffer(int pass, int buffer); // Shader storage writes.
+	void readBuffer(int pass, int buffer); // Shader storage/uniform reads.
+	// Passes default to the full extent. Only passes on the same area share a render pass.
+	int addRenderArea(ExtentFunc renderArea);
+	void setRenderArea(int pass, int area);
+	// Graphics pass whose subpass only executes secondary command buffers. Its record func gets the primary buffer,
+	// the secondaries inherit getInheritanceInfo and set their own viewport/scissor. Such passes aren't timed.
+	void setSecondaryContents(int pass);
+
+	// - Build. compile only depends on formats, resources depend on the swapchain size.
+	void compile();
+	void createResources(VkExtent2D extent, const vector<SwapchainImage> &swapchainImages);
+
+	// - Record. Each segment is submitted on its own, chained with semaphores, async ones to the compute queue.
+	uint32_t getSegmentCount();
+	bool isAsyncSegment(uint32_t segment);
+	void execute(VkCommandBuffer commandBuffer, uint32_t segment, uint32_t frame, uint32_t imageIndex);
+
+	// - Timings. Read back once the frame's last submit has completed.
+	void updateTimings(uint32_t frame);
+	vector<PassTiming> getTimings();
+
+	bool isCulled(int pass);
+	VkRenderPass getRenderPass(int pass);
+	uint32_t getSubpass(int pass);
+	VkCommandBufferInheritanceInfo getInheritanceInfo(int pass, uint32_t frame, uint32_t imageIndex);
+	VkExtent2D getPassExtent(int pass);
+	VkDescriptorSetLayout getDescriptorSetLayout(int pass);
+	VkDescriptorSet getDescriptorSet(int pass, uint32_t frame);
+	VkDeviceSize getAllocatedBytes(); // Device memory for graph images after aliasing, all frames.
+
+	void destroyResources();
+	void destroy();
+
+	~RenderGraph();
+private:
+	enum class Access { ColorWrite, DepthWrite, StorageWrite, InputRead, SampledRead };
+
+	struct PassAccess {
+		int image;
+		Access access;
+		bool clear;
+		VkClearValue clearValue;
+		VkSampler sampler;
+	};
+
+	struct Pass {
+		string name;
+		RecordFunc record;
+		int area{ -1 };
+		bool compute{ false };
+		bool async{ false };
+		bool secondary{ false };
+		vector<PassAccess> accesses;
+		vector<int> bufferWrites;
+		vector<int> bufferReads;
+		bool culled{ false };
+		int group{ -1 };
+		uint32_t subpass{ 0 };
+		int timing{ -1 }; // Index of its timestamp pair, -1 if its queue can't write timestamps.
+		float gpuTimeMs{ 0.0f };
+		VkDescriptorSetLayout setLayout{ VK_NULL_HANDLE };
+		VkDescriptorUpdateTemplate updateTemplate{ VK_NULL_HANDLE }; // Writes the set from image infos in binding order.
+		vector<VkDescriptorSet> descSets; // Per frame in flight.
+	};
+
+	struct Image {
+		string name;
+		VkFormat format;
+		bool depth{ false };
+		bool imported{ false };
+		VkImageUsageFlags usage{ 0 };
+		bool transient{ false };
+		bool async{ false }; // Used on the async compute queue, so shared between queue families.
+		int firstGroup{ -1 };
+		int lastGroup{ -1 };
+		VkImageLayout readLayout{ VK_IMAGE_LAYOUT_UNDEFINED }; // Layout it's left in for later sampled reads.
+		int aliasSlot{ -1 };
+		vector<VkImage> images; // Per frame in flight.
+		vector<VkImageView> views;
+	};
+
+	// Barrier recorded before a compute pass, image is picked per frame. A global memory barrier for buffers when image is -1.
+	struct ComputeBarrier {
+		int image;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		VkPipelineStageFlags srcStages;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+	};
+
+	// One VkRenderPass, each pass is a subpass. Or a single compute pass and its barriers.
+	struct Group {
+		vector<int> passes;
+		int area{ -1 };
+		bool compute{ false };
+		bool async{ false };
+		vector<int> attachments;
+		vector<VkClearValue> clearValues;
+		bool hasSwapchain{ false };
+		VkRenderPass renderPass{ VK_NULL_HANDLE };
+		vector<VkFramebuffer> framebuffers; // Per frame, times swapchain image count if it draws to the swapchain.
+		vector<ComputeBarrier> barriers;
+	};
+
+	// Run of groups submitted to one queue.
+	struct Segment {
+		vector<int> groups;
+		bool async{ false };
+	};
+
+	// Memory shared by images whose lifetimes don't overlap.
+	struct AliasSlot {
+		int lastGroup{ -1 };
+		bool transient{ false };
+		VkDeviceSize size{ 0 };
+		uint32_t memoryTypeBits{ ~0u };
+		vector<VkDeviceMemory> memory; // Per frame in flight.
+	};
+
+	VkPhysicalDevice _physicalDevice;
+	VkDevice _device;
+	uint32_t _frameCount{ 0 };
+	VkExtent2D _extent{};
+	size_t _swapchainImageCount{ 0 };
+	uint32_t _graphicsFamily{ 0 };
+	int _computeFamily{ -1 };
+	bool _hasCompute{ false }; // Render pass dependencies then also have to cover compute work outside them.
+
+	vector<Pass> _passes;
+	vector<Image> _images;
+	vector<string> _buffers;
+	vector<ExtentFunc> _renderAreas;
+	vector<Group> _groups;
+	vector<Segment> _segments;
+	vector<AliasSlot> _aliasSlots;
+	VkDescriptorPool _descPool{ VK_NULL_HANDLE };
+
+	// Timestamps, a begin/end pair per pass for each frame in flight.
+	VkQueryPool _queryPool{ VK_NULL_HANDLE };
+	uint32_t _timingCount{ 0 };
+	float _timestampPeriod{ 1.0f };
+	uint64_t _graphicsTimestampMask{ 0 };
+	uint64_t _computeTimestampMask{ 0 };
+	vector<bool> _timingsRecorded; // Frame's command buffers write them. Stays set, they're submitted again without re-recording.
+
+	void cullPasses();
+	void groupPasses();
+	void createRenderPass(Group &group, int groupIndex);
+	void createComputeBarriers(Group &group);
+	void createQueryPool();
+	void createDescriptorSetLayouts();
+	void createImages();
+	void createFramebuffers(const vector<SwapchainImage> &swapchainImages);
+	void createDescriptorSets();
+	bool isWrite(Access access);
+	bool isAttachment(Access access);
+	bool isDescriptor(Access access);
+	VkDescriptorType getDescriptorType(Access access);
+	VkExtent2D getRenderArea(int area);
+	VkFramebuffer getFramebuffer(const Group &group, uint32_t frame, uint32_t imageIndex);
+	void cmdBeginTiming(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t frame);
+	void cmdEndTiming(VkCommandBuffer commandBuffer, const Pass &pass, uint32_t frame);
+	VkImageLayout getAttachmentLayout(const Image &image, Access access);
+};
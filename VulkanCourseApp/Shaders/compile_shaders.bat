@@ -5,5 +5,9 @@ C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -V shader.vert
 C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -V shader.frag
 C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o second_vert.spv -V second.vert
 C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o second_frag.spv -V second.frag
+C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o upscale_frag.spv -V upscale.frag
+C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o second_comp.spv -V second.comp
+C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o deferred_frag.spv -V deferred.frag
+C:/VulkanSDK/1.2.141.2/Bin32/glslangValidator.exe -o light_cull_comp.spv -V light_cull.comp
 
 pause
\ No newline at end of file
@@ -0,0 +1,77 @@
+#version 450
+
+// Must match Utilities.h.
+const uint TILE_SIZE = 16;
+const uint MAX_LIGHTS_PER_TILE = 128;
+const vec3 AMBIENT = vec3(0.15);
+
+// G-buffer from subpass 0.
+layout(input_attachment_index = 0, set = 0, binding = 0) uniform subpassInput inputAlbedo;
+layout(input_attachment_index = 1, set = 0, binding = 1) uniform subpassInput inputNormal;
+layout(input_attachment_index = 2, set = 0, binding = 2) uniform subpassInput inputDepth;
+
+struct PointLight {
+    vec3 position; // View space.
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Lights {
+    PointLight lights[];
+};
+
+// Per tile: light count, then MAX_LIGHTS_PER_TILE light indices.
+layout(std430, set = 1, binding = 1) readonly buffer LightTiles {
+    uint tileData[];
+};
+
+layout(push_constant) uniform PushLighting {
+    vec4 projParams; // proj[0][0], proj[1][1], proj[2][2], proj[3][2].
+    vec2 extent;
+    uvec2 tileCount;
+    uint lightCount;
+} pushLighting;
+
+layout(location = 0) out vec4 color;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec4 albedo = subpassLoad(inputAlbedo);
+    float depth = subpassLoad(inputDepth).r;
+
+    // Nothing drawn here, keep the clear color.
+    if(depth >= 1.0) {
+        color = albedo;
+        return;
+    }
+
+    // View space position, undoing the projection. depth = (p22 * z + p32) / -z.
+    vec2 ndc = gl_FragCoord.xy / pushLighting.extent * 2.0 - 1.0;
+    float viewZ = -pushLighting.projParams.w / (depth + pushLighting.projParams.z);
+    vec3 position = vec3(ndc.x * -viewZ / pushLighting.projParams.x, ndc.y * -viewZ / pushLighting.projParams.y, viewZ);
+    vec3 normal = octDecode(subpassLoad(inputNormal).xy);
+
+    // Only the lights binned into this pixel's tile.
+    uvec2 tile = uvec2(gl_FragCoord.xy) / TILE_SIZE;
+    uint base = (tile.y * pushLighting.tileCount.x + tile.x) * (MAX_LIGHTS_PER_TILE + 1);
+    uint count = tileData[base];
+
+    vec3 lighting = AMBIENT;
+    for(uint i = 0; i < count; i++) {
+        PointLight light = lights[tileData[base + 1 + i]];
+        vec3 toLight = light.position - position;
+        float dist = length(toLight);
+        float falloff = clamp(1.0 - dist / light.radius, 0.0, 1.0);
+        lighting += light.color * light.intensity * max(dot(normal, toLight / max(dist, 0.0001)), 0.0) * falloff * falloff;
+    }
+
+    color = vec4(albedo.rgb * lighting, 1.0);
+}
\ No newline at end of file
@@ -6,9 +6,13 @@ layout(input_attachment_index = 1, binding = 1) uniform subpassInput inputDepth;
 
 layout(location = 0) out vec4 color;
 
+// Framebuffer changes size with the window, so the split is worked out from the extent passed in.
+layout(push_constant) uniform PushPost {
+    vec2 extent;
+} pushPost;
+
 void main() {
-    int xHalf = 1920 / 2;
-    if(gl_FragCoord.x > xHalf) {
+    if(gl_FragCoord.x > pushPost.extent.x * 0.5) {
         float lowerBound = 0.98;
         float upperBound = 1.00;
 
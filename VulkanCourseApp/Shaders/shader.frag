@@ -1,13 +1,34 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 // in/out locations are separate. 0 != 0
 layout(location = 0) in vec3 fragCol;
 layout(location = 1) in vec2 fragTex;
+layout(location = 2) in vec3 fragNorm;
 
-layout(set = 1, binding = 0) uniform sampler2D textureSampler;
+// Every texture, sized by the renderer.
+layout(set = 1, binding = 0) uniform sampler2D textureSamplers[];
 
-layout(location = 0) out vec4 outColor; // Final output color. Must also have location.
+// Model index is the vertex shader's.
+layout(push_constant) uniform PushModel {
+    layout(offset = 4) uint texId;
+} pushModel;
+
+// G-buffer, lit in the next subpass.
+layout(location = 0) out vec4 outAlbedo;
+layout(location = 1) out vec2 outNormal;
+
+// Unit vector onto the octahedron, folded out to a square. Two channels instead of three.
+vec2 octEncode(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if(n.z < 0.0) {
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e;
+}
 
 void main() {
-    outColor = texture(textureSampler, fragTex);
+    outAlbedo = texture(textureSamplers[pushModel.texId], fragTex);
+    outNormal = octEncode(normalize(fragNorm));
 }
\ No newline at end of file
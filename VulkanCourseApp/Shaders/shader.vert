@@ -3,28 +3,34 @@
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 col;
 layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 norm;
 
 layout(set = 0, binding = 0) uniform UboViewProjection {
     mat4 proj;
     mat4 view;    
 } uboViewProjection;
 
-// NOT IN USE, LEFT FOR REFERENCE.
-layout(set = 0, binding = 1) uniform UboModel {
-    mat4 model;    
-} uboModel;
+// Every model matrix this frame, from the frame allocator's storage binding at a dynamic offset.
+layout(set = 2, binding = 1) readonly buffer Transforms {
+    mat4 models[];
+} transforms;
 
 // Only one push constant block available.
 layout(push_constant) uniform PushModel {
-    mat4 model;
+    uint modelIndex;
+    uint texId;
 } pushModel;
 
 layout(location = 0) out vec3 fragCol;
 layout(location = 1) out vec2 fragTex;
+layout(location = 2) out vec3 fragNorm;
 
 void main() {
+    mat4 model = transforms.models[pushModel.modelIndex];
     // Matrix multiplication goes right to left.
-    gl_Position = uboViewProjection.proj * uboViewProjection.view * pushModel.model * vec4(pos, 1.0);  
+    gl_Position = uboViewProjection.proj * uboViewProjection.view * model * vec4(pos, 1.0);  
     fragCol = col; 
     fragTex = tex; 
+    // Lighting is done in view space. Models are only rotated, translated and uniformly scaled, so no inverse transpose.
+    fragNorm = mat3(uboViewProjection.view * model) * norm;
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#version 450
+
+// Scene rendered into the top left of this at a fraction of the swapchain size.
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+layout(location = 0) out vec4 color;
+
+layout(push_constant) uniform PushUpscale {
+    vec2 uvScale; // Output pixel coord to scene uv.
+    vec2 uvMax; // Last texel center that was rendered to.
+} pushUpscale;
+
+void main() {
+    // Clamp so bilinear filtering doesn't pull in texels outside the rendered region.
+    vec2 uv = min(gl_FragCoord.xy * pushUpscale.uvScale, pushUpscale.uvMax);
+    color = texture(sceneColor, uv);
+}
\ No newline at end of file
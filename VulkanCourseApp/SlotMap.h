@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <stdexcept>
+#include <string>
+
+using std::vector;
+
+// Typed reference into a SlotMap<T>. The generation changes whenever the slot is freed, so a handle to
+// something destroyed is caught on lookup even once the slot has been reused. Default constructed is never valid.
+template<typename T>
+struct Handle {
+	uint32_t index{ ~0u };
+	uint32_t generation{ 0 };
+
+	bool operator==(const Handle &other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle &other) const { return !(*this == other); }
+};
+
+// Values packed in one vector, so iterating them is contiguous. Handles go through a slot table to the value's
+// dense index. Insert, erase and lookup are O(1), erase moves the last value into the gap.
+template<typename T>
+class SlotMap
+{
+public:
+	Handle<T> insert(const T &value) {
+		uint32_t slotIndex;
+		if (!_freeSlots.empty()) {
+			slotIndex = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		else {
+			slotIndex = static_cast<uint32_t>(_slots.size());
+			_slots.push_back({ 0, 1 });
+		}
+
+		_slots[slotIndex].dense = static_cast<uint32_t>(_values.size());
+		_values.push_back(value);
+		_denseToSlot.push_back(slotIndex);
+		return { slotIndex, _slots[slotIndex].generation };
+	}
+
+	// False if the handle was already stale.
+	bool erase(Handle<T> handle) {
+		if (!contains(handle)) {
+			return false;
+		}
+		Slot &slot{ _slots[handle.index] };
+
+		// Last value fills the gap.
+		const uint32_t lastDense{ static_cast<uint32_t>(_values.size() - 1) };
+		if (slot.dense != lastDense) {
+			_values[slot.dense] = std::move(_values[lastDense]);
+			_denseToSlot[slot.dense] = _denseToSlot[lastDense];
+			_slots[_denseToSlot[slot.dense]].dense = slot.dense;
+		}
+		_values.pop_back();
+		_denseToSlot.pop_back();
+
+		// 0 is kept for default handles.
+		slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+		_freeSlots.push_back(handle.index);
+		return true;
+	}
+
+	bool contains(Handle<T> handle) const {
+		return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+	}
+
+	// nullptr for stale handles. Only good until the next insert or erase.
+	T *get(Handle<T> handle) {
+		return contains(handle) ? &_values[_slots[handle.index].dense] : nullptr;
+	}
+
+	T &at(Handle<T> handle) {
+		return _values[getDenseIndex(handle)];
+	}
+
+	uint32_t getDenseIndex(Handle<T> handle) {
+		if (!contains(handle)) {
+			throw std::runtime_error("Attempted to use a stale handle, index=" + std::to_string(handle.index));
+		}
+		return _slots[handle.index].dense;
+	}
+
+	// Dense access, changes when something is erased.
+	size_t size() const { return _values.size(); }
+	bool empty() const { return _values.empty(); }
+	T &operator[](size_t denseIndex) { return _values[denseIndex]; }
+	Handle<T> getHandle(size_t denseIndex) {
+		const uint32_t slotIndex{ _denseToSlot[denseIndex] };
+		return { slotIndex, _slots[slotIndex].generation };
+	}
+	typename vector<T>::iterator begin() { return _values.begin(); }
+	typename vector<T>::iterator end() { return _values.end(); }
+private:
+	struct Slot {
+		uint32_t dense; // Index into _values while in use.
+		uint32_t generation;
+	};
+
+	vector<T> _values;
+	vector<uint32_t> _denseToSlot;
+	vector<Slot> _slots;
+	vector<uint32_t> _freeSlots;
+};
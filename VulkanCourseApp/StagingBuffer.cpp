@@ -0,0 +1,92 @@
+#include "StagingBuffer.h"
+
+StagingBuffer::StagingBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size) {
+	_device = device;
+	_size = size;
+
+	// Image copies want texel and preferably optimal offset alignment, both powers of two.
+	VkPhysicalDeviceProperties deviceProps{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProps);
+	_alignment = std::max(_alignment, deviceProps.limits.optimalBufferCopyOffsetAlignment);
+
+	// Cached when there's such a type, decoders read back rows they've written and uncached reads are very slow.
+	VkMemoryPropertyFlags memFlags{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+	if (hasMemoryType(physicalDevice, ~0u, memFlags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)) {
+		memFlags |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	}
+	createBuffer(physicalDevice, _device, _size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, memFlags, &_buffer, &_bufferMem);
+
+	void *data;
+	if (vkMapMemory(_device, _bufferMem, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to map the staging buffer.");
+	}
+	_mapped = static_cast<uint8_t *>(data);
+}
+
+void *StagingBuffer::allocate(VkDeviceSize size) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	// Never empty, so every allocation starts somewhere different.
+	size = std::max(size, static_cast<VkDeviceSize>(1));
+
+	// Up to the end, or around to the start when that's short, up to the tail. Once wrapped, the head is at or
+	// before the tail.
+	VkDeviceSize offset{ (_head + _alignment - 1) & ~(_alignment - 1) };
+	if (_allocations.empty() || _head > _allocations.front().offset) {
+		if (offset + size > _size) {
+			offset = 0;
+			if (_allocations.empty() || size > _allocations.front().offset) {
+				return nullptr;
+			}
+		}
+	}
+	else if (offset + size > _allocations.front().offset) {
+		return nullptr;
+	}
+
+	_allocations.push_back({ offset, offset + size, false });
+	_head = offset + size;
+	return _mapped + offset;
+}
+
+void StagingBuffer::release(const void *data) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	const VkDeviceSize offset{ getOffset(data) };
+	auto allocation{ std::find_if(_allocations.begin(), _allocations.end(), [offset](const Allocation &allocation) {
+		return allocation.offset == offset;
+	}) };
+	if (allocation == _allocations.end() || allocation->released) {
+		throw std::runtime_error("Released a staging allocation that isn't held.");
+	}
+	allocation->released = true;
+
+	// The tail moves up past everything released in a row. With nothing held, start from the beginning again.
+	while (!_allocations.empty() && _allocations.front().released) {
+		_allocations.pop_front();
+	}
+	if (_allocations.empty()) {
+		_head = 0;
+	}
+}
+
+bool StagingBuffer::owns(const void *data) {
+	const uint8_t *bytes{ static_cast<const uint8_t *>(data) };
+	return _mapped && bytes >= _mapped && bytes < _mapped + _size;
+}
+
+VkDeviceSize StagingBuffer::getOffset(const void *data) {
+	return static_cast<VkDeviceSize>(static_cast<const uint8_t *>(data) - _mapped);
+}
+
+VkBuffer StagingBuffer::getBuffer() {
+	return _buffer;
+}
+
+void StagingBuffer::destroy() {
+	vkUnmapMemory(_device, _bufferMem);
+	vkDestroyBuffer(_device, _buffer, nullptr);
+	vkFreeMemory(_device, _bufferMem, nullptr);
+	_mapped = nullptr;
+}
+
+StagingBuffer::~StagingBuffer() {
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <mutex>
+#include <deque>
+#include <algorithm>
+
+#include "Utilities.h"
+
+// Upload space that stays mapped for as long as it lives, so loaders write straight into memory the GPU copies
+// from. Allocation is a pointer bump around a ring that any thread can do. Space comes back oldest first: a
+// release frees everything up to the oldest allocation still held, later ones wait behind it. Uploads from an
+// allocation have to be complete before it's released.
+class StagingBuffer
+{
+public:
+	StagingBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size);
+	StagingBuffer(const StagingBuffer &) = delete;
+	StagingBuffer &operator=(const StagingBuffer &) = delete;
+
+	// nullptr when it doesn't fit, the caller needs its own buffer then.
+	void *allocate(VkDeviceSize size);
+	void release(const void *data);
+	bool owns(const void *data);
+	// Copy source offset of an allocation.
+	VkDeviceSize getOffset(const void *data);
+	VkBuffer getBuffer();
+
+	void destroy();
+
+	~StagingBuffer();
+private:
+	VkDevice _device;
+	VkDeviceSize _size;
+	VkDeviceSize _alignment{ 16 };
+
+	VkBuffer _buffer{ VK_NULL_HANDLE };
+	VkDeviceMemory _bufferMem{ VK_NULL_HANDLE };
+	uint8_t *_mapped{ nullptr };
+
+	struct Allocation {
+		VkDeviceSize offset;
+		VkDeviceSize end;
+		bool released;
+	};
+
+	std::mutex _mutex;
+	VkDeviceSize _head{ 0 };
+	std::deque<Allocation> _allocations; // Oldest first, the front is the ring's tail.
+};
@@ -0,0 +1,106 @@
+#include "TextureAtlas.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Utilities.h"
+
+TextureAtlas::TextureAtlas(uint32_t pageSize, uint32_t padding) {
+	_pageSize = pageSize;
+	_padding = padding;
+}
+
+TextureAtlas::Rect TextureAtlas::add(const uint8_t *pixels, uint32_t width, uint32_t height) {
+	// Cells are padding aligned so mip texels line up with them.
+	const uint32_t cellWidth{ (width + _padding * 3 - 1) & ~(_padding - 1) };
+	const uint32_t cellHeight{ (height + _padding * 3 - 1) & ~(_padding - 1) };
+	if (cellWidth > _pageSize || cellHeight > _pageSize) {
+		throw std::runtime_error("Texture too big for an atlas page, width=" + std::to_string(width)
+			+ " height=" + std::to_string(height));
+	}
+
+	Rect rect{ 0, 0, 0, width, height };
+	uint32_t cellX{ 0 };
+	uint32_t cellY{ 0 };
+	while (rect.page < _pages.size() && !_pages[rect.page].packer.insert(cellWidth, cellHeight, &cellX, &cellY)) {
+		rect.page++;
+	}
+	if (rect.page == _pages.size()) {
+		_pages.push_back({ AtlasPacker{ _pageSize, _pageSize },
+			vector<uint8_t>(static_cast<size_t>(_pageSize) * _pageSize * 4) });
+		_pages.back().packer.insert(cellWidth, cellHeight, &cellX, &cellY);
+	}
+	rect.x = cellX + _padding;
+	rect.y = cellY + _padding;
+
+	// Copy in, the rest of the cell repeats the nearest edge pixel.
+	uint8_t *page{ _pages[rect.page].pixels.data() };
+	for (uint32_t y{ 0 }; y < cellHeight; y++) {
+		const uint32_t srcY{ y < _padding ? 0 : std::min(y - _padding, height - 1) };
+		uint8_t *dstRow{ page + (static_cast<size_t>(cellY + y) * _pageSize + cellX) * 4 };
+		for (uint32_t x{ 0 }; x < cellWidth; x++) {
+			const uint32_t srcX{ x < _padding ? 0 : std::min(x - _padding, width - 1) };
+			memcpy(dstRow + x * 4, pixels + (static_cast<size_t>(srcY) * width + srcX) * 4, 4);
+		}
+	}
+	return rect;
+}
+
+size_t TextureAtlas::getPageCount() {
+	return _pages.size();
+}
+
+uint32_t TextureAtlas::getPageHeight(size_t page) {
+	return _pages[page].packer.getUsedHeight();
+}
+
+glm::vec4 TextureAtlas::getUvTransform(const Rect &rect) {
+	const float pageWidth{ static_cast<float>(_pageSize) };
+	const float pageHeight{ static_cast<float>(getPageHeight(rect.page)) };
+	return { rect.x / pageWidth, rect.y / pageHeight, rect.width / pageWidth, rect.height / pageHeight };
+}
+
+TextureDecoder::Image TextureAtlas::takePage(size_t page) {
+	const uint32_t height{ getPageHeight(page) };
+
+	// Level n has padding / 2^n texels of padding, stop at one.
+	uint32_t mipLevels{ 1 };
+	for (uint32_t padding{ _padding }; padding > 1; padding /= 2) {
+		mipLevels++;
+	}
+	mipLevels = std::min(mipLevels, getMipLevelCount(_pageSize, height));
+	const VkDeviceSize baseSize{ static_cast<VkDeviceSize>(_pageSize) * height * 4 };
+	const vector<uint8_t> chain{ buildMipChain(_pages[page].pixels.data(), _pageSize, height, mipLevels) };
+
+	TextureDecoder::Image image{};
+	image.width = static_cast<int>(_pageSize);
+	image.height = static_cast<int>(height);
+	image.size = baseSize + chain.size();
+	image.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image.fullWidth = _pageSize;
+	image.fullHeight = height;
+	image.pixels = static_cast<stbi_uc *>(malloc(static_cast<size_t>(image.size)));
+	if (!image.pixels) {
+		throw std::runtime_error("Failed to allocate atlas page, size=" + std::to_string(image.size));
+	}
+	// Rows past the used height are left off the base level.
+	memcpy(image.pixels, _pages[page].pixels.data(), static_cast<size_t>(baseSize));
+	memcpy(image.pixels + baseSize, chain.data(), chain.size());
+
+	// Levels are packed in order, same halving as buildMipChain.
+	VkDeviceSize offset{ 0 };
+	uint32_t levelWidth{ _pageSize };
+	uint32_t levelHeight{ height };
+	for (uint32_t level{ 0 }; level < mipLevels; level++) {
+		image.levels.push_back({ offset, levelWidth, levelHeight });
+		offset += static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+	}
+
+	vector<uint8_t>().swap(_pages[page].pixels);
+	return image;
+}
+
+TextureAtlas::~TextureAtlas() {
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AtlasPacker.h"
+#include "TextureDecoder.h"
+
+using std::vector;
+
+// Small RGBA8 textures packed into shared pages, so models with many of them bind a handful of images. Each one
+// sits on a grid of padding sized cells with its edge pixels stretched out over the padding around it. The page's
+// mips stop while the padding still covers a texel, so neither filtering nor mipping reaches the neighbours.
+class TextureAtlas
+{
+public:
+	// Pixels on the page, without the padding.
+	struct Rect {
+		uint32_t page;
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// Padding is a power of two.
+	TextureAtlas(uint32_t pageSize, uint32_t padding);
+
+	// Copies the pixels onto the first page with room, opening one when none has. Throws when it can't fit a page.
+	Rect add(const uint8_t *pixels, uint32_t width, uint32_t height);
+	size_t getPageCount();
+	// Trimmed to the rows in use.
+	uint32_t getPageHeight(size_t page);
+	// Offset in xy and scale in zw, from the texture's 0-1 UVs to the page's. Pages keep their height once
+	// nothing more is added.
+	glm::vec4 getUvTransform(const Rect &rect);
+	// RGBA8 image with its mips, on the heap for stbi_image_free. The page gives up its pixels.
+	TextureDecoder::Image takePage(size_t page);
+
+	~TextureAtlas();
+private:
+	struct Page {
+		AtlasPacker packer;
+		vector<uint8_t> pixels;
+	};
+
+	uint32_t _pageSize;
+	uint32_t _padding;
+	vector<Page> _pages;
+};
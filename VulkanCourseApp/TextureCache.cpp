@@ -0,0 +1,90 @@
+#include "TextureCache.h"
+
+TextureCache::TextureCache() {
+}
+
+TextureHandle TextureCache::find(const string &path) {
+	auto it{ _byPath.find(path) };
+	if (it == _byPath.end()) {
+		return TextureHandle{};
+	}
+	_stats.pathHits++;
+	return it->second;
+}
+
+TextureHandle TextureCache::findByContent(uint64_t contentHash) {
+	auto it{ _byContent.find(contentHash) };
+	if (it == _byContent.end()) {
+		return TextureHandle{};
+	}
+	_stats.contentHits++;
+	return it->second;
+}
+
+bool TextureCache::contains(TextureHandle texture) {
+	return _assets.contains(texture);
+}
+
+void TextureCache::setContentHashing(bool enabled) {
+	_contentHashing = enabled;
+}
+
+bool TextureCache::isContentHashing() {
+	return _contentHashing;
+}
+
+TextureHandle TextureCache::add(const string &path, uint64_t contentHash, const Texture &texture) {
+	TextureHandle handle{ _assets.insert({ texture, contentHash, { path }, 0 }) };
+	_byPath[path] = handle;
+	if (_contentHashing) {
+		_byContent[contentHash] = handle;
+	}
+	_stats.misses++;
+	return handle;
+}
+
+void TextureCache::addPath(TextureHandle texture, const string &path) {
+	_assets.at(texture).paths.push_back(path);
+	_byPath[path] = texture;
+}
+
+void TextureCache::acquire(TextureHandle texture) {
+	_assets.at(texture).refCount++;
+}
+
+bool TextureCache::release(TextureHandle texture) {
+	TextureAsset &entry{ _assets.at(texture) };
+	if (entry.refCount == 0) {
+		throw std::runtime_error("Released a texture with no references, index=" + std::to_string(texture.index));
+	}
+	return --entry.refCount == 0;
+}
+
+Texture TextureCache::remove(TextureHandle texture) {
+	TextureAsset entry{ _assets.at(texture) };
+	for (const auto &path : entry.paths) {
+		_byPath.erase(path);
+	}
+	// Only if it's the one registered, hashing may have been off when it was added.
+	auto it{ _byContent.find(entry.contentHash) };
+	if (it != _byContent.end() && it->second == texture) {
+		_byContent.erase(it);
+	}
+	_assets.erase(texture);
+	return entry.texture;
+}
+
+Texture &TextureCache::get(TextureHandle texture) {
+	return _assets.at(texture).texture;
+}
+
+TextureCache::Stats TextureCache::getStats() {
+	return _stats;
+}
+
+SlotMap<TextureAsset> &TextureCache::getAssets() {
+	return _assets;
+}
+
+TextureCache::~TextureCache() {
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "Utilities.h"
+
+using std::vector;
+using std::string;
+
+// Uploaded image, shared by every material that uses it.
+struct TextureAsset {
+	Texture texture;
+	uint64_t contentHash;
+	vector<string> paths; // Normalized paths it's been loaded under.
+	uint32_t refCount;
+};
+
+// Textures already on the GPU, keyed by normalized path and, unless turned off, by a hash of the file's bytes
+// so the same image under another name is uploaded once too. Destroyed once the last reference goes.
+class TextureCache
+{
+public:
+	// Every lookup that ends in a texture counts once, under whichever key found it.
+	struct Stats {
+		uint32_t pathHits;
+		uint32_t contentHits;
+		uint32_t misses;
+	};
+
+	TextureCache();
+
+	// Stale (default) handle when it isn't loaded. Hits are counted.
+	TextureHandle find(const string &path);
+	TextureHandle findByContent(uint64_t contentHash);
+	bool contains(TextureHandle texture);
+
+	// Hashing costs a read through every new file.
+	void setContentHashing(bool enabled);
+	bool isContentHashing();
+
+	// Counted as a miss. Starts with no references, acquire it.
+	TextureHandle add(const string &path, uint64_t contentHash, const Texture &texture);
+	// Another path for pixels that are already uploaded.
+	void addPath(TextureHandle texture, const string &path);
+
+	void acquire(TextureHandle texture);
+	// True when that was the last reference, it's then up to the caller to remove it.
+	bool release(TextureHandle texture);
+	// Drops it from the cache, the Vulkan objects are handed back for destroying.
+	Texture remove(TextureHandle texture);
+
+	Texture &get(TextureHandle texture);
+	Stats getStats();
+	// For destroying whatever is left at shutdown.
+	SlotMap<TextureAsset> &getAssets();
+
+	~TextureCache();
+private:
+	SlotMap<TextureAsset> _assets;
+	std::unordered_map<string, TextureHandle> _byPath;
+	std::unordered_map<uint64_t, TextureHandle> _byContent;
+	bool _contentHashing{ true };
+	Stats _stats{ 0, 0, 0 };
+};
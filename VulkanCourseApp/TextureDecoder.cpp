@@ -0,0 +1,186 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+// stb_image's allocations on this thread. The first one that's exactly the size of the decoded image is given the
+// destination: that's the output buffer for JPEG and for PNG without a channel conversion, so rows are written
+// straight into it. Anything else goes to the heap.
+namespace {
+	thread_local void *t_destination{ nullptr };
+	thread_local size_t t_destinationSize{ 0 };
+	thread_local bool t_destinationInUse{ false };
+}
+
+static void *decodeMalloc(size_t size) {
+	if (t_destination && !t_destinationInUse && size == t_destinationSize) {
+		t_destinationInUse = true;
+		return t_destination;
+	}
+	return malloc(size);
+}
+
+static void decodeFree(void *data) {
+	if (data && data == t_destination) {
+		t_destinationInUse = false;
+		return;
+	}
+	free(data);
+}
+
+static void *decodeRealloc(void *data, size_t oldSize, size_t newSize) {
+	if (!data || data != t_destination) {
+		return realloc(data, newSize);
+	}
+	// The destination can't grow, move it to the heap.
+	void *moved{ malloc(newSize) };
+	if (moved) {
+		memcpy(moved, data, std::min(oldSize, newSize));
+		t_destinationInUse = false;
+	}
+	return moved;
+}
+
+#define STBI_MALLOC(size) decodeMalloc(size)
+#define STBI_REALLOC_SIZED(data, oldSize, newSize) decodeRealloc(data, oldSize, newSize)
+#define STBI_FREE(data) decodeFree(data)
+#define STB_IMAGE_IMPLEMENTATION
+#include "TextureDecoder.h"
+
+#include "MappedFile.h"
+#include "Ktx2.h"
+#include "Utilities.h"
+
+// Levels to skip for the first one to be no bigger than maxSize on either side.
+static uint32_t getBaseLevel(uint32_t width, uint32_t height, uint32_t maxSize) {
+	uint32_t level{ 0 };
+	while ((width > maxSize || height > maxSize) && (width > 1 || height > 1)) {
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		level++;
+	}
+	return level;
+}
+
+TextureDecoder::Image TextureDecoder::decodeFile(const string &filePath, const DestinationFunc &destination, uint32_t maxSize) {
+	MappedFile file{ filePath };
+	if (file.getSize() > static_cast<size_t>(INT32_MAX)) {
+		throw std::runtime_error("Texture file is too large to decode, file=" + filePath);
+	}
+	const int fileSize{ static_cast<int>(file.getSize()) };
+
+	// Header only, for the size to ask the destination for.
+	Image image{};
+	int channels{ 0 };
+	if (!stbi_info_from_memory(file.getData(), fileSize, &image.width, &image.height, &channels)) {
+		throw std::runtime_error("Failed to load texture file=" + filePath);
+	}
+	// Each pixel has 4 channels.
+	image.size = static_cast<VkDeviceSize>(image.width) * image.height * 4;
+	image.format = VK_FORMAT_R8G8B8A8_UNORM;
+	image.fullWidth = static_cast<uint32_t>(image.width);
+	image.fullHeight = static_cast<uint32_t>(image.height);
+	image.baseLevel = getBaseLevel(image.width, image.height, maxSize);
+	if (image.baseLevel > 0) {
+		return decodeLevel(file, filePath, destination, image);
+	}
+	void *target{ destination ? destination(image.size) : nullptr };
+
+	t_destination = target;
+	t_destinationSize = static_cast<size_t>(image.size);
+	t_destinationInUse = false;
+	int width, height;
+	stbi_uc *pixels{ stbi_load_from_memory(file.getData(), fileSize, &width, &height, &channels, STBI_rgb_alpha) };
+	t_destination = nullptr;
+
+	if (!pixels) {
+		throw std::runtime_error("Failed to load texture file=" + filePath);
+	}
+
+	// Converted formats end up on the heap, those still take one copy.
+	if (target && pixels != target) {
+		memcpy(target, pixels, static_cast<size_t>(image.size));
+		stbi_image_free(pixels);
+	}
+	image.pixels = target ? static_cast<stbi_uc *>(target) : pixels;
+	image.levels.push_back({ 0, static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height) });
+	return image;
+}
+
+bool TextureDecoder::getSize(const string &filePath, uint32_t *width, uint32_t *height) {
+	MappedFile file{ filePath };
+	int fileWidth, fileHeight, channels;
+	if (file.getSize() > static_cast<size_t>(INT32_MAX)
+		|| !stbi_info_from_memory(file.getData(), static_cast<int>(file.getSize()), &fileWidth, &fileHeight, &channels)) {
+		return false;
+	}
+	*width = static_cast<uint32_t>(fileWidth);
+	*height = static_cast<uint32_t>(fileHeight);
+	return true;
+}
+
+TextureDecoder::Image TextureDecoder::decodeLevel(MappedFile &file, const string &filePath, const DestinationFunc &destination,
+	Image image) {
+	// Whole image on the heap first, only the level asked for goes to the destination.
+	int width, height, channels;
+	stbi_uc *pixels{ stbi_load_from_memory(file.getData(), static_cast<int>(file.getSize()), &width, &height, &channels, STBI_rgb_alpha) };
+	if (!pixels) {
+		throw std::runtime_error("Failed to load texture file=" + filePath);
+	}
+	const vector<uint8_t> chain{ buildMipChain(pixels, width, height, image.baseLevel + 1) };
+	stbi_image_free(pixels);
+
+	// Chain holds levels 1 and down, the one wanted is last.
+	image.width = width;
+	image.height = height;
+	for (uint32_t level{ 0 }; level < image.baseLevel; level++) {
+		image.width = image.width > 1 ? image.width / 2 : 1;
+		image.height = image.height > 1 ? image.height / 2 : 1;
+	}
+	image.size = static_cast<VkDeviceSize>(image.width) * image.height * 4;
+
+	void *target{ destination ? destination(image.size) : nullptr };
+	image.pixels = static_cast<stbi_uc *>(target ? target : malloc(static_cast<size_t>(image.size)));
+	if (!image.pixels) {
+		throw std::runtime_error("Out of memory loading texture file=" + filePath);
+	}
+	memcpy(image.pixels, chain.data() + chain.size() - image.size, static_cast<size_t>(image.size));
+	image.levels.push_back({ 0, static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height) });
+	return image;
+}
+
+bool TextureDecoder::loadKtx2(const string &filePath, const std::set<VkFormat> &formats, const DestinationFunc &destination,
+	Image *image, uint32_t maxSize) {
+	MappedFile file{ filePath };
+	const Ktx2::Info info{ Ktx2::parse(file.getData(), file.getSize(), filePath) };
+	if (!formats.count(info.format)) {
+		return false;
+	}
+
+	// Levels packed back to back, largest first. Block sizes are 8 or 16 bytes so copy offsets stay aligned.
+	// The smallest stored level is the coarsest there is, even if it's bigger than maxSize.
+	image->baseLevel = std::min(getBaseLevel(info.width, info.height, maxSize), static_cast<uint32_t>(info.levels.size()) - 1);
+	image->fullWidth = info.width;
+	image->fullHeight = info.height;
+	image->width = static_cast<int>(info.levels[image->baseLevel].width);
+	image->height = static_cast<int>(info.levels[image->baseLevel].height);
+	image->format = info.format;
+	image->levels.clear();
+	image->size = 0;
+	for (size_t level{ image->baseLevel }; level < info.levels.size(); level++) {
+		image->levels.push_back({ image->size, info.levels[level].width, info.levels[level].height });
+		image->size += info.levels[level].size;
+	}
+
+	// Already in its final form, one copy out of the mapping.
+	void *target{ destination ? destination(image->size) : nullptr };
+	image->pixels = static_cast<stbi_uc *>(target ? target : malloc(static_cast<size_t>(image->size)));
+	if (!image->pixels) {
+		throw std::runtime_error("Out of memory loading texture file=" + filePath);
+	}
+	for (size_t level{ 0 }; level < image->levels.size(); level++) {
+		memcpy(image->pixels + image->levels[level].offset, file.getData() + info.levels[image->baseLevel + level].offset,
+			static_cast<size_t>(info.levels[image->baseLevel + level].size));
+	}
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <string>
+#include <vector>
+#include <set>
+#include <functional>
+
+#include "stb_image.h"
+
+class MappedFile;
+
+using std::string;
+using std::vector;
+
+// Decodes image files to RGBA8 with stb_image. The file is memory mapped instead of read into a buffer, and the
+// pixels are decoded straight into memory the caller hands out (staging) instead of a heap buffer to copy from.
+class TextureDecoder
+{
+public:
+	struct Level {
+		VkDeviceSize offset; // From pixels.
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct Image {
+		stbi_uc *pixels; // The destination if one was given, otherwise on the heap to free with stbi_image_free.
+		int width;
+		int height;
+		VkDeviceSize size; // Every level.
+		VkFormat format;
+		vector<Level> levels; // Just the base level when decoded, mips are left to the upload.
+		uint32_t baseLevel; // Finer levels of the file that were left out, width and height are this level's.
+		uint32_t fullWidth; // Level 0 of the file.
+		uint32_t fullHeight;
+	};
+
+	// Gets the decoded size, returns where the pixels should go or nullptr to leave them on the heap.
+	typedef std::function<void *(VkDeviceSize size)> DestinationFunc;
+
+	// Thread safe, loaders run it on the workers. Levels bigger than maxSize on either side are skipped: decoded
+	// images are box filtered down on the CPU, KTX2 ones start at the first stored level that fits.
+	static Image decodeFile(const string &filePath, const DestinationFunc &destination, uint32_t maxSize = UINT32_MAX);
+	// Block compressed data and mips as stored. False, with nothing loaded, when the format isn't one of formats.
+	static bool loadKtx2(const string &filePath, const std::set<VkFormat> &formats, const DestinationFunc &destination,
+		Image *image, uint32_t maxSize = UINT32_MAX);
+	// Just the header, false when stb_image can't read the file.
+	static bool getSize(const string &filePath, uint32_t *width, uint32_t *height);
+
+private:
+	// decodeFile for a base level past the first, image has the file's size.
+	static Image decodeLevel(MappedFile &file, const string &filePath, const DestinationFunc &destination, Image image);
+};
@@ -0,0 +1,204 @@
+#include "TextureStreamer.h"
+#include "Ktx2.h"
+
+#include <algorithm>
+#include <cmath>
+
+TextureStreamer::TextureStreamer() {
+}
+
+void TextureStreamer::setBudget(VkDeviceSize budget) {
+	_budget = budget;
+}
+
+VkDeviceSize TextureStreamer::getBudget() {
+	return _budget;
+}
+
+VkDeviceSize TextureStreamer::getResidentBytes() {
+	return _residentBytes;
+}
+
+void TextureStreamer::add(TextureHandle texture, const string &fileName, VkFormat format, uint32_t width, uint32_t height,
+	uint32_t levelCount, uint32_t baseLevel) {
+	Entry entry{ texture, fileName, format, width, height, levelCount, baseLevel, baseLevel, false, baseLevel, 0, 0.0f };
+	_residentBytes += getResidentSize(entry, baseLevel);
+	_entries[getKey(texture)] = entry;
+}
+
+void TextureStreamer::remove(TextureHandle texture) {
+	const Entry &entry{ at(texture) };
+	_residentBytes -= getResidentSize(entry, entry.pending ? entry.pendingBaseLevel : entry.baseLevel);
+	_entries.erase(getKey(texture));
+}
+
+bool TextureStreamer::contains(TextureHandle texture) {
+	return _entries.count(getKey(texture)) > 0;
+}
+
+const string &TextureStreamer::getFileName(TextureHandle texture) {
+	return at(texture).fileName;
+}
+
+uint32_t TextureStreamer::getSize(TextureHandle texture) {
+	const Entry &entry{ at(texture) };
+	return std::max(entry.width, entry.height);
+}
+
+void TextureStreamer::markUsed(TextureHandle texture, float screenSize, uint64_t frame) {
+	auto it{ _entries.find(getKey(texture)) };
+	if (it == _entries.end()) {
+		return;
+	}
+	Entry &entry{ it->second };
+	// First use this frame replaces the last frame's size.
+	if (entry.lastUsed != frame) {
+		entry.lastUsed = frame;
+		entry.screenSize = screenSize;
+	}
+	else {
+		entry.screenSize = std::max(entry.screenSize, screenSize);
+	}
+}
+
+vector<TextureStreamer::Request> TextureStreamer::getStreamIns(uint64_t frame, uint32_t maxCount) {
+	// Drawn this frame and short of the levels its size on screen wants.
+	vector<std::pair<float, TextureHandle>> candidates;
+	for (const auto &item : _entries) {
+		const Entry &entry{ item.second };
+		if (!entry.pending && entry.lastUsed == frame && getWantedLevel(entry) < entry.baseLevel) {
+			candidates.push_back({ entry.screenSize, entry.texture });
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, TextureHandle> &a, const std::pair<float, TextureHandle> &b) {
+		return a.first > b.first;
+	});
+
+	// What doesn't fit is remembered for the next round of evictions.
+	vector<Request> requests;
+	_wantedBytes = 0;
+	for (const auto &candidate : candidates) {
+		if (requests.size() >= maxCount) {
+			break;
+		}
+		Entry &entry{ at(candidate.second) };
+		const uint32_t wantedLevel{ getWantedLevel(entry) };
+		const VkDeviceSize extraBytes{ getResidentSize(entry, wantedLevel) - getResidentSize(entry, entry.baseLevel) };
+		if (_residentBytes + extraBytes > _budget) {
+			_wantedBytes += extraBytes;
+			continue;
+		}
+		setPending(entry, wantedLevel);
+		requests.push_back({ candidate.second, wantedLevel });
+	}
+	return requests;
+}
+
+vector<TextureStreamer::Request> TextureStreamer::getEvictions(uint64_t frame) {
+	if (_residentBytes + _wantedBytes <= _budget) {
+		return {};
+	}
+	VkDeviceSize needed{ _residentBytes + _wantedBytes - _budget };
+
+	// Unused for a while, everything streamed goes. Otherwise just levels finer than it's now drawn at.
+	struct Candidate {
+		uint64_t lastUsed;
+		TextureHandle texture;
+		uint32_t baseLevel;
+	};
+	vector<Candidate> candidates;
+	for (const auto &item : _entries) {
+		const Entry &entry{ item.second };
+		if (entry.pending) {
+			continue;
+		}
+		const uint32_t baseLevel{ frame - entry.lastUsed >= TEXTURE_EVICT_FRAMES ? entry.minBaseLevel : getWantedLevel(entry) };
+		if (baseLevel > entry.baseLevel) {
+			candidates.push_back({ entry.lastUsed, entry.texture, baseLevel });
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+		return a.lastUsed < b.lastUsed;
+	});
+
+	vector<Request> requests;
+	for (const auto &candidate : candidates) {
+		if (needed == 0) {
+			break;
+		}
+		Entry &entry{ at(candidate.texture) };
+		const VkDeviceSize freedBytes{ getResidentSize(entry, entry.baseLevel) - getResidentSize(entry, candidate.baseLevel) };
+		needed -= std::min(needed, freedBytes);
+		setPending(entry, candidate.baseLevel);
+		requests.push_back({ candidate.texture, candidate.baseLevel });
+	}
+	return requests;
+}
+
+void TextureStreamer::setResident(TextureHandle texture, uint32_t baseLevel) {
+	Entry &entry{ at(texture) };
+	_residentBytes -= getResidentSize(entry, entry.pending ? entry.pendingBaseLevel : entry.baseLevel);
+	_residentBytes += getResidentSize(entry, baseLevel);
+	entry.baseLevel = baseLevel;
+	entry.pending = false;
+}
+
+void TextureStreamer::pushLoaded(const Loaded &loaded) {
+	std::lock_guard<std::mutex> lock(_loadedMutex);
+	_loaded.push_back(loaded);
+}
+
+vector<TextureStreamer::Loaded> TextureStreamer::takeLoaded() {
+	std::lock_guard<std::mutex> lock(_loadedMutex);
+	vector<Loaded> loaded;
+	loaded.swap(_loaded);
+	return loaded;
+}
+
+VkDeviceSize TextureStreamer::getLevelsSize(VkFormat format, uint32_t width, uint32_t height, uint32_t firstLevel, uint32_t levelCount) {
+	const VkDeviceSize blockSize{ Ktx2::getBlockSize(format) };
+	VkDeviceSize size{ 0 };
+	for (uint32_t level{ firstLevel }; level < levelCount; level++) {
+		const VkDeviceSize levelWidth{ std::max(width >> level, 1u) };
+		const VkDeviceSize levelHeight{ std::max(height >> level, 1u) };
+		// Anything not block compressed is RGBA8.
+		size += blockSize ? ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize : levelWidth * levelHeight * 4;
+	}
+	return size;
+}
+
+uint64_t TextureStreamer::getKey(TextureHandle texture) {
+	return (static_cast<uint64_t>(texture.generation) << 32) | texture.index;
+}
+
+TextureStreamer::Entry &TextureStreamer::at(TextureHandle texture) {
+	auto it{ _entries.find(getKey(texture)) };
+	if (it == _entries.end()) {
+		throw std::runtime_error("Texture isn't streamed, index=" + std::to_string(texture.index));
+	}
+	return it->second;
+}
+
+uint32_t TextureStreamer::getWantedLevel(const Entry &entry) {
+	// A texel per pixel, taking the texture to be stretched once over the mesh.
+	const float size{ static_cast<float>(std::max(entry.width, entry.height)) };
+	if (entry.screenSize >= size) {
+		return 0;
+	}
+	const float level{ entry.screenSize > 0.0f ? std::floor(std::log2(size / entry.screenSize)) : static_cast<float>(entry.minBaseLevel) };
+	return std::min(static_cast<uint32_t>(level), entry.minBaseLevel);
+}
+
+VkDeviceSize TextureStreamer::getResidentSize(const Entry &entry, uint32_t baseLevel) {
+	return getLevelsSize(entry.format, entry.width, entry.height, baseLevel, entry.levelCount);
+}
+
+void TextureStreamer::setPending(Entry &entry, uint32_t baseLevel) {
+	_residentBytes -= getResidentSize(entry, entry.baseLevel);
+	_residentBytes += getResidentSize(entry, baseLevel);
+	entry.pending = true;
+	entry.pendingBaseLevel = baseLevel;
+}
+
+TextureStreamer::~TextureStreamer() {
+}
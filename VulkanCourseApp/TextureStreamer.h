@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+#include "Utilities.h"
+#include "TextureDecoder.h"
+
+using std::vector;
+using std::string;
+
+// Which mip levels of each texture should be on the GPU. Textures start with their small levels, finer ones are
+// asked for by the projected screen size of the meshes using them, biggest on screen first. Going over the budget
+// evicts the streamed levels of whatever has gone unused longest. Bookkeeping only, the renderer loads the levels
+// and swaps the images.
+class TextureStreamer
+{
+public:
+	// The levels from baseLevel down should be resident.
+	struct Request {
+		TextureHandle texture;
+		uint32_t baseLevel;
+	};
+
+	// Levels a worker loaded, waiting for the renderer to upload. pixels is null if loading failed.
+	struct Loaded {
+		TextureHandle texture;
+		TextureDecoder::Image image;
+	};
+
+	TextureStreamer();
+
+	void setBudget(VkDeviceSize budget);
+	VkDeviceSize getBudget();
+	VkDeviceSize getResidentBytes();
+
+	// levelCount is the full chain, baseLevel the finest level uploaded with it. Levels from there down are never
+	// evicted.
+	void add(TextureHandle texture, const string &fileName, VkFormat format, uint32_t width, uint32_t height,
+		uint32_t levelCount, uint32_t baseLevel);
+	void remove(TextureHandle texture);
+	bool contains(TextureHandle texture);
+	const string &getFileName(TextureHandle texture);
+	// Longest side of the full texture, for the size to load a level at.
+	uint32_t getSize(TextureHandle texture);
+
+	// For every mesh drawn with it, screenSize being how many pixels the mesh covers across.
+	void markUsed(TextureHandle texture, float screenSize, uint64_t frame);
+
+	// Levels worth loading, most visible first. They fit in the budget once evictions are done, and each is pending
+	// until setResident.
+	vector<Request> getStreamIns(uint64_t frame, uint32_t maxCount);
+	// Levels to drop to make room, least recently used first. Only when over budget or something visible is waiting.
+	vector<Request> getEvictions(uint64_t frame);
+	// After a request was carried out, or given up on (then with the old base level).
+	void setResident(TextureHandle texture, uint32_t baseLevel);
+
+	// Thread safe, workers hand over what they loaded.
+	void pushLoaded(const Loaded &loaded);
+	vector<Loaded> takeLoaded();
+
+	// Bytes in levels [firstLevel, levelCount) of a width x height level 0.
+	static VkDeviceSize getLevelsSize(VkFormat format, uint32_t width, uint32_t height, uint32_t firstLevel, uint32_t levelCount);
+
+	~TextureStreamer();
+private:
+	struct Entry {
+		TextureHandle texture;
+		string fileName;
+		VkFormat format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t minBaseLevel; // Loaded with the texture, always resident.
+		uint32_t baseLevel; // Finest resident level.
+		bool pending; // Stream-in or eviction in flight.
+		uint32_t pendingBaseLevel; // What it'll be after, resident bytes already count it.
+		uint64_t lastUsed; // Frame.
+		float screenSize; // Largest this frame, or the last one it was used in.
+	};
+
+	std::unordered_map<uint64_t, Entry> _entries; // By handle index and generation.
+	VkDeviceSize _budget{ TEXTURE_MEMORY_BUDGET };
+	VkDeviceSize _residentBytes{ 0 }; // Pending requests count as done.
+	VkDeviceSize _wantedBytes{ 0 }; // Visible stream-ins that didn't fit last time, eviction makes room for them.
+
+	std::mutex _loadedMutex;
+	vector<Loaded> _loaded;
+
+	static uint64_t getKey(TextureHandle texture);
+	Entry &at(TextureHandle texture);
+	// Finest level worth having at the size it was last drawn.
+	uint32_t getWantedLevel(const Entry &entry);
+	VkDeviceSize getResidentSize(const Entry &entry, uint32_t baseLevel);
+	void setPending(Entry &entry, uint32_t baseLevel);
+};
@@ -0,0 +1,123 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	for (uint32_t i{ 0 }; i < threadCount; i++) {
+		_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+uint32_t ThreadPool::getThreadCount() {
+	return static_cast<uint32_t>(_threads.size());
+}
+
+void ThreadPool::parallelFor(uint32_t count, const IndexedJob &job) {
+	parallelFor(count, job, CompletionHandler{});
+}
+
+void ThreadPool::parallelFor(uint32_t count, const IndexedJob &job, const CompletionHandler &onDone) {
+	if (count == 0) {
+		return;
+	}
+
+	uint32_t remaining{ count };
+	std::exception_ptr error;
+	std::mutex doneMutex;
+	std::condition_variable done;
+	std::deque<uint32_t> completed;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (uint32_t i{ 0 }; i < count; i++) {
+			_jobs.push_back([&, i](uint32_t worker) {
+				std::exception_ptr jobError;
+				try {
+					job(i, worker);
+				} catch (...) {
+					jobError = std::current_exception();
+				}
+				std::lock_guard<std::mutex> doneLock(doneMutex);
+				if (jobError && !error) {
+					error = jobError;
+				}
+				if (!jobError && onDone) {
+					completed.push_back(i);
+				}
+				--remaining;
+				done.notify_one();
+			});
+		}
+	}
+	_jobAdded.notify_all();
+
+	// Jobs reference this frame, so even if a handler throws keep going until they've all finished.
+	std::exception_ptr handlerError;
+	std::unique_lock<std::mutex> doneLock(doneMutex);
+	while (true) {
+		done.wait(doneLock, [&] { return remaining == 0 || !completed.empty(); });
+		if (completed.empty()) {
+			break;
+		}
+		const uint32_t index{ completed.front() };
+		completed.pop_front();
+		if (handlerError) {
+			continue;
+		}
+
+		doneLock.unlock();
+		try {
+			onDone(index);
+		} catch (...) {
+			handlerError = std::current_exception();
+		}
+		doneLock.lock();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	if (handlerError) {
+		std::rethrow_exception(handlerError);
+	}
+}
+
+void ThreadPool::submitBackground(const std::function<void(uint32_t worker)> &job) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_backgroundJobs.push_back([job](uint32_t worker) {
+			try {
+				job(worker);
+			} catch (...) {
+			}
+		});
+	}
+	_jobAdded.notify_one();
+}
+
+void ThreadPool::workerLoop(uint32_t worker) {
+	while (true) {
+		std::function<void(uint32_t)> job;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobAdded.wait(lock, [this] { return _stopping || !_jobs.empty() || !_backgroundJobs.empty(); });
+			// Everything queued runs before the workers stop, background jobs included.
+			std::deque<std::function<void(uint32_t)>> &queue{ !_jobs.empty() ? _jobs : _backgroundJobs };
+			if (queue.empty()) {
+				return;
+			}
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+		job(worker);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_jobAdded.notify_all();
+	for (auto &thread : _threads) {
+		thread.join();
+	}
+}
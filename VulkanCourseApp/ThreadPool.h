@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+using std::vector;
+
+// Fixed set of worker threads pulling jobs off one queue. Jobs get the index of the worker running them,
+// so callers can keep per thread state (command pools and the like) without locking.
+class ThreadPool
+{
+public:
+	typedef std::function<void(uint32_t index, uint32_t worker)> IndexedJob;
+	typedef std::function<void(uint32_t index)> CompletionHandler;
+
+	ThreadPool(uint32_t threadCount);
+
+	uint32_t getThreadCount();
+	// Runs job for every index in [0, count) spread over the workers, returns once all of them are done.
+	// The first exception a job throws is rethrown here.
+	void parallelFor(uint32_t count, const IndexedJob &job);
+	// Same, and onDone runs on the calling thread for each index whose job succeeded, in the order they finish,
+	// so results can be used while the rest are still going.
+	void parallelFor(uint32_t count, const IndexedJob &job, const CompletionHandler &onDone);
+	// Runs job once, nothing waits for it. Workers only pick these up when no parallelFor job is queued, so long
+	// ones don't hold up a frame. Whatever it throws is dropped, the job has to report its own failures.
+	void submitBackground(const std::function<void(uint32_t worker)> &job);
+
+	~ThreadPool();
+private:
+	vector<std::thread> _threads;
+	std::deque<std::function<void(uint32_t worker)>> _jobs;
+	std::deque<std::function<void(uint32_t worker)>> _backgroundJobs;
+	std::mutex _mutex;
+	std::condition_variable _jobAdded;
+	bool _stopping{ false };
+
+	void workerLoop(uint32_t worker);
+};
@@ -0,0 +1,178 @@
+#include "TiledLighting.h"
+
+TiledLighting::TiledLighting() {
+}
+
+TiledLighting::TiledLighting(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount) {
+	_physicalDevice = physicalDevice;
+	_device = device;
+	_frameCount = frameCount;
+
+	// Culled in compute, read back when lighting in the fragment shader.
+	VkDescriptorSetLayoutBinding bindings[2]{};
+	for (uint32_t i{ 0 }; i < 2; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = 2;
+	layoutCreateInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(_device, &layoutCreateInfo, nullptr, &_setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the lighting descriptor set layout.");
+	}
+
+	// Both bindings written together from a pair of buffer infos, whenever the tile buffers are rebuilt.
+	VkDescriptorUpdateTemplateEntry templateEntry{};
+	templateEntry.dstBinding = 0;
+	templateEntry.dstArrayElement = 0;
+	templateEntry.descriptorCount = 2; // Runs on into binding 1, same type and stages.
+	templateEntry.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	templateEntry.offset = 0;
+	templateEntry.stride = sizeof(VkDescriptorBufferInfo);
+
+	VkDescriptorUpdateTemplateCreateInfo templateCreateInfo{};
+	templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	templateCreateInfo.descriptorUpdateEntryCount = 1;
+	templateCreateInfo.pDescriptorUpdateEntries = &templateEntry;
+	templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	templateCreateInfo.descriptorSetLayout = _setLayout;
+
+	if (vkCreateDescriptorUpdateTemplate(_device, &templateCreateInfo, nullptr, &_updateTemplate) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the lighting descriptor update template.");
+	}
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = _frameCount * 2;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = _frameCount;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(_device, &poolCreateInfo, nullptr, &_descPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the lighting descriptor pool.");
+	}
+
+	vector<VkDescriptorSetLayout> setLayouts(_frameCount, _setLayout);
+	VkDescriptorSetAllocateInfo setAllocInfo{};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = _descPool;
+	setAllocInfo.descriptorSetCount = _frameCount;
+	setAllocInfo.pSetLayouts = setLayouts.data();
+
+	_descSets.resize(_frameCount);
+	if (vkAllocateDescriptorSets(_device, &setAllocInfo, _descSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate lighting descriptor sets.");
+	}
+
+	// Light buffers never change size, they're written to the sets along with the tile buffers.
+	_lightBuffers.resize(_frameCount);
+	_lightBufferMems.resize(_frameCount);
+	_lightMapped.resize(_frameCount);
+	for (uint32_t i{ 0 }; i < _frameCount; i++) {
+		createBuffer(_physicalDevice, _device, sizeof(PointLight) * MAX_POINT_LIGHTS,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&_lightBuffers[i], &_lightBufferMems[i]);
+
+		void *data;
+		if (vkMapMemory(_device, _lightBufferMems[i], 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map a light buffer.");
+		}
+		_lightMapped[i] = static_cast<PointLight *>(data);
+	}
+}
+
+void TiledLighting::setLights(const vector<PointLight> &lights) {
+	_lights.assign(lights.begin(), lights.begin() + std::min(lights.size(), static_cast<size_t>(MAX_POINT_LIGHTS)));
+}
+
+void TiledLighting::createTileBuffers(VkExtent2D extent) {
+	// Light count then its indices, for every tile.
+	const VkDeviceSize tileCount{ static_cast<VkDeviceSize>((extent.width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE)
+		* ((extent.height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE) };
+	const VkDeviceSize bufferSize{ tileCount * (MAX_LIGHTS_PER_TILE + 1) * sizeof(uint32_t) };
+
+	_tileBuffers.resize(_frameCount);
+	_tileBufferMems.resize(_frameCount);
+	for (uint32_t i{ 0 }; i < _frameCount; i++) {
+		createBuffer(_physicalDevice, _device, bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			&_tileBuffers[i], &_tileBufferMems[i]);
+
+		// Lights at binding 0, tiles at binding 1.
+		VkDescriptorBufferInfo bufferInfos[2]{};
+		bufferInfos[0].buffer = _lightBuffers[i];
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = _tileBuffers[i];
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		vkUpdateDescriptorSetWithTemplate(_device, _descSets[i], _updateTemplate, bufferInfos);
+	}
+}
+
+void TiledLighting::destroyTileBuffers() {
+	for (size_t i{ 0 }; i < _tileBuffers.size(); i++) {
+		vkDestroyBuffer(_device, _tileBuffers[i], nullptr);
+		vkFreeMemory(_device, _tileBufferMems[i], nullptr);
+	}
+	_tileBuffers.clear();
+	_tileBufferMems.clear();
+}
+
+void TiledLighting::update(uint32_t frame, const glm::mat4 &view) {
+	if (_lights.empty()) {
+		return;
+	}
+
+	// Culling and lighting both work in view space, so it's done once here rather than per tile and pixel.
+	PointLight *viewLights{ _lightMapped[frame] };
+	for (size_t i{ 0 }; i < _lights.size(); i++) {
+		viewLights[i] = _lights[i];
+		viewLights[i].position = glm::vec3(view * glm::vec4(_lights[i].position, 1.0f));
+	}
+}
+
+PushLighting TiledLighting::getPush(const glm::mat4 &proj, VkExtent2D renderExtent) {
+	PushLighting push{};
+	push.projParams = glm::vec4(proj[0][0], proj[1][1], proj[2][2], proj[3][2]);
+	push.extent = glm::vec2(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height));
+	push.tileCount = glm::uvec2((renderExtent.width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE,
+		(renderExtent.height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE);
+	push.lightCount = static_cast<uint32_t>(_lights.size());
+	return push;
+}
+
+VkDescriptorSetLayout TiledLighting::getDescriptorSetLayout() {
+	return _setLayout;
+}
+
+VkDescriptorSet TiledLighting::getDescriptorSet(uint32_t frame) {
+	return _descSets[frame];
+}
+
+void TiledLighting::destroy() {
+	destroyTileBuffers();
+	for (size_t i{ 0 }; i < _lightBuffers.size(); i++) {
+		vkUnmapMemory(_device, _lightBufferMems[i]);
+		vkDestroyBuffer(_device, _lightBuffers[i], nullptr);
+		vkFreeMemory(_device, _lightBufferMems[i], nullptr);
+	}
+	_lightBuffers.clear();
+	_lightBufferMems.clear();
+	_lightMapped.clear();
+
+	vkDestroyDescriptorUpdateTemplate(_device, _updateTemplate, nullptr);
+	vkDestroyDescriptorPool(_device, _descPool, nullptr);
+	vkDestroyDescriptorSetLayout(_device, _setLayout, nullptr);
+}
+
+TiledLighting::~TiledLighting() {
+}
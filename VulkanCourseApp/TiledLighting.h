@@ -0,0 +1,62 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <algorithm>
+
+#include "Utilities.h"
+
+using std::vector;
+
+// Point lights for the deferred lighting subpass. Lights are uploaded in view space each frame, a compute pass
+// bins them into LIGHT_TILE_SIZE screen tiles, and each pixel only shades the lights in its tile.
+// Tiles are only culled against their side planes (no depth bounds), so culling can run before the G-buffer
+// instead of splitting it from the lighting subpass.
+class TiledLighting
+{
+public:
+	TiledLighting();
+	TiledLighting(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t frameCount);
+
+	// Lights past MAX_POINT_LIGHTS are dropped.
+	void setLights(const vector<PointLight> &lights);
+
+	// Tile lists cover the given extent, rebuild them with the swapchain.
+	void createTileBuffers(VkExtent2D extent);
+	void destroyTileBuffers();
+
+	// Copy this frame's lights, moved into view space.
+	void update(uint32_t frame, const glm::mat4 &view);
+
+	// Same push for culling and lighting, over the extent being rendered.
+	PushLighting getPush(const glm::mat4 &proj, VkExtent2D renderExtent);
+
+	// Lights at binding 0, tile lists at binding 1. Per frame in flight.
+	VkDescriptorSetLayout getDescriptorSetLayout();
+	VkDescriptorSet getDescriptorSet(uint32_t frame);
+
+	void destroy();
+
+	~TiledLighting();
+private:
+	VkPhysicalDevice _physicalDevice;
+	VkDevice _device;
+	uint32_t _frameCount{ 0 };
+
+	vector<PointLight> _lights;
+
+	VkDescriptorSetLayout _setLayout{ VK_NULL_HANDLE };
+	VkDescriptorPool _descPool{ VK_NULL_HANDLE };
+	VkDescriptorUpdateTemplate _updateTemplate{ VK_NULL_HANDLE };
+	vector<VkDescriptorSet> _descSets;
+
+	// Per frame in flight. Lights are written by the host, tile lists only by the cull pass.
+	vector<VkBuffer> _lightBuffers;
+	vector<VkDeviceMemory> _lightBufferMems;
+	vector<PointLight *> _lightMapped; // Mapped for as long as they live.
+	vector<VkBuffer> _tileBuffers;
+	vector<VkDeviceMemory> _tileBufferMems;
+};
@@ -0,0 +1,136 @@
+#include "TimelineScheduler.h"
+
+TimelineScheduler::TimelineScheduler() {
+}
+
+TimelineScheduler::TimelineScheduler(VkDevice device, VkQueue graphicsQueue, VkQueue computeQueue) {
+	_device = device;
+	_sharedQueue = computeQueue == VK_NULL_HANDLE;
+	_queues[0] = graphicsQueue;
+	_queues[1] = _sharedQueue ? graphicsQueue : computeQueue;
+
+	VkSemaphoreTypeCreateInfo typeCreateInfo{};
+	typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	createInfo.pNext = &typeCreateInfo;
+
+	// Signals have to arrive in order, so one timeline per queue.
+	const uint32_t timelineCount{ _sharedQueue ? 1u : 2u };
+	for (uint32_t i{ 0 }; i < timelineCount; i++) {
+		if (vkCreateSemaphore(_device, &createInfo, nullptr, &_timelines[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a timeline semaphore.");
+		}
+	}
+}
+
+TimelineScheduler::Point TimelineScheduler::submit(Queue queue, VkCommandBuffer commandBuffer, const vector<Wait> &waits,
+	VkSemaphore binaryWait, VkPipelineStageFlags binaryWaitStages, VkSemaphore binarySignal) {
+	const uint32_t index{ getIndex(queue) };
+
+	// Waits on its own queue's earlier points are already covered by submission order.
+	vector<VkSemaphore> waitSemaphores;
+	vector<uint64_t> waitValues;
+	vector<VkPipelineStageFlags> waitStages;
+	for (const auto &wait : waits) {
+		const uint32_t waitIndex{ getIndex(wait.point.queue) };
+		if (waitIndex == index || wait.point.value == 0) {
+			continue;
+		}
+		waitSemaphores.push_back(_timelines[waitIndex]);
+		waitValues.push_back(wait.point.value);
+		waitStages.push_back(wait.stages);
+	}
+	if (binaryWait != VK_NULL_HANDLE) {
+		waitSemaphores.push_back(binaryWait);
+		waitValues.push_back(0); // Ignored for binary semaphores.
+		waitStages.push_back(binaryWaitStages);
+	}
+
+	const uint64_t value{ _lastSubmitted[index] + 1 };
+	vector<VkSemaphore> signalSemaphores{ _timelines[index] };
+	vector<uint64_t> signalValues{ value };
+	if (binarySignal != VK_NULL_HANDLE) {
+		signalSemaphores.push_back(binarySignal);
+		signalValues.push_back(0);
+	}
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = commandBuffer != VK_NULL_HANDLE ? 1 : 0;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	if (vkQueueSubmit(_queues[index], 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error(queue == Queue::Compute ? "Failed to submit to compute queue." : "Failed to submit to graphics queue.");
+	}
+	_lastSubmitted[index] = value;
+
+	return { queue, value };
+}
+
+bool TimelineScheduler::isComplete(Point point) {
+	uint64_t value{ 0 };
+	if (vkGetSemaphoreCounterValue(_device, _timelines[getIndex(point.queue)], &value) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to read a timeline semaphore.");
+	}
+	return value >= point.value;
+}
+
+void TimelineScheduler::wait(Point point) {
+	if (point.value == 0) {
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &_timelines[getIndex(point.queue)];
+	waitInfo.pValues = &point.value;
+
+	if (vkWaitSemaphores(_device, &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to wait on a timeline semaphore.");
+	}
+}
+
+void TimelineScheduler::waitIdle() {
+	wait(getLastSubmitted(Queue::Graphics));
+	if (!_sharedQueue) {
+		wait(getLastSubmitted(Queue::Compute));
+	}
+}
+
+TimelineScheduler::Point TimelineScheduler::getLastSubmitted(Queue queue) {
+	return { queue, _lastSubmitted[getIndex(queue)] };
+}
+
+void TimelineScheduler::destroy() {
+	for (auto &timeline : _timelines) {
+		if (timeline != VK_NULL_HANDLE) {
+			vkDestroySemaphore(_device, timeline, nullptr);
+			timeline = VK_NULL_HANDLE;
+		}
+	}
+}
+
+uint32_t TimelineScheduler::getIndex(Queue queue) {
+	return queue == Queue::Compute && !_sharedQueue ? 1 : 0;
+}
+
+TimelineScheduler::~TimelineScheduler() {
+}
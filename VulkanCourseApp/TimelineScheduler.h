@@ -0,0 +1,55 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <stdexcept>
+#include <limits>
+
+using std::vector;
+
+// Every submit on a queue signals that queue's timeline semaphore with the next value, so a point on a timeline
+// says when that work is done. Frames, uploads and async compute all go through here. Reusing or destroying
+// something waits on the point of the last submit using it, not on a fence or an idle queue.
+class TimelineScheduler
+{
+public:
+	enum class Queue { Graphics, Compute };
+
+	struct Point {
+		Queue queue{ Queue::Graphics };
+		uint64_t value{ 0 }; // 0 is signaled from the start.
+	};
+
+	struct Wait {
+		Point point;
+		VkPipelineStageFlags stages;
+	};
+
+	TimelineScheduler();
+	// Without a separate compute queue (VK_NULL_HANDLE) compute submits go to the graphics queue.
+	TimelineScheduler(VkDevice device, VkQueue graphicsQueue, VkQueue computeQueue);
+
+	// Binary semaphores are only for the swapchain, which can't use timelines.
+	Point submit(Queue queue, VkCommandBuffer commandBuffer, const vector<Wait> &waits,
+		VkSemaphore binaryWait = VK_NULL_HANDLE, VkPipelineStageFlags binaryWaitStages = 0, VkSemaphore binarySignal = VK_NULL_HANDLE);
+
+	bool isComplete(Point point);
+	void wait(Point point);
+	// Everything submitted so far, on every queue.
+	void waitIdle();
+	Point getLastSubmitted(Queue queue);
+
+	void destroy();
+
+	~TimelineScheduler();
+private:
+	VkDevice _device;
+	VkQueue _queues[2]{ VK_NULL_HANDLE, VK_NULL_HANDLE };
+	VkSemaphore _timelines[2]{ VK_NULL_HANDLE, VK_NULL_HANDLE };
+	uint64_t _lastSubmitted[2]{ 0, 0 };
+	bool _sharedQueue{ true }; // Compute goes to the graphics queue, so one timeline covers both.
+
+	uint32_t getIndex(Queue queue);
+};
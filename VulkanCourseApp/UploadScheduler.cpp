@@ -0,0 +1,132 @@
+#include "UploadScheduler.h"
+
+#include "Utilities.h"
+
+UploadScheduler::UploadScheduler() {
+}
+
+uint64_t UploadScheduler::enqueue(vector<Step> steps, std::function<void()> release) {
+	for (const auto &step : steps) {
+		_pendingBytes += step.bytes;
+	}
+	_queued.push_back({ ++_lastBatch, std::move(steps), 0, std::move(release), {} });
+	return _lastBatch;
+}
+
+bool UploadScheduler::isComplete(uint64_t batch) {
+	return batch <= _lastComplete;
+}
+
+uint64_t UploadScheduler::getLastBatch() {
+	return _lastBatch;
+}
+
+VkDeviceSize UploadScheduler::getPendingBytes() {
+	return _pendingBytes;
+}
+
+bool UploadScheduler::isIdle() {
+	return _lastComplete == _lastBatch;
+}
+
+bool UploadScheduler::record(VkCommandBuffer commandBuffer, VkDeviceSize budget) {
+	if (_queued.empty()) {
+		return false;
+	}
+
+	// Batches with nothing left to copy still go through a submit, so they complete in order.
+	VkDeviceSize recordedBytes{ 0 };
+	bool recordedStep{ false };
+	while (!_queued.empty()) {
+		Batch &batch{ _queued.front() };
+		while (batch.nextStep < batch.steps.size() && (!recordedStep || recordedBytes < budget)) {
+			const Step &step{ batch.steps[batch.nextStep++] };
+			step.record(commandBuffer);
+			recordedBytes += step.bytes;
+			recordedStep = true;
+		}
+		if (batch.nextStep < batch.steps.size()) {
+			break;
+		}
+		_recorded.push_back(std::move(batch));
+		_queued.pop_front();
+	}
+	_pendingBytes -= recordedBytes;
+	return true;
+}
+
+void UploadScheduler::submitted(TimelineScheduler::Point point) {
+	for (auto &batch : _recorded) {
+		batch.lastPoint = point;
+		_inFlight.push_back(std::move(batch));
+	}
+	_recorded.clear();
+}
+
+bool UploadScheduler::collect(TimelineScheduler &scheduler) {
+	// All submits are on the graphics queue, so points complete in order as well.
+	bool landed{ false };
+	while (!_inFlight.empty() && scheduler.isComplete(_inFlight.front().lastPoint)) {
+		Batch &batch{ _inFlight.front() };
+		if (batch.release) {
+			batch.release();
+		}
+		_lastComplete = batch.id;
+		_inFlight.pop_front();
+		landed = true;
+	}
+	return landed;
+}
+
+void UploadScheduler::flush() {
+	for (auto &batch : _inFlight) {
+		if (batch.release) {
+			batch.release();
+		}
+	}
+	for (auto &batch : _recorded) {
+		if (batch.release) {
+			batch.release();
+		}
+	}
+	for (auto &batch : _queued) {
+		if (batch.release) {
+			batch.release();
+		}
+	}
+	_inFlight.clear();
+	_recorded.clear();
+	_queued.clear();
+	_lastComplete = _lastBatch;
+	_pendingBytes = 0;
+}
+
+void UploadScheduler::addBufferCopy(vector<Step> &steps, VkBuffer srcBuf, VkDeviceSize srcOffset, VkBuffer dstBuf, VkDeviceSize size) {
+	for (VkDeviceSize offset{ 0 }; offset < size; offset += UPLOAD_CHUNK_SIZE) {
+		const VkDeviceSize chunkSize{ std::min(UPLOAD_CHUNK_SIZE, size - offset) };
+		steps.push_back({ chunkSize, [srcBuf, srcOffset, dstBuf, offset, chunkSize](VkCommandBuffer commandBuffer) {
+			recordCopyBuffer(commandBuffer, srcBuf, srcOffset + offset, dstBuf, offset, chunkSize);
+		} });
+	}
+}
+
+void UploadScheduler::addImageCopy(vector<Step> &steps, VkBuffer srcBuf, VkDeviceSize srcOffset, VkImage dstImg,
+	uint32_t mipLevel, uint32_t width, uint32_t height, VkDeviceSize blockBytes, uint32_t blockDim) {
+	// Block rows per step, a single one can be over the chunk size.
+	const VkDeviceSize rowBytes{ (width + blockDim - 1) / blockDim * blockBytes };
+	const uint32_t blockRows{ (height + blockDim - 1) / blockDim };
+	const uint32_t rowsPerStep{ std::max(static_cast<uint32_t>(UPLOAD_CHUNK_SIZE / rowBytes), 1u) };
+	for (uint32_t row{ 0 }; row < blockRows; row += rowsPerStep) {
+		const uint32_t rowCount{ std::min(rowsPerStep, blockRows - row) };
+		// Texel rows, the last block row can hang over the level's edge.
+		const uint32_t y{ row * blockDim };
+		const uint32_t stepHeight{ std::min(rowCount * blockDim, height - y) };
+		const VkDeviceSize offset{ srcOffset + row * rowBytes };
+		steps.push_back({ rowCount * rowBytes, [srcBuf, offset, dstImg, width, stepHeight, mipLevel, y](VkCommandBuffer commandBuffer) {
+			recordCopyImageBuffer(commandBuffer, srcBuf, offset, dstImg, width, stepHeight, mipLevel, y);
+		} });
+	}
+}
+
+UploadScheduler::~UploadScheduler() {
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <functional>
+
+#include "TimelineScheduler.h"
+
+using std::vector;
+
+// Buffer and image copies waiting to go to the GPU. Each frame records the next ones up to a byte budget, so
+// loading something spreads over frames instead of stalling one. An asset's copies form a batch, which is complete
+// once its last copy has landed. Batches are recorded in the order they're queued and complete in that order too,
+// so a batch being complete means every one before it is.
+class UploadScheduler
+{
+public:
+	struct Step {
+		VkDeviceSize bytes; // Counted against the budget.
+		std::function<void(VkCommandBuffer commandBuffer)> record;
+	};
+
+	UploadScheduler();
+
+	// Steps are recorded in order, over as many frames as it takes. release runs once they've all landed, to free
+	// the staging they copy from. Returns the batch, they start at 1.
+	uint64_t enqueue(vector<Step> steps, std::function<void()> release);
+	// 0 is always complete.
+	bool isComplete(uint64_t batch);
+	// The last batch queued, 0 before any.
+	uint64_t getLastBatch();
+	VkDeviceSize getPendingBytes();
+	bool isIdle();
+
+	// Records steps until budget is used up, at least one so big ones still get through. False when nothing was
+	// queued, the command buffer can go unsubmitted then.
+	bool record(VkCommandBuffer commandBuffer, VkDeviceSize budget);
+	// Where the commands just recorded were submitted.
+	void submitted(TimelineScheduler::Point point);
+	// Releases the batches that have landed, true if there were any.
+	bool collect(TimelineScheduler &scheduler);
+	// Releases everything, landed or not. Only once the device is idle.
+	void flush();
+
+	// Copies split into steps of at most UPLOAD_CHUNK_SIZE.
+	static void addBufferCopy(vector<Step> &steps, VkBuffer srcBuf, VkDeviceSize srcOffset, VkBuffer dstBuf, VkDeviceSize size);
+	// One level, in whole rows of blocks. Uncompressed formats have 1x1 blocks of their texel size.
+	static void addImageCopy(vector<Step> &steps, VkBuffer srcBuf, VkDeviceSize srcOffset, VkImage dstImg,
+		uint32_t mipLevel, uint32_t width, uint32_t height, VkDeviceSize blockBytes, uint32_t blockDim);
+
+	~UploadScheduler();
+private:
+	struct Batch {
+		uint64_t id;
+		vector<Step> steps;
+		size_t nextStep;
+		std::function<void()> release;
+		TimelineScheduler::Point lastPoint;
+	};
+
+	std::deque<Batch> _queued; // Not all recorded yet, the front one may be partly.
+	vector<Batch> _recorded; // Fully recorded, waiting for their submit.
+	std::deque<Batch> _inFlight; // Submitted, in order.
+	uint64_t _lastBatch{ 0 };
+	uint64_t _lastComplete{ 0 };
+	VkDeviceSize _pendingBytes{ 0 };
+};
@@ -2,17 +2,39 @@
 
 #include <vector>
 #include <fstream>
+#include <cctype>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "SlotMap.h"
+
 using std::vector;
 using std::string;
 using std::ifstream;
 using std::ios;
 
 const int MAX_FRAME_DRAWS = 3;
-const int MAX_OBJECTS = 10;
+const VkDeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024; // Per frame upload space, for each frame in flight.
+const VkDeviceSize TEXTURE_STAGING_SIZE = 64 * 1024 * 1024; // Textures loading at once share it, bigger ones get their own.
+// Buffer and image uploads are queued and copied a bit each frame, see UploadScheduler.
+const VkDeviceSize UPLOAD_FRAME_BUDGET = 8 * 1024 * 1024; // Default, see VulkanRenderer::setUploadBudget.
+const VkDeviceSize UPLOAD_CHUNK_SIZE = 1024 * 1024; // Copies are split into pieces about this big, the budget stops between them.
+// Texture streaming. Textures load with their levels up to the base size, finer ones stream in as they're needed on screen.
+const uint32_t TEXTURE_STREAMING_BASE_SIZE = 64;
+const VkDeviceSize TEXTURE_MEMORY_BUDGET = 256 * 1024 * 1024; // Default, see VulkanRenderer::setTextureBudget.
+const uint64_t TEXTURE_EVICT_FRAMES = 120; // Unused for this many frames, a texture's streamed levels can be evicted.
+// Texture atlases, see ModelImportOptions. Textures no bigger than the max size on either side share pages.
+const uint32_t ATLAS_PAGE_SIZE = 1024;
+const uint32_t ATLAS_MAX_TEXTURE_SIZE = 256;
+const uint32_t ATLAS_PADDING = 8; // A power of two, pages get log2 of it plus one mip levels.
+const int MAX_TEXTURES = 4096; // Bindless texture array size, lowered to the device limit if it's smaller.
+const uint32_t MIN_DRAWS_PER_CHUNK = 256; // Scene draws recorded per secondary buffer at least, fewer don't pay for the thread hop.
+
+// Tiled lighting. Tile size and per tile limit are repeated in light_cull.comp and deferred.frag.
+const int MAX_POINT_LIGHTS = 4096;
+const int LIGHT_TILE_SIZE = 16;
+const int MAX_LIGHTS_PER_TILE = 128;
 
 const vector<const char *> DEVICE_EXTENSIONS{
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
@@ -24,16 +46,63 @@ struct UboViewProjection {
 	glm::mat4 view;
 };
 
+// Scene draw push constants, set per mesh. Model matrices are in this frame's allocation, textures in the bindless array.
+struct PushModel {
+	uint32_t modelIndex;
+	uint32_t texId;
+};
+
+// Upscale pass push constants, maps output pixels onto the region the scene was rendered into.
+struct PushUpscale {
+	glm::vec2 uvScale; // Output pixel coord to scene image uv.
+	glm::vec2 uvMax; // Last texel center inside the rendered region, stops filtering outside it.
+};
+
+// How a post effect runs. Async compute falls back to the graphics queue without a separate compute family.
+enum class PostEffectMode { Fragment, Compute, AsyncCompute };
+
+// Full screen effect on the scene color, run in the order added.
+// Fragment effects read color and depth as input attachments 0 and 1.
+// Compute effects sample them at bindings 0 and 1, and store to the rgba8 image at binding 2 in 8x8 groups.
+struct PostEffect {
+	string name;
+	string shaderFile;
+	PostEffectMode mode;
+};
+
+// Post effect push constants.
+struct PushPost {
+	glm::vec2 extent; // Pixels the effect covers.
+};
+
+// Matches std430 in the lighting shaders, vec3 + float pack into 16 bytes.
+struct PointLight {
+	glm::vec3 position; // World space, view space once uploaded.
+	float radius; // Light reaches zero here.
+	glm::vec3 color;
+	float intensity;
+};
+
+// Light culling and lighting push constants.
+struct PushLighting {
+	glm::vec4 projParams; // proj[0][0], proj[1][1], proj[2][2], proj[3][2]. Enough to go between view space and ndc.
+	glm::vec2 extent; // Pixels being lit.
+	glm::uvec2 tileCount;
+	uint32_t lightCount;
+};
+
 struct Vertex {
 	glm::vec3 pos; // vertex position (x, y, z)
 	glm::vec3 col; // vertex color (r, g, b)
 	glm::vec2 tex; // Texture coords (u, v)
+	glm::vec3 norm; // Vertex normal (x, y, z)
 };
 
 // Indices (locations) of Queue Families (if the exist at all)
 struct QueueFamilyIndices {
 	int graphicsFamily{ -1 }; // location of graphics queue family.
 	int presentationFamily{ -1 }; // Location of pres queue family.
+	int computeFamily{ -1 }; // Compute only family for async compute, optional.
 	// Check if queue families are valid.
 	bool isValid() {
 		return graphicsFamily >= 0 && presentationFamily >= 0;
@@ -51,6 +120,25 @@ struct SwapchainImage {
 	VkImageView imageView;
 };
 
+// Texture in the bindless array. Meshes refer to it by array element. Streaming swaps in a new image under a new
+// element when the resident levels change, since one still used by frames in flight can't be rewritten.
+struct Texture {
+	VkImage image;
+	VkDeviceMemory memory;
+	VkImageView view;
+	int arrayElement;
+	VkFormat format;
+	uint32_t width; // Of the image's first level, which is baseLevel of the full texture.
+	uint32_t height;
+	uint32_t baseLevel;
+	uint32_t mipLevels; // In the image.
+};
+
+struct ModelInstance;
+typedef Handle<ModelInstance> ModelHandle;
+struct TextureAsset;
+typedef Handle<TextureAsset> TextureHandle;
+
 static vector<char> readFile(const string &filename) {
 	// Open stream from given file.
 	// ios::binary tells stream to read as binary, ios::ate tells stream to start reading from the end.
@@ -72,6 +160,61 @@ static vector<char> readFile(const string &filename) {
 	return fileBuffer;
 }
 
+// Cache key for a file path. Same separators and case, "." and ".." resolved, so spellings of one file match.
+static string normalizeAssetPath(const string &path) {
+	vector<string> parts;
+	string part;
+	for (size_t i{ 0 }; i <= path.size(); i++) {
+		const char c{ i < path.size() ? path[i] : '/' };
+		if (c != '/' && c != '\\') {
+			part += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			continue;
+		}
+		if (part == "..") {
+			if (!parts.empty() && parts.back() != "..") {
+				parts.pop_back();
+			}
+			else {
+				parts.push_back(part);
+			}
+		}
+		else if (!part.empty() && part != ".") {
+			parts.push_back(part);
+		}
+		part.clear();
+	}
+
+	string normalized{ !path.empty() && (path[0] == '/' || path[0] == '\\') ? "/" : "" };
+	for (size_t i{ 0 }; i < parts.size(); i++) {
+		normalized += (i == 0 ? "" : "/") + parts[i];
+	}
+	return normalized;
+}
+
+// FNV-1a, to spot the same content under different paths. Pass the last result as the seed to hash several pieces.
+static uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull) {
+	const unsigned char *bytes{ static_cast<const unsigned char *>(data) };
+	uint64_t hash{ seed };
+	for (size_t i{ 0 }; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static bool hasMemoryType(VkPhysicalDevice phyDev, uint32_t allowedTypes, VkMemoryPropertyFlags propFlags) {
+	VkPhysicalDeviceMemoryProperties memProps{};
+	vkGetPhysicalDeviceMemoryProperties(phyDev, &memProps);
+
+	for (uint32_t i{ 0 }; i < memProps.memoryTypeCount; i++) {
+		if ((allowedTypes & (1 << i)) && (memProps.memoryTypes[i].propertyFlags & propFlags) == propFlags) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static uint32_t findMemoryTypeIndex(VkPhysicalDevice phyDev, uint32_t allowedTypes, VkMemoryPropertyFlags propFlags) {
 	// Get the properties of my physical device memory.
 	VkPhysicalDeviceMemoryProperties memProps{};
@@ -128,106 +271,45 @@ static void createBuffer(VkPhysicalDevice phyDev, VkDevice device, VkDeviceSize
 
 }
 
-static VkCommandBuffer beginCommandBuffer(VkDevice device, VkCommandPool commandPool) {
-	// Command buffer to hodl transfer command.
-	VkCommandBuffer commandBuffer;
-
-	// Command buffer details
-	VkCommandBufferAllocateInfo allocInfo{};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool;
-	allocInfo.commandBufferCount = 1;
-
-	// Allocate command buffer from pool.
-	if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate transfer command buffer.");
-	}
-
-	// Information to begin the command buffer record.
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // We're only using the command buffer once. Set up for one time use.
-
-	// Begin recording transfer commands.
-	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to begin transfer command buffer.");
-	}
-
-	return commandBuffer;
-}
-
-static void endAndSubmitCommandBuffer(VkDevice device, VkCommandPool commandPool, VkQueue queue, VkCommandBuffer commandBuffer) {
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to end transfer command buffer.");
-	}
-
-	// Queue submission info.
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	// Submit transfer commands and wait until complete
-	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit transfer queue.");
-	}
-
-	if (vkQueueWaitIdle(queue) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to wait for queue.");
-	}
-
-	// Free temp cmd buf back to pool
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
-
-static void copyBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool,
-	VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize bufSize) {	
-	// Create buffer.
-	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
-
+// Copies and transitions below only record, into a command buffer the caller submits. Uploads go through
+// UploadScheduler.
+static void recordCopyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuf, VkDeviceSize srcOffset,
+	VkBuffer dstBuf, VkDeviceSize dstOffset, VkDeviceSize size) {
 	// Region of data to copy from and to.
 	VkBufferCopy bufferCopyRegion{};
-	bufferCopyRegion.srcOffset = 0; // Copy from the beginning.
-	bufferCopyRegion.dstOffset = 0; // Copy to the start of the dst.
-	bufferCopyRegion.size = bufSize;
+	bufferCopyRegion.srcOffset = srcOffset;
+	bufferCopyRegion.dstOffset = dstOffset;
+	bufferCopyRegion.size = size;
 
 	// Command to copy our source buf to dst buf.
-	vkCmdCopyBuffer(transferCommandBuffer, srcBuf, dstBuf, 1, &bufferCopyRegion);
-
-	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
+	vkCmdCopyBuffer(commandBuffer, srcBuf, dstBuf, 1, &bufferCopyRegion);
 }
 
-static void copyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCommandPool, 
-	VkBuffer srcBuf, VkImage dstImg, uint32_t width, uint32_t height) {
-	VkCommandBuffer transferCommandBuffer = beginCommandBuffer(device, transferCommandPool);
-
+// Rows [y, y + height) of a level, for copying one in pieces. Tightly packed from srcOffset.
+static void recordCopyImageBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuf, VkDeviceSize srcOffset, VkImage dstImg,
+	uint32_t width, uint32_t height, uint32_t mipLevel, uint32_t y = 0) {
 	VkBufferImageCopy imageRegion{};
-	imageRegion.bufferOffset = 0; // Offset into data.
+	imageRegion.bufferOffset = srcOffset; // Offset into data.
 	imageRegion.bufferRowLength = 0; // Row length of data to calculate data spacing.
 	imageRegion.bufferImageHeight = 0; // Image height to calculate data spacing. Tightly packed pixels.
 	imageRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Which aspect of image to copy.
-	imageRegion.imageSubresource.mipLevel = 0; // Mipmap level to copy.
+	imageRegion.imageSubresource.mipLevel = mipLevel; // Mipmap level to copy.
 	imageRegion.imageSubresource.baseArrayLayer = 0; // Starting array layer (if array)
 	imageRegion.imageSubresource.layerCount = 1; // Number of layers to copy starting at baseArrayLayer.
-	imageRegion.imageOffset = { 0, 0, 0 }; // Offset into image, as opposed to raw data in buffer offset.
+	imageRegion.imageOffset = { 0, static_cast<int32_t>(y), 0 }; // Offset into image, as opposed to raw data in buffer offset.
 	imageRegion.imageExtent = { width, height, 1 }; // Size of region to copy as (x, y, z) values.
 	
 	// Copy buffer to given image.
-	vkCmdCopyBufferToImage(transferCommandBuffer, 
+	vkCmdCopyBufferToImage(commandBuffer, 
 		srcBuf, 
 		dstImg,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, // Needs to be formattted so it's optimal to have data transferred to it.
 		1,
 		&imageRegion);
-
-	endAndSubmitCommandBuffer(device, transferCommandPool, transferQueue, transferCommandBuffer);
 }
 
-static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool, VkImage image,
-	VkImageLayout oldLayout, VkImageLayout newLayout) {
-	VkCommandBuffer commandBuffer = beginCommandBuffer(device, commandPool);
-
+static void recordTransitionImageLayout(VkCommandBuffer commandBuffer, VkImage image,
+	uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout) {
 	VkImageMemoryBarrier imageBarrier{};
 	imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	imageBarrier.oldLayout = oldLayout;
@@ -237,7 +319,7 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
 	imageBarrier.image = image;
 	imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT; // Aspect of image being altered.
 	imageBarrier.subresourceRange.baseMipLevel = 0; // First mip level to start alterations on.
-	imageBarrier.subresourceRange.levelCount = 1; // Number of mip levels to alter starting from baseMipLevel.
+	imageBarrier.subresourceRange.levelCount = mipLevels; // Number of mip levels to alter starting from baseMipLevel.
 	imageBarrier.subresourceRange.baseArrayLayer = 0; // First layer to start alterations on.
 	imageBarrier.subresourceRange.layerCount = 1; // Number of layers to alter starting from base array layer.
 
@@ -270,9 +352,173 @@ static void transitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool
 		nullptr, // buffer memory barrier.
 		1,
 		&imageBarrier);
+}
 
-	endAndSubmitCommandBuffer(device, commandPool, queue, commandBuffer);
+// Full chain down to 1x1.
+static uint32_t getMipLevelCount(uint32_t width, uint32_t height) {
+	uint32_t levels{ 1 };
+	for (uint32_t size{ width > height ? width : height }; size > 1; size /= 2) {
+		levels++;
+	}
+	return levels;
+}
 
+// Fills levels 1 and down by blitting each from the one above, level 0 has to be written already. All levels start
+// in TRANSFER_DST and finish SHADER_READ_ONLY. The format needs linear filtering, see buildMipChain otherwise.
+static void recordGenerateMipmaps(VkCommandBuffer commandBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels) {
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.layerCount = 1;
+
+	int32_t mipWidth{ static_cast<int32_t>(width) };
+	int32_t mipHeight{ static_cast<int32_t>(height) };
+	for (uint32_t level{ 1 }; level < mipLevels; level++) {
+		// Level above becomes the source.
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		const int32_t nextWidth{ mipWidth > 1 ? mipWidth / 2 : 1 };
+		const int32_t nextHeight{ mipHeight > 1 ? mipHeight / 2 : 1 };
+
+		VkImageBlit blit{};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		// Done with as a source, ready for sampling.
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &barrier);
+
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	// Smallest level was only ever written.
+	barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+// Copies levels [srcFirstLevel, srcFirstLevel + levelCount) of a sampled image into levels 0 and down of a new one,
+// which ends up sampled. width and height are dstImage's. srcImage goes back to being sampled after.
+static void recordCopyImageLevels(VkCommandBuffer commandBuffer, VkImage srcImage, uint32_t srcFirstLevel,
+	VkImage dstImage, uint32_t width, uint32_t height, uint32_t levelCount) {
+	// Frames already submitted sample it, the copy goes after them.
+	VkImageMemoryBarrier srcBarrier{};
+	srcBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	srcBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	srcBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	srcBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	srcBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	srcBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	srcBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	srcBarrier.image = srcImage;
+	srcBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	srcBarrier.subresourceRange.baseMipLevel = srcFirstLevel;
+	srcBarrier.subresourceRange.levelCount = levelCount;
+	srcBarrier.subresourceRange.layerCount = 1;
+	VkImageMemoryBarrier dstBarrier{ srcBarrier };
+	dstBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	dstBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	dstBarrier.srcAccessMask = 0;
+	dstBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	dstBarrier.image = dstImage;
+	dstBarrier.subresourceRange.baseMipLevel = 0;
+	const VkImageMemoryBarrier barriers[]{ srcBarrier, dstBarrier };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+		0, nullptr, 0, nullptr, 2, barriers);
+
+	// Whole levels, so block compressed extents are fine at any size.
+	vector<VkImageCopy> regions(levelCount);
+	for (uint32_t level{ 0 }; level < levelCount; level++) {
+		regions[level].srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[level].srcSubresource.mipLevel = srcFirstLevel + level;
+		regions[level].srcSubresource.layerCount = 1;
+		regions[level].dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[level].dstSubresource.mipLevel = level;
+		regions[level].dstSubresource.layerCount = 1;
+		regions[level].extent = { width > (1u << level) ? width >> level : 1, height > (1u << level) ? height >> level : 1, 1 };
+	}
+	vkCmdCopyImage(commandBuffer, srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		levelCount, regions.data());
+
+	// Frames submitted before the new one is swapped in still sample the source.
+	srcBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	srcBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	srcBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	srcBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	dstBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	dstBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	dstBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	dstBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	const VkImageMemoryBarrier doneBarriers[]{ srcBarrier, dstBarrier };
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+		0, nullptr, 0, nullptr, 2, doneBarriers);
+}
+
+// CPU fallback for formats that can't be blitted with a linear filter. 2x2 box filter on RGBA8, levels 1 and down
+// packed one after the other.
+static vector<uint8_t> buildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t mipLevels) {
+	vector<uint8_t> chain;
+	const uint8_t *src{ pixels };
+	uint32_t srcWidth{ width };
+	uint32_t srcHeight{ height };
+	size_t srcOffset{ 0 };
+	for (uint32_t level{ 1 }; level < mipLevels; level++) {
+		const uint32_t dstWidth{ srcWidth > 1 ? srcWidth / 2 : 1 };
+		const uint32_t dstHeight{ srcHeight > 1 ? srcHeight / 2 : 1 };
+		const size_t dstOffset{ chain.size() };
+		chain.resize(dstOffset + static_cast<size_t>(dstWidth) * dstHeight * 4);
+		// Resizing moves the chain, so the source is found again by offset.
+		if (level > 1) {
+			src = chain.data() + srcOffset;
+		}
+
+		uint8_t *dst{ chain.data() + dstOffset };
+		for (uint32_t y{ 0 }; y < dstHeight; y++) {
+			const uint32_t y0{ y * 2 };
+			const uint32_t y1{ y0 + 1 < srcHeight ? y0 + 1 : y0 };
+			for (uint32_t x{ 0 }; x < dstWidth; x++) {
+				const uint32_t x0{ x * 2 };
+				const uint32_t x1{ x0 + 1 < srcWidth ? x0 + 1 : x0 };
+				for (uint32_t c{ 0 }; c < 4; c++) {
+					const uint32_t sum{ static_cast<uint32_t>(src[(y0 * srcWidth + x0) * 4 + c]) + src[(y0 * srcWidth + x1) * 4 + c]
+						+ src[(y1 * srcWidth + x0) * 4 + c] + src[(y1 * srcWidth + x1) * 4 + c] };
+					dst[(y * dstWidth + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+
+		srcOffset = dstOffset;
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+	return chain;
 }
 
 // refer to https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Validation_layers for higher levels of configuration.
@@ -8,39 +8,41 @@ VulkanRenderer::~VulkanRenderer() {
 
 int VulkanRenderer::init(GLFWwindow *newWindow) {
 	_window = newWindow;
+
+	// Let glfw tell us when the framebuffer changes size so we can rebuild the swapchain.
+	glfwSetWindowUserPointer(_window, this);
+	glfwSetFramebufferSizeCallback(_window, framebufferResizeCallback);
+
 	try {
 		createInstance();
 		createDebugMessengerExtension();
 		createSurface();
 		getPhysicalDevice();
 		createLogicalDevice();		
+		_scheduler = TimelineScheduler(_mainDevice.logicalDevice, _graphicsQueue, _computeQueue);
 		createSwapChain();
-		createDepthBufferImage();
-		createColorBufferImages();
-		createRenderPass();
 		createDescriptorSetLayout();
 		createPushConstantRange();
+		_frameAllocator = FrameAllocator(_mainDevice.physicalDevice, _mainDevice.logicalDevice, MAX_FRAME_DRAWS, FRAME_ALLOCATOR_SIZE);
+		createTextureSampler();
+		_tiledLighting = TiledLighting(_mainDevice.physicalDevice, _mainDevice.logicalDevice, MAX_FRAME_DRAWS);
+		_tiledLighting.createTileBuffers(_swapchainExtent);
+		createRenderGraph();
 		createGraphicsPipeline();
-		createFramebuffers();
+		_threadPool = std::make_unique<ThreadPool>(max(std::thread::hardware_concurrency(), 1u));
+		_textureStaging = std::make_unique<StagingBuffer>(_mainDevice.physicalDevice, _mainDevice.logicalDevice, TEXTURE_STAGING_SIZE);
 		createCommandPool();
 		createCommandBuffers();
-		createTextureSampler();
-		//allocateDynamicBufferTransferSpace();
 		createUniformBuffers();
 		createDescriptorPool();
 		createDescriptorSets();
-		createInputDescriptorSets();
 		createSync();
 
-		_uboViewProj.proj = glm::perspective(
-			glm::radians(45.0f),
-			(float)_swapchainExtent.width / (float)_swapchainExtent.height,
-			0.1f,
-			100.0f
-		);
+		// Timestamps are written from the graphics queue.
+		_dynamicResolution = DynamicResolution(_mainDevice.physicalDevice, _mainDevice.logicalDevice,
+			getQueueFamilies(_mainDevice.physicalDevice).graphicsFamily, MAX_FRAME_DRAWS);
 
-		// Y coordinate is inverted in Vulkan.
-		_uboViewProj.proj[1][1] *= -1;
+		updateProjection();
 
 		_uboViewProj.view = glm::lookAt(
 			glm::vec3(10.0f, 0.0f, 20.0f), // Where the camera is.
@@ -70,15 +72,15 @@ int VulkanRenderer::init(GLFWwindow *newWindow) {
 			2, 3, 0
 		};
 
-		_meshes.push_back(Mesh(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool,
+		_meshes.push_back(Mesh(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _scheduler, _graphicsCommandPool,
 			&meshVertices00, &meshIndices, createTexture("giraffe.jpg")));
 
-		_meshes.push_back(Mesh(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool,
+		_meshes.push_back(Mesh(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _scheduler, _graphicsCommandPool,
 			&meshVertices01, &meshIndices, createTexture("giraffe.jpg")));
 		*/
 
 		// Create our default "no texture" texture.
-		createTexture("plain.png");
+		_defaultTexture = createTexture("plain.png");
 
 	}
 	catch (const std::runtime_error &e) {
@@ -89,49 +91,86 @@ int VulkanRenderer::init(GLFWwindow *newWindow) {
 	return 0;
 }
 
-void VulkanRenderer::updateModel(const size_t &modelId, const glm::mat4 &newModel) {
-	if (modelId >= _models.size()) {
-		printf("Why are you trying to print an index out of range?");
-		return;
-	}
-
-	_models[modelId].setModel(newModel);
+void VulkanRenderer::updateModel(const ModelHandle &model, const glm::mat4 &newModel) {
+	// Throws on a stale handle.
+	_models.at(model).model = newModel;
 }
 
 void VulkanRenderer::draw() {
 	// Get next available image to draw to and set something to signal when we're finished with the image, a semaphore?
-	// Wait for given fence to signal open from last draw before continuing.
-	vkWaitForFences(_mainDevice.logicalDevice, 1, &_drawFences[_currentFrame], VK_TRUE, numeric_limits<uint64_t>::max());
-	// Manually reset (close) fences.
-	vkResetFences(_mainDevice.logicalDevice, 1, &_drawFences[_currentFrame]);
+	// Wait for this frame's last submit before reusing anything of it.
+	_scheduler.wait(_framePoints[_currentFrame]);
+
+	// Destroy whatever was released and is no longer used by anything in flight.
+	_deletionQueue.collect(_scheduler);
+
+	// Uploads that landed free their staging, models waiting on them can be drawn.
+	if (_uploadScheduler.collect(_scheduler) && _drawListWaiting) {
+		rebuildDrawList();
+		invalidateCommands();
+	}
+
+	// Models the workers finished importing are created, ones now drawable are done.
+	updateModelLoads();
+
+	// Texture levels that finished loading go in before anything is recorded, more are asked for.
+	updateTextureStreaming();
+
+	// This frame's last GPU timings are ready now, pick the resolution to render at.
+	if (_dynamicResolutionEnabled) {
+		_dynamicResolution.update(_currentFrame);
+	}
+	_renderGraph.updateTimings(_currentFrame);
 	
 	// Get index of next image to draw to.
 	uint32_t imageIndex;
-	if (vkAcquireNextImageKHR(_mainDevice.logicalDevice, _swapchain, numeric_limits<uint64_t>::max(), _imageAvailable[_currentFrame], VK_NULL_HANDLE, &imageIndex) != VK_SUCCESS) {
+	VkResult result{ vkAcquireNextImageKHR(_mainDevice.logicalDevice, _swapchain, numeric_limits<uint64_t>::max(), _imageAvailable[_currentFrame], VK_NULL_HANDLE, &imageIndex) };
+	// Swapchain no longer matches the surface, rebuild it and try again next frame.
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		recreateSwapChain();
+		return;
+	}
+	// Suboptimal still acquired an image, so draw this frame and rebuild after present.
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 		throw std::runtime_error("Failed to submit to acquire next image.");
 	}
 
-	recordCommands(imageIndex);
-	updateUniformBuffers(imageIndex);
+	// GPU is done with everything this frame uploaded last time round.
+	_frameAllocator.reset(_currentFrame);
+	uploadTransforms();
 
-	// Submit command buffer to queeu for exec, making sure it waits for the image to be signaled as available before drawing
-	// and signals when it has finished rendering.
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &_imageAvailable[_currentFrame]; // Executes up to where we try to write to the image.
-	VkPipelineStageFlags waitStages []{
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-	};
-	submitInfo.pWaitDstStageMask = waitStages; // Stages to check semaphore at.
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &_commandBuffers[imageIndex]; // Command buffer to submit.
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &_renderFinished[_currentFrame]; // Semaphore to signal when the command buffer is finished.
+	// Only re-recorded when the scene's structure or something baked into the commands has changed.
+	if (!isRecorded(_currentFrame * static_cast<uint32_t>(_swapchainImages.size()) + imageIndex)) {
+		recordCommands(imageIndex);
+	}
+	updateUniformBuffers(_currentFrame);
+	_tiledLighting.update(_currentFrame, _uboViewProj.view);
+
+	// Nothing this frame draws uses them, so it doesn't wait on them.
+	submitUploads();
+
+	// Submit each graph segment to its queue for exec. The first waits for the image to be signaled as available before drawing,
+	// each after waits on the point of the one before, and the last signals when it has finished rendering.
+	const uint32_t slot{ _currentFrame * static_cast<uint32_t>(_swapchainImages.size()) + imageIndex };
+	const uint32_t segmentCount{ _renderGraph.getSegmentCount() };
+	TimelineScheduler::Point segmentPoint{};
+	for (uint32_t segment{ 0 }; segment < segmentCount; segment++) {
+		const bool async{ _renderGraph.isAsyncSegment(segment) };
+		const bool lastSegment{ segment + 1 == segmentCount };
 
-	if (vkQueueSubmit(_graphicsQueue, 1, &submitInfo, _drawFences[_currentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to submit to graphics queue.");
+		// Executes up to where we try to write to the image, or where anything could use the previous segment's output.
+		vector<TimelineScheduler::Wait> waits;
+		if (segment > 0) {
+			waits.push_back({ segmentPoint, async ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT });
+		}
+
+		segmentPoint = _scheduler.submit(async ? TimelineScheduler::Queue::Compute : TimelineScheduler::Queue::Graphics,
+			_commandBuffers[segment * _commandSlotCount + slot], waits,
+			segment == 0 ? _imageAvailable[_currentFrame] : VK_NULL_HANDLE, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			lastSegment ? _renderFinished[_currentFrame] : VK_NULL_HANDLE);
 	}
+	// Last segment waited on every one before it, so its point covers the whole frame.
+	_framePoints[_currentFrame] = segmentPoint;
 
 	// Present image to screen when it has signaled finished rendering.
 	VkPresentInfoKHR presentInfo{};
@@ -141,7 +180,12 @@ void VulkanRenderer::draw() {
 	presentInfo.swapchainCount = 1; 
 	presentInfo.pSwapchains = &_swapchain; // Swapchains to present to.
 	presentInfo.pImageIndices = &imageIndex; // Indices of images in swapchains to present.
-	if (vkQueuePresentKHR(_presentationQueue, &presentInfo) != VK_SUCCESS) {
+	result = vkQueuePresentKHR(_presentationQueue, &presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || _framebufferResized) {
+		_framebufferResized = false;
+		recreateSwapChain();
+	}
+	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to present image to presentation queue.");
 	}
 
@@ -152,37 +196,33 @@ void VulkanRenderer::draw() {
 void VulkanRenderer::destroy() {
 	// wait for device to be finished.
 	vkDeviceWaitIdle(_mainDevice.logicalDevice);
+	_deletionQueue.flush();
+	_uploadScheduler.flush();
+	for (const auto &swap : _pendingSwaps) {
+		vkDestroyImageView(_mainDevice.logicalDevice, swap.newTexture.view, nullptr);
+		vkDestroyImage(_mainDevice.logicalDevice, swap.newTexture.image, nullptr);
+		vkFreeMemory(_mainDevice.logicalDevice, swap.newTexture.memory, nullptr);
+	}
+	_scheduler.destroy();
 
-	//_aligned_free(_modelTransferSpace);
-
-	for (size_t i{ 0 }; i < _models.size(); i++) {
-		_models[i].destroyMeshModel();
+	for (auto &asset : _modelCache.getAssets()) {
+		asset.meshModel.destroyMeshModel();
 	}
 
-	vkDestroyDescriptorPool(_mainDevice.logicalDevice, _inputDescPool, nullptr);
-	vkDestroyDescriptorSetLayout(_mainDevice.logicalDevice, _inputSetLayout, nullptr);
+	_dynamicResolution.destroyQueryPool();
+	_tiledLighting.destroy();
+
+	vkDestroySampler(_mainDevice.logicalDevice, _upscaleSampler, nullptr);
 
 	vkDestroyDescriptorPool(_mainDevice.logicalDevice, _samplerDescPool, nullptr);
 	vkDestroyDescriptorSetLayout(_mainDevice.logicalDevice, _samplerSetLayout, nullptr);
 
 	vkDestroySampler(_mainDevice.logicalDevice, _textureSampler, nullptr);
 
-	for (size_t i{ 0 }; i < _textureImages.size(); i++) {
-		vkDestroyImageView(_mainDevice.logicalDevice, _textureImageViews[i], nullptr);
-		vkDestroyImage(_mainDevice.logicalDevice, _textureImages[i], nullptr);
-		vkFreeMemory(_mainDevice.logicalDevice, _textureImageMems[i], nullptr);
-	}
-
-	for (size_t i{ 0 }; i < _depthBufImages.size(); i++) {
-		vkDestroyImageView(_mainDevice.logicalDevice, _depthBufImageViews[i], nullptr);
-		vkDestroyImage(_mainDevice.logicalDevice, _depthBufImages[i], nullptr);
-		vkFreeMemory(_mainDevice.logicalDevice, _depthBufImageMems[i], nullptr);
-	}
-
-	for (size_t i{ 0 }; i < _colorBufImages.size(); i++) {
-		vkDestroyImageView(_mainDevice.logicalDevice, _colorBufImageViews[i], nullptr);
-		vkDestroyImage(_mainDevice.logicalDevice, _colorBufImages[i], nullptr);
-		vkFreeMemory(_mainDevice.logicalDevice, _colorBufImageMems[i], nullptr);
+	for (const auto &asset : _textureCache.getAssets()) {
+		vkDestroyImageView(_mainDevice.logicalDevice, asset.texture.view, nullptr);
+		vkDestroyImage(_mainDevice.logicalDevice, asset.texture.image, nullptr);
+		vkFreeMemory(_mainDevice.logicalDevice, asset.texture.memory, nullptr);
 	}
 
 	/*
@@ -194,33 +234,47 @@ void VulkanRenderer::destroy() {
 	for (size_t i{ 0 }; i < MAX_FRAME_DRAWS; i++) {
 		vkDestroySemaphore(_mainDevice.logicalDevice, _renderFinished[i], nullptr);
 		vkDestroySemaphore(_mainDevice.logicalDevice, _imageAvailable[i], nullptr);
-		vkDestroyFence(_mainDevice.logicalDevice, _drawFences[i], nullptr);
 	}
+	freeCommandBuffers();
+	// Model loads still going stop at their next job, the pool runs what's queued before it stops. Jobs not
+	// started yet never will be.
+	for (const auto &state : _modelLoads) {
+		state->cancelRequested = true;
+	}
+	_threadPool.reset();
+	_queuedLoadJobs.clear();
+	for (const auto &state : _modelLoads) {
+		freeModelImport(state->modelImport);
+	}
+	// Loads that finished after the last frame still hold staging or heap memory.
+	for (const auto &loaded : _textureStreamer.takeLoaded()) {
+		if (loaded.image.pixels) {
+			freeTexturePixels(loaded.image.pixels);
+		}
+	}
+	_textureStaging->destroy();
+	_textureStaging.reset();
 	vkDestroyCommandPool(_mainDevice.logicalDevice, _graphicsCommandPool, nullptr);
-	for (const auto &framebuffer : _swapchainFramebuffers) {
-		vkDestroyFramebuffer(_mainDevice.logicalDevice, framebuffer, nullptr);
+	if (_computeCommandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(_mainDevice.logicalDevice, _computeCommandPool, nullptr);
 	}
 
+	if (_vpUpdateTemplate != VK_NULL_HANDLE) {
+		vkDestroyDescriptorUpdateTemplate(_mainDevice.logicalDevice, _vpUpdateTemplate, nullptr);
+	}
 	vkDestroyDescriptorSetLayout(_mainDevice.logicalDevice, _descSetLayout, nullptr);
 	vkDestroyDescriptorPool(_mainDevice.logicalDevice, _descPool, nullptr);	
 
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
+	for (size_t i{ 0 }; i < _vpUniformBuffers.size(); i++) {
+		vkUnmapMemory(_mainDevice.logicalDevice, _vpUniformBufMems[i]);
 		vkDestroyBuffer(_mainDevice.logicalDevice, _vpUniformBuffers[i], nullptr);
 		vkFreeMemory(_mainDevice.logicalDevice, _vpUniformBufMems[i], nullptr);
-
-		//vkDestroyBuffer(_mainDevice.logicalDevice, _modelDynUniformBuffers[i], nullptr);
-		//vkFreeMemory(_mainDevice.logicalDevice, _modelDynUniformBufMems[i], nullptr);
 	}
+	_frameAllocator.destroy();
 
-	vkDestroyPipeline(_mainDevice.logicalDevice, _secondPipeline, nullptr);
-	vkDestroyPipelineLayout(_mainDevice.logicalDevice, _secondPipelineLayout, nullptr);
-
-	vkDestroyPipeline(_mainDevice.logicalDevice, _graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(_mainDevice.logicalDevice, _pipelineLayout, nullptr);
-	vkDestroyRenderPass(_mainDevice.logicalDevice, _renderPass, nullptr);
-	for (auto &image : _swapchainImages) {
-		vkDestroyImageView(_mainDevice.logicalDevice, image.imageView, nullptr);
-	}
+	destroyGraphicsPipeline();
+	cleanupSwapChain();
+	_renderGraph.destroy();
 	vkDestroySwapchainKHR(_mainDevice.logicalDevice, _swapchain, nullptr);
 	vkDestroySurfaceKHR(_instance, _surface, nullptr);
 	vkDestroyDevice(_mainDevice.logicalDevice, nullptr);
@@ -294,14 +348,18 @@ void VulkanRenderer::createLogicalDevice() {
 	// Vector for queue creation information. Set for family indices.
 	vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	set<int> queueFamilyIndices{ indices.graphicsFamily, indices.presentationFamily };
+	if (indices.computeFamily >= 0) {
+		queueFamilyIndices.insert(indices.computeFamily);
+	}
 
 	// Queues the logical device needs to create and info to do so.
+	// Priority has to outlive the loop, vkCreateDevice reads it through the pointer.
+	const float priority{ 1.0f };
 	for (int queueFamilyIndex : queueFamilyIndices) {
 		VkDeviceQueueCreateInfo queueCreateInfo{};
 		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 		queueCreateInfo.queueFamilyIndex = queueFamilyIndex; // index of the family to create a queue from.
 		queueCreateInfo.queueCount = 1; // Number of queues to create.
-		float priority{ 1.0f };
 		queueCreateInfo.pQueuePriorities = &priority; // Vulkan needs priority to handle priority for multiple queues.
 		// add to vec
 		queueCreateInfos.push_back(queueCreateInfo);
@@ -311,25 +369,69 @@ void VulkanRenderer::createLogicalDevice() {
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size()); // number of queue create infos.
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data(); // List of queue create info so the device can create required queues.
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(DEVICE_EXTENSIONS.size()); // number of enabled logical device extensions.
-	deviceCreateInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data(); // List of enabled logical device extensions.
+	// Required extensions, plus push descriptors if the device has them.
+	vector<const char *> deviceExtensions{ DEVICE_EXTENSIONS };
+	if (_pushDescriptors) {
+		deviceExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+	}
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()); // number of enabled logical device extensions.
+	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data(); // List of enabled logical device extensions.
 
 	// Physical device features the logical device will be using.
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE; // Texture array indexed by push constant.
+	// Optional, textures are decoded to RGBA instead of loading their KTX2 versions without it.
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(_mainDevice.physicalDevice, &supportedFeatures);
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 	// deviceFeatures.depthClamp = VK_TRUE; // If we want to enable depth clamping later.
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
+	// Descriptor indexing, for the bindless texture array. Written to while bound, only filled up to the texture count.
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.timelineSemaphore = VK_TRUE; // Every submit signals a point on its queue's timeline.
+	deviceCreateInfo.pNext = &vulkan12Features;
+
 	// Create the logical device for the given physical device.
 	VkResult result{ vkCreateDevice(_mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &_mainDevice.logicalDevice) };
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create a vk device.");
 	}
 
+	// Extension command, has to be looked up. Without it the view projection falls back to descriptor sets.
+	if (_pushDescriptors) {
+		_cmdPushDescriptorSet = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+			vkGetDeviceProcAddr(_mainDevice.logicalDevice, "vkCmdPushDescriptorSetKHR"));
+		_pushDescriptors = _cmdPushDescriptorSet != nullptr;
+	}
+
 	// Queues are created at the same time as the device. Get handle to queues.
 	// From given logical device, of given queue family, of given queue index (0 since only one queue), place reference in given VkQueue.
 	vkGetDeviceQueue(_mainDevice.logicalDevice, indices.graphicsFamily, 0, &_graphicsQueue);
 	vkGetDeviceQueue(_mainDevice.logicalDevice, indices.presentationFamily, 0, &_presentationQueue);
+	if (indices.computeFamily >= 0) {
+		vkGetDeviceQueue(_mainDevice.logicalDevice, indices.computeFamily, 0, &_computeQueue);
+	}
+
+	// Block compressed formats KTX2 textures can use here.
+	if (deviceFeatures.textureCompressionBC) {
+		const VkFormatFeatureFlags required{ VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT
+			| VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT };
+		for (VkFormat format : { VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC4_UNORM_BLOCK,
+			VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC7_UNORM_BLOCK }) {
+			VkFormatProperties props{};
+			vkGetPhysicalDeviceFormatProperties(_mainDevice.physicalDevice, format, &props);
+			if ((props.optimalTilingFeatures & required) == required) {
+				_compressedFormats.insert(format);
+			}
+		}
+	}
 }
 
 void VulkanRenderer::createSurface() {
@@ -390,19 +492,27 @@ void VulkanRenderer::createSwapChain() {
 	}
 
 	swapChainCreateInfo.surface = _surface; // swapchain surface.
-	swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE; //pass values from old swapchain. If old one is destroyed can pass responsibilities.
+	swapChainCreateInfo.oldSwapchain = _swapchain; //pass values from old swapchain. If old one is destroyed can pass responsibilities.
 
 	// Create SWAP CHAIN!	
-	VkResult result{ vkCreateSwapchainKHR(_mainDevice.logicalDevice, &swapChainCreateInfo, nullptr, &_swapchain) };
+	VkSwapchainKHR newSwapchain;
+	VkResult result{ vkCreateSwapchainKHR(_mainDevice.logicalDevice, &swapChainCreateInfo, nullptr, &newSwapchain) };
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create a swapchain.");
 	}
 
+	// Old swapchain has handed over its resources, so it can go now.
+	if (_swapchain != VK_NULL_HANDLE) {
+		vkDestroySwapchainKHR(_mainDevice.logicalDevice, _swapchain, nullptr);
+	}
+	_swapchain = newSwapchain;
+
 	// Store swapchain image format and extent.
 	_swapchainImageFormat = surfaceFormat.format;
 	_swapchainExtent = extent;
 
 	// Get swapchain images. 
+	_swapchainImages.clear();
 	uint32_t swapchainImageCount;
 	vkGetSwapchainImagesKHR(_mainDevice.logicalDevice, _swapchain, &swapchainImageCount, nullptr);
 	vector<VkImage> images(swapchainImageCount);
@@ -412,11 +522,67 @@ void VulkanRenderer::createSwapChain() {
 		SwapchainImage swapchainImage{};
 		swapchainImage.image = image;
 		// Create image view.
-		swapchainImage.imageView = createImageView(image, _swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+		swapchainImage.imageView = createImageView(image, _swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 		_swapchainImages.push_back(swapchainImage);
 	}
 }
 
+void VulkanRenderer::recreateSwapChain() {
+	// A minimized window has a 0 sized framebuffer, nothing to present to until it's restored.
+	int width{ 0 }, height{ 0 };
+	glfwGetFramebufferSize(_window, &width, &height);
+	while (width == 0 || height == 0) {
+		glfwWaitEvents();
+		glfwGetFramebufferSize(_window, &width, &height);
+	}
+
+	// Nothing can still be using the size dependent resources. Presents aren't on a timeline, so the whole device.
+	vkDeviceWaitIdle(_mainDevice.logicalDevice);
+
+	const VkFormat oldFormat{ _swapchainImageFormat };
+
+	// Only the size dependent resources are rebuilt. Pipelines use dynamic viewport/scissor, so they stay.
+	cleanupSwapChain();
+	createSwapChain();
+
+	// Tile lists cover the swapchain extent.
+	_tiledLighting.destroyTileBuffers();
+	_tiledLighting.createTileBuffers(_swapchainExtent);
+
+	// Graph render passes (and so the pipelines built against them) only depend on formats.
+	// Surface format changing on resize is very rare, but must rebuild if it does.
+	if (_swapchainImageFormat != oldFormat) {
+		rebuildRenderGraph();
+	}
+	else {
+		_renderGraph.createResources(_swapchainExtent, _swapchainImages);
+
+		// Recorded against the old framebuffers, and there's a set per swapchain image.
+		freeCommandBuffers();
+		createCommandBuffers();
+	}
+
+	// Uniform buffers and descriptor sets are per frame in flight, so the image count doesn't matter for them.
+
+	// Aspect ratio may have changed.
+	updateProjection();
+}
+
+void VulkanRenderer::cleanupSwapChain() {
+	_renderGraph.destroyResources();
+
+	// Swapchain itself is kept, it's handed to the next one as oldSwapchain.
+	for (auto &image : _swapchainImages) {
+		vkDestroyImageView(_mainDevice.logicalDevice, image.imageView, nullptr);
+	}
+}
+
+void VulkanRenderer::framebufferResizeCallback(GLFWwindow *window, int width, int height) {
+	// Just flag it, draw() rebuilds once the frame has been presented.
+	auto renderer{ reinterpret_cast<VulkanRenderer *>(glfwGetWindowUserPointer(window)) };
+	renderer->_framebufferResized = true;
+}
+
 void VulkanRenderer::createGraphicsPipeline() {
 	// Read in SPIR-V shader code.
 	auto vertexShader = readFile("Shaders/vert.spv");
@@ -452,7 +618,7 @@ void VulkanRenderer::createGraphicsPipeline() {
 	// VK_VERTEX_INPUT_RATE_INSTANCE : Move to a vertex for the next instance.
 
 	// How the data for an attribute is defined within a vertex.
-	array<VkVertexInputAttributeDescription, 3> attrDescs;
+	array<VkVertexInputAttributeDescription, 4> attrDescs;
 
 	// Position attribute.
 	attrDescs[0].binding = 0; // Which binding the data is at. (Should be the same as above.)
@@ -472,6 +638,12 @@ void VulkanRenderer::createGraphicsPipeline() {
 	attrDescs[2].format = VK_FORMAT_R32G32_SFLOAT;
 	attrDescs[2].offset = offsetof(Vertex, tex);
 
+	// Normal attribute.
+	attrDescs[3].binding = 0;
+	attrDescs[3].location = 3;
+	attrDescs[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attrDescs[3].offset = offsetof(Vertex, norm);
+
 	// - VERTEX INPUT - put in vertex descriptions when resources created.
 	VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo{};
 	vertexInputStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -487,37 +659,26 @@ void VulkanRenderer::createGraphicsPipeline() {
 	pipelineInputStateCreateInfo.primitiveRestartEnable = VK_FALSE; // Allow overriding of "strip" topology to start new primitives.
 	
 	// - VIEWPORT & SCISSOR - 
-	VkViewport viewport{};
-	viewport.x = 0.0f; // X start coord.
-	viewport.y = 0.0f; // Y start coord.
-	viewport.width = (float)_swapchainExtent.width; // Width of viewport.
-	viewport.height = (float)_swapchainExtent.height; // Height of viewport.
-	viewport.minDepth = 0.0f; // Min framebuffer depth.
-	viewport.maxDepth = 1.0f; // Max framebuffer depth.
-
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 }; // Offset to use region from.
-	scissor.extent = _swapchainExtent; // Extent to describe region to use, starting at offset.
-
+	// Actual viewport and scissor are set when recording, see DYNAMIC STATES.
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
 	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
+	viewportStateCreateInfo.pViewports = nullptr; // Ignored, viewport is dynamic.
 	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
+	viewportStateCreateInfo.pScissors = nullptr; // Ignored, scissor is dynamic.
 
-	/* - DYNAMIC STATES - 
-	// Dynamic states to enable
-	vector<VkDynamicState> dynamicStateEnables(2);
-	// Need to consider resizing swapchain and depth buffer.
-	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT); // Dynamic viewport : can resize in command buffer. vkCmdSetViewport(cmdBuf, 0, 1, &vp);
-	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR); // Dynamic scissor : can resize in command buffer. vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+	// - DYNAMIC STATES - 
+	// Dynamic states to enable. Lets pipelines survive a swapchain resize.
+	array<VkDynamicState, 2> dynamicStateEnables{
+		VK_DYNAMIC_STATE_VIEWPORT, // Dynamic viewport : can resize in command buffer. vkCmdSetViewport(cmdBuf, 0, 1, &vp);
+		VK_DYNAMIC_STATE_SCISSOR, // Dynamic scissor : can resize in command buffer. vkCmdSetScissor(cmdBuf, 0, 1, &scissor);
+	};
 
 	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
 	dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
 	dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t> (dynamicStateEnables.size());
 	dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
-	*/
+
 	// - RASTERIZER
 	VkPipelineRasterizationStateCreateInfo rasterStateCreateInfo{};
 	rasterStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -555,14 +716,21 @@ void VulkanRenderer::createGraphicsPipeline() {
 	colorBlendState.alphaBlendOp = VK_BLEND_OP_ADD;
 	// Summarized: (1 * newAlpha) + (0 * oldAlpha) = newAlpha
 
+	// G-buffer normals are data, written as is.
+	VkPipelineColorBlendAttachmentState normalBlendState{};
+	normalBlendState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT;
+	normalBlendState.blendEnable = VK_FALSE;
+
+	array<VkPipelineColorBlendAttachmentState, 2> gbufferBlendStates{ colorBlendState, normalBlendState };
+
 	VkPipelineColorBlendStateCreateInfo colorBlendStateInfo{};
 	colorBlendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlendStateInfo.logicOpEnable = VK_FALSE; // Alternative to calculations is to use logical operations.
-	colorBlendStateInfo.attachmentCount = 1;
-	colorBlendStateInfo.pAttachments = &colorBlendState;
+	colorBlendStateInfo.attachmentCount = static_cast<uint32_t>(gbufferBlendStates.size()); // Albedo and normal.
+	colorBlendStateInfo.pAttachments = gbufferBlendStates.data();
 	
 	// - PIPELINE LAYOUT
-	array<VkDescriptorSetLayout, 2> descSetLayouts{ _descSetLayout, _samplerSetLayout };
+	array<VkDescriptorSetLayout, 3> descSetLayouts{ _descSetLayout, _samplerSetLayout, _frameAllocator.getDescriptorSetLayout() };
 
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -593,14 +761,14 @@ void VulkanRenderer::createGraphicsPipeline() {
 	pipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo; // All the fixed fucntion pipeline states.
 	pipelineCreateInfo.pInputAssemblyState = &pipelineInputStateCreateInfo;
 	pipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	pipelineCreateInfo.pDynamicState = nullptr; // &dynamicStateCreateInfo;
+	pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
 	pipelineCreateInfo.pRasterizationState = &rasterStateCreateInfo;
 	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
 	pipelineCreateInfo.pColorBlendState = &colorBlendStateInfo;
 	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo; // TODO
 	pipelineCreateInfo.layout = _pipelineLayout;
-	pipelineCreateInfo.renderPass = _renderPass; // Render pass description the pipeline is compatible with.
-	pipelineCreateInfo.subpass = 0; // Subpass of render pass to use with pipeline.
+	pipelineCreateInfo.renderPass = _renderGraph.getRenderPass(_scenePass); // Render pass description the pipeline is compatible with.
+	pipelineCreateInfo.subpass = _renderGraph.getSubpass(_scenePass); // Subpass of render pass to use with pipeline.
 	// Pipeline derivatives : can create multiple pipelines that derive from one another for optimization.
 	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE; // Existing pipeline to derive from. OR
 	pipelineCreateInfo.basePipelineIndex = -1; // or index pipeline being create to derive from.
@@ -614,20 +782,10 @@ void VulkanRenderer::createGraphicsPipeline() {
 	vkDestroyShaderModule(_mainDevice.logicalDevice, fragShaderModule, nullptr);
 	vkDestroyShaderModule(_mainDevice.logicalDevice, vertexShaderModule, nullptr);
 
-	// Create second pass pipeline
-	// Second pass shaders
+	// Post effect and upscale pipelines. Full screen triangle, so they share the second pass vertex shader.
 	auto secondVertexShaderCode{ readFile("Shaders/second_vert.spv") };
-	auto secondFragmentShaderCode{ readFile("Shaders/second_frag.spv") };
-
-	// Build shaders
 	VkShaderModule secondVertexShaderModule{ createShaderModule(secondVertexShaderCode) };
-	VkShaderModule secondFragmentShaderModule{ createShaderModule(secondFragmentShaderCode) };
-
-	// Set new shaders
 	vertexShaderStageCreateInfo.module = secondVertexShaderModule;
-	fragmentShaderStageCreateInfo.module = secondFragmentShaderModule;
-
-	VkPipelineShaderStageCreateInfo secondShaderStages [] { vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
 
 	// No vertex data for second pass
 	vertexInputStateCreateInfo.vertexBindingDescriptionCount = 0;
@@ -638,125 +796,340 @@ void VulkanRenderer::createGraphicsPipeline() {
 	// Don't write to depth buffer.
 	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
 
-	// Create new pipeline layout.
-	VkPipelineLayoutCreateInfo secondPipelineLayoutCreateInfo{};
-	secondPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	secondPipelineLayoutCreateInfo.setLayoutCount = 1;
-	secondPipelineLayoutCreateInfo.pSetLayouts = &_inputSetLayout;
-	secondPipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	secondPipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+	// Everything after the G-buffer writes a single color.
+	colorBlendStateInfo.attachmentCount = 1;
+	colorBlendStateInfo.pAttachments = &colorBlendState;
+
+	// Lighting pipeline. Reads the G-buffer through the graph's set, lights and tile lists through the lighting set.
+	auto lightingFragmentShaderCode{ readFile("Shaders/deferred_frag.spv") };
+	VkShaderModule lightingFragmentShaderModule{ createShaderModule(lightingFragmentShaderCode) };
+	fragmentShaderStageCreateInfo.module = lightingFragmentShaderModule;
+	VkPipelineShaderStageCreateInfo lightingShaderStages []{ vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
+
+	array<VkDescriptorSetLayout, 2> lightingSetLayouts{ _renderGraph.getDescriptorSetLayout(_lightingPass), _tiledLighting.getDescriptorSetLayout() };
+	VkPipelineLayoutCreateInfo lightingPipelineLayoutCreateInfo{};
+	lightingPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	lightingPipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(lightingSetLayouts.size());
+	lightingPipelineLayoutCreateInfo.pSetLayouts = lightingSetLayouts.data();
+	VkPushConstantRange lightingPushConstRange{};
+	lightingPushConstRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	lightingPushConstRange.offset = 0;
+	lightingPushConstRange.size = sizeof(PushLighting);
+	lightingPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	lightingPipelineLayoutCreateInfo.pPushConstantRanges = &lightingPushConstRange;
+
+	if (vkCreatePipelineLayout(_mainDevice.logicalDevice, &lightingPipelineLayoutCreateInfo, nullptr, &_lightingPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the lighting pipeline layout.");
+	}
+
+	pipelineCreateInfo.pStages = lightingShaderStages;
+	pipelineCreateInfo.layout = _lightingPipelineLayout;
+	pipelineCreateInfo.renderPass = _renderGraph.getRenderPass(_lightingPass);
+	pipelineCreateInfo.subpass = _renderGraph.getSubpass(_lightingPass);
+
+	if (vkCreateGraphicsPipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_lightingPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the lighting graphics pipeline.");
+	}
+
+	vkDestroyShaderModule(_mainDevice.logicalDevice, lightingFragmentShaderModule, nullptr);
+
+	// Light culling pipeline, only needs the lighting set.
+	auto lightCullShaderCode{ readFile("Shaders/light_cull_comp.spv") };
+	VkShaderModule lightCullShaderModule{ createShaderModule(lightCullShaderCode) };
+
+	VkDescriptorSetLayout lightCullSetLayout{ _tiledLighting.getDescriptorSetLayout() };
+	VkPipelineLayoutCreateInfo lightCullPipelineLayoutCreateInfo{};
+	lightCullPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	lightCullPipelineLayoutCreateInfo.setLayoutCount = 1;
+	lightCullPipelineLayoutCreateInfo.pSetLayouts = &lightCullSetLayout;
+	VkPushConstantRange lightCullPushConstRange{};
+	lightCullPushConstRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	lightCullPushConstRange.offset = 0;
+	lightCullPushConstRange.size = sizeof(PushLighting);
+	lightCullPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	lightCullPipelineLayoutCreateInfo.pPushConstantRanges = &lightCullPushConstRange;
+
+	if (vkCreatePipelineLayout(_mainDevice.logicalDevice, &lightCullPipelineLayoutCreateInfo, nullptr, &_lightCullPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the light cull pipeline layout.");
+	}
+
+	VkComputePipelineCreateInfo lightCullPipelineCreateInfo{};
+	lightCullPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	lightCullPipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	lightCullPipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	lightCullPipelineCreateInfo.stage.module = lightCullShaderModule;
+	lightCullPipelineCreateInfo.stage.pName = "main";
+	lightCullPipelineCreateInfo.layout = _lightCullPipelineLayout;
+	lightCullPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	lightCullPipelineCreateInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &lightCullPipelineCreateInfo, nullptr, &_lightCullPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the light cull compute pipeline.");
+	}
+
+	vkDestroyShaderModule(_mainDevice.logicalDevice, lightCullShaderModule, nullptr);
+
+	_postPipelines.assign(_postEffects.size(), VK_NULL_HANDLE);
+	_postPipelineLayouts.assign(_postEffects.size(), VK_NULL_HANDLE);
+	for (size_t i{ 0 }; i < _postEffects.size(); i++) {
+		const bool compute{ _postEffects[i].mode != PostEffectMode::Fragment };
+
+		// Render graph made the set layout from the pass's reads (and storage write for compute).
+		VkDescriptorSetLayout postSetLayout{ _renderGraph.getDescriptorSetLayout(_postPasses[i]) };
+		VkPipelineLayoutCreateInfo postPipelineLayoutCreateInfo{};
+		postPipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		postPipelineLayoutCreateInfo.setLayoutCount = 1;
+		postPipelineLayoutCreateInfo.pSetLayouts = &postSetLayout;
+		// Effect gets the extent it covers, so it follows resizes and dynamic resolution.
+		VkPushConstantRange postPushConstRange{};
+		postPushConstRange.stageFlags = compute ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+		postPushConstRange.offset = 0;
+		postPushConstRange.size = sizeof(PushPost);
+		postPipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		postPipelineLayoutCreateInfo.pPushConstantRanges = &postPushConstRange;
+
+		if (vkCreatePipelineLayout(_mainDevice.logicalDevice, &postPipelineLayoutCreateInfo, nullptr, &_postPipelineLayouts[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a post effect pipeline layout.");
+		}
 
-	if (vkCreatePipelineLayout(_mainDevice.logicalDevice, &secondPipelineLayoutCreateInfo, nullptr, &_secondPipelineLayout) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create the second pipeline layout.");
-	}
+		auto postShaderCode{ readFile(_postEffects[i].shaderFile) };
+		VkShaderModule postShaderModule{ createShaderModule(postShaderCode) };
+
+		if (compute) {
+			VkComputePipelineCreateInfo computePipelineCreateInfo{};
+			computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+			computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			computePipelineCreateInfo.stage.module = postShaderModule;
+			computePipelineCreateInfo.stage.pName = "main";
+			computePipelineCreateInfo.layout = _postPipelineLayouts[i];
+			computePipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+			computePipelineCreateInfo.basePipelineIndex = -1;
+
+			if (vkCreateComputePipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, nullptr, &_postPipelines[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a post effect compute pipeline.");
+			}
+		}
+		else {
+			fragmentShaderStageCreateInfo.module = postShaderModule;
+			VkPipelineShaderStageCreateInfo postShaderStages []{ vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
+
+			pipelineCreateInfo.pStages = postShaderStages;
+			pipelineCreateInfo.layout = _postPipelineLayouts[i];
+			pipelineCreateInfo.renderPass = _renderGraph.getRenderPass(_postPasses[i]);
+			pipelineCreateInfo.subpass = _renderGraph.getSubpass(_postPasses[i]);
+
+			if (vkCreateGraphicsPipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_postPipelines[i]) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create a post effect graphics pipeline.");
+			}
+		}
+
+		vkDestroyShaderModule(_mainDevice.logicalDevice, postShaderModule, nullptr);
+	}
+
+	if (_finalPass >= 0) {
+		auto upscaleFragmentShaderCode{ readFile("Shaders/upscale_frag.spv") };
+		VkShaderModule upscaleFragmentShaderModule{ createShaderModule(upscaleFragmentShaderCode) };
+		fragmentShaderStageCreateInfo.module = upscaleFragmentShaderModule;
+		VkPipelineShaderStageCreateInfo upscaleShaderStages []{ vertexShaderStageCreateInfo, fragmentShaderStageCreateInfo };
+
+		VkDescriptorSetLayout upscaleSetLayout{ _renderGraph.getDescriptorSetLayout(_finalPass) };
+		VkPipelineLayoutCreateInfo upscalePipelineLayoutCreateInfo{};
+		upscalePipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		upscalePipelineLayoutCreateInfo.setLayoutCount = 1;
+		upscalePipelineLayoutCreateInfo.pSetLayouts = &upscaleSetLayout;
+		// Fragment shader gets the rendered region.
+		VkPushConstantRange upscalePushConstRange{};
+		upscalePushConstRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		upscalePushConstRange.offset = 0;
+		upscalePushConstRange.size = sizeof(PushUpscale);
+		upscalePipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+		upscalePipelineLayoutCreateInfo.pPushConstantRanges = &upscalePushConstRange;
+
+		if (vkCreatePipelineLayout(_mainDevice.logicalDevice, &upscalePipelineLayoutCreateInfo, nullptr, &_upscalePipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create the upscale pipeline layout.");
+		}
 
-	pipelineCreateInfo.pStages = secondShaderStages; // Update second shader stage list.
-	pipelineCreateInfo.layout = _secondPipelineLayout; // Change pipeline layout for input attachment desc sets.
-	pipelineCreateInfo.subpass = 1; // Use second subpass.
+		pipelineCreateInfo.pStages = upscaleShaderStages;
+		pipelineCreateInfo.layout = _upscalePipelineLayout;
+		pipelineCreateInfo.renderPass = _renderGraph.getRenderPass(_finalPass);
+		pipelineCreateInfo.subpass = _renderGraph.getSubpass(_finalPass);
 
-	// Create second pipeline
-	if (vkCreateGraphicsPipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_secondPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create a second graphics pipeline.");
+		if (vkCreateGraphicsPipelines(_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_upscalePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create the upscale graphics pipeline.");
+		}
+
+		vkDestroyShaderModule(_mainDevice.logicalDevice, upscaleFragmentShaderModule, nullptr);
 	}
 
-	// Destroy second shader modules.
-	vkDestroyShaderModule(_mainDevice.logicalDevice, secondFragmentShaderModule, nullptr);
 	vkDestroyShaderModule(_mainDevice.logicalDevice, secondVertexShaderModule, nullptr);
 }
 
-void VulkanRenderer::createColorBufferImages() {
-	_colorBufImages.resize(_swapchainImages.size());
-	_colorBufImageMems.resize(_swapchainImages.size());
-	_colorBufImageViews.resize(_swapchainImages.size());
+void VulkanRenderer::destroyGraphicsPipeline() {
+	for (size_t i{ 0 }; i < _postPipelines.size(); i++) {
+		vkDestroyPipeline(_mainDevice.logicalDevice, _postPipelines[i], nullptr);
+		vkDestroyPipelineLayout(_mainDevice.logicalDevice, _postPipelineLayouts[i], nullptr);
+	}
+	_postPipelines.clear();
+	_postPipelineLayouts.clear();
 
-	// Get supporte format for color attachment.
-	_colorBufFormat = chooseSupportedFormat(
-		{ VK_FORMAT_R8G8B8A8_UNORM },
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-	);
+	if (_upscalePipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(_mainDevice.logicalDevice, _upscalePipeline, nullptr);
+		vkDestroyPipelineLayout(_mainDevice.logicalDevice, _upscalePipelineLayout, nullptr);
+		_upscalePipeline = VK_NULL_HANDLE;
+		_upscalePipelineLayout = VK_NULL_HANDLE;
+	}
 
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
+	vkDestroyPipeline(_mainDevice.logicalDevice, _lightCullPipeline, nullptr);
+	vkDestroyPipelineLayout(_mainDevice.logicalDevice, _lightCullPipelineLayout, nullptr);
+	vkDestroyPipeline(_mainDevice.logicalDevice, _lightingPipeline, nullptr);
+	vkDestroyPipelineLayout(_mainDevice.logicalDevice, _lightingPipelineLayout, nullptr);
 
-		// Create depth buffer image.
-		_colorBufImages[i] = createImage(
-			_swapchainExtent.width,
-			_swapchainExtent.height,
-			_colorBufFormat,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&_colorBufImageMems[i]
-		);
+	vkDestroyPipeline(_mainDevice.logicalDevice, _graphicsPipeline, nullptr);
+	vkDestroyPipelineLayout(_mainDevice.logicalDevice, _pipelineLayout, nullptr);
+}
 
-		_colorBufImageViews[i] = createImageView(
-			_colorBufImages[i],
-			_colorBufFormat,
-			VK_IMAGE_ASPECT_COLOR_BIT
-		);
+void VulkanRenderer::createRenderGraph() {
+	// Compute effects store to the color images.
+	bool computeEffects{ false };
+	for (const auto &effect : _postEffects) {
+		computeEffects = computeEffects || effect.mode != PostEffectMode::Fragment;
 	}
-}
 
-void VulkanRenderer::createDepthBufferImage() {
+	// Get supported formats for the scene attachments.
+	// Upscale pass samples color with linear filtering.
+	_colorBufFormat = chooseSupportedFormat(
+		{ VK_FORMAT_R8G8B8A8_UNORM },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
+		| (computeEffects ? VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT : 0)
+	);
 
-	_depthBufImages.resize(_swapchainImages.size());
-	_depthBufImageMems.resize(_swapchainImages.size());
-	_depthBufImageViews.resize(_swapchainImages.size());
+	// G-buffer normals, octahedral encoded into two signed channels.
+	_normalBufFormat = chooseSupportedFormat(
+		{ VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SFLOAT },
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT
+	);
 
-	// Get supporte format for depth buffer.
+	// Nothing uses stencil, so prefer a depth only format. Combined formats are just the fallback.
 	_depthBufFormat = chooseSupportedFormat(
-		{ VK_FORMAT_D32_SFLOAT_S8_UINT,
-		VK_FORMAT_D32_SFLOAT,
+		{ VK_FORMAT_D32_SFLOAT,
+		VK_FORMAT_D32_SFLOAT_S8_UINT,
 		VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
 	);
 
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
-
-		// Create depth buffer image.
-		_depthBufImages[i] = createImage(
-			_swapchainExtent.width,
-			_swapchainExtent.height,
-			_depthBufFormat,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			&_depthBufImageMems[i]
-		);
-
-		_depthBufImageViews[i] = createImageView(
-			_depthBufImages[i],
-			_depthBufFormat,
-			VK_IMAGE_ASPECT_DEPTH_BIT
-		);
-	}
-}
-
-void VulkanRenderer::createFramebuffers() {
-	// Should equal image count.
-	_swapchainFramebuffers.resize(_swapchainImages.size());
-	for (size_t i{ 0 }; i < _swapchainFramebuffers.size(); i++) {
-		// ORDER MATTERS.
-		array<VkImageView, 3> attachments{
-			_swapchainImages[i].imageView,
-			_colorBufImageViews[i],
-			_depthBufImageViews[i],
-		};
-		VkFramebufferCreateInfo info{};
-		info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		info.renderPass = _renderPass; // Render Pass layout the framebuffer will be used with.
-		info.attachmentCount = static_cast<uint32_t>(attachments.size());
-		info.pAttachments = attachments.data(); // List of attachments 1:1 with render pass.
-		info.width = _swapchainExtent.width;
-		info.height = _swapchainExtent.height;
-		info.layers = 1; // Framebuffer layers.
-
-		VkResult result{ vkCreateFramebuffer(_mainDevice.logicalDevice, &info, nullptr, &_swapchainFramebuffers[i]) };
-		if (result != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create a frame buffer.");
+	_renderGraph = RenderGraph(_mainDevice.physicalDevice, _mainDevice.logicalDevice, MAX_FRAME_DRAWS);
+	const QueueFamilyIndices indices{ getQueueFamilies(_mainDevice.physicalDevice) };
+	_renderGraph.setQueueFamilies(indices.graphicsFamily, indices.computeFamily);
+
+	// Something has to sample the scaled region up to the swapchain, and compute can't write to the swapchain.
+	const bool needsFinal{ _dynamicResolutionEnabled || (!_postEffects.empty() && _postEffects.back().mode != PostEffectMode::Fragment) };
+	// With dynamic resolution the scene and every effect only cover the scaled region.
+	const int renderArea{ _dynamicResolutionEnabled
+		? _renderGraph.addRenderArea([this]() { return _dynamicResolution.getRenderExtent(_swapchainExtent); }) : -1 };
+
+	// RESOURCES
+	// Without anything after it, lighting draws straight to the swapchain.
+	const int swapchainImage{ _renderGraph.importSwapchain("swapchain", _swapchainImageFormat) };
+	const int albedoImage{ _renderGraph.addImage("gbufferAlbedo", _colorBufFormat, false) };
+	const int normalImage{ _renderGraph.addImage("gbufferNormal", _normalBufFormat, false) };
+	const int depthImage{ _renderGraph.addImage("sceneDepth", _depthBufFormat, true) };
+	int colorImage{ _postEffects.empty() && !needsFinal ? swapchainImage : _renderGraph.addImage("sceneColor", _colorBufFormat, false) };
+	const int lightTileBuffer{ _renderGraph.importBuffer("lightTiles") };
+
+	// Background keeps the albedo clear color, lighting passes it through where nothing was drawn.
+	VkClearValue colorClear{};
+	colorClear.color = { 0.6f, 0.65f, 0.4f, 1.0f };
+	VkClearValue normalClear{};
+	VkClearValue depthClear{};
+	depthClear.depthStencil.depth = 1.0f;
+
+	// PASSES
+	// Lights are binned before the G-buffer, so culling doesn't split it from the lighting subpass.
+	_lightCullPass = _renderGraph.addComputePass("lightCull", [this](VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+		recordLightCull(commandBuffer, frame);
+	}, false);
+	_renderGraph.writeBuffer(_lightCullPass, lightTileBuffer);
+
+	_scenePass = _renderGraph.addPass("gbuffer", [this](VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+		recordSceneDraws(commandBuffer, frame, imageIndex);
+	});
+	_renderGraph.setSecondaryContents(_scenePass);
+	_renderGraph.writeColor(_scenePass, albedoImage, true, colorClear);
+	_renderGraph.writeColor(_scenePass, normalImage, true, normalClear);
+	_renderGraph.writeDepth(_scenePass, depthImage, true, depthClear);
+	_renderGraph.setRenderArea(_scenePass, renderArea);
+
+	// Same pixel reads, so the G-buffer stays in tile memory on tiled GPUs.
+	_lightingPass = _renderGraph.addPass("lighting", [this](VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+		recordLighting(commandBuffer, frame);
+	});
+	_renderGraph.readInput(_lightingPass, albedoImage);
+	_renderGraph.readInput(_lightingPass, normalImage);
+	_renderGraph.readInput(_lightingPass, depthImage);
+	_renderGraph.readBuffer(_lightingPass, lightTileBuffer);
+	_renderGraph.writeColor(_lightingPass, colorImage, false);
+	_renderGraph.setRenderArea(_lightingPass, renderArea);
+
+	// Each effect reads the color the one before it wrote.
+	// Fragment effects read the same pixel, so they end up as subpasses of the scene's render pass.
+	_postPasses.clear();
+	for (size_t i{ 0 }; i < _postEffects.size(); i++) {
+		const PostEffect &effect{ _postEffects[i] };
+		const RenderGraph::RecordFunc record{ [this, i](VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+			recordPostEffect(commandBuffer, i, frame);
+		} };
+
+		int postPass{ -1 };
+		int postImage{ -1 };
+		if (effect.mode == PostEffectMode::Fragment) {
+			postPass = _renderGraph.addPass(effect.name, record);
+			_renderGraph.readInput(postPass, colorImage);
+			_renderGraph.readInput(postPass, depthImage);
+			// Full screen triangle writes every pixel, so its output isn't cleared.
+			postImage = i + 1 == _postEffects.size() && !needsFinal ? swapchainImage : _renderGraph.addImage(effect.name, _colorBufFormat, false);
+			_renderGraph.writeColor(postPass, postImage, false);
 		}
+		else {
+			postPass = _renderGraph.addComputePass(effect.name, record, effect.mode == PostEffectMode::AsyncCompute);
+			_renderGraph.readSampled(postPass, colorImage, _upscaleSampler);
+			_renderGraph.readSampled(postPass, depthImage, _upscaleSampler);
+			postImage = _renderGraph.addImage(effect.name, _colorBufFormat, false);
+			_renderGraph.writeStorage(postPass, postImage);
+		}
+		_renderGraph.setRenderArea(postPass, renderArea);
+
+		_postPasses.push_back(postPass);
+		colorImage = postImage;
+	}
+
+	// Upscales the scaled region, or just copies a compute effect's output.
+	_finalPass = -1;
+	if (needsFinal) {
+		_finalPass = _renderGraph.addPass("upscale", [this](VkCommandBuffer commandBuffer, uint32_t frame, uint32_t imageIndex) {
+			recordUpscale(commandBuffer, frame);
+		});
+		_renderGraph.readSampled(_finalPass, colorImage, _upscaleSampler);
+		_renderGraph.writeColor(_finalPass, swapchainImage, false);
 	}
+
+	_renderGraph.compile();
+	_renderGraph.createResources(_swapchainExtent, _swapchainImages);
+}
+
+void VulkanRenderer::rebuildRenderGraph() {
+	// Segment count can change with the passes, so command buffers go too.
+	_scheduler.waitIdle();
+	destroyGraphicsPipeline();
+	freeCommandBuffers();
+	_renderGraph.destroy();
+
+	createRenderGraph();
+	createGraphicsPipeline();
+	createCommandBuffers();
 }
 
 void VulkanRenderer::createCommandPool() {
@@ -772,23 +1145,92 @@ void VulkanRenderer::createCommandPool() {
 	if (result != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create a command pool.");
 	}
+
+	// Upload buffers, freed with the pool.
+	VkCommandBufferAllocateInfo uploadInfo{};
+	uploadInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	uploadInfo.commandPool = _graphicsCommandPool;
+	uploadInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	uploadInfo.commandBufferCount = MAX_FRAME_DRAWS;
+	_uploadCommandBuffers.resize(MAX_FRAME_DRAWS);
+	if (vkAllocateCommandBuffers(_mainDevice.logicalDevice, &uploadInfo, _uploadCommandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate upload command buffers.");
+	}
+
+	// Async compute segments are recorded from their own family's pool.
+	if (indices.computeFamily >= 0) {
+		info.queueFamilyIndex = indices.computeFamily;
+		if (vkCreateCommandPool(_mainDevice.logicalDevice, &info, nullptr, &_computeCommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a compute command pool.");
+		}
+	}
+
 }
 
 void VulkanRenderer::createCommandBuffers() {
-	// 1:1, Resize command buffer
-	_commandBuffers.resize(_swapchainFramebuffers.size());
-
-	VkCommandBufferAllocateInfo info{};
-	info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	info.commandPool = _graphicsCommandPool;
-	info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // PRIMARY Executed by queue, can't be called by other buffers. 
-	// SECONDARY means buffer can't be called directly, called by other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer.
-	info.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
-
-	// Allocate command buffers and place handles in array of buffers.
-	VkResult result{ vkAllocateCommandBuffers(_mainDevice.logicalDevice, &info, _commandBuffers.data()) };
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate command buffers..");
+	// One per frame in flight and swapchain image, for each segment of the graph. Recorded once and submitted again
+	// until something they depend on changes, only ever used by their own frame so its timeline point covers re-recording.
+	const uint32_t segmentCount{ _renderGraph.getSegmentCount() };
+	_commandSlotCount = MAX_FRAME_DRAWS * static_cast<uint32_t>(_swapchainImages.size());
+	_commandBuffers.resize(segmentCount * _commandSlotCount);
+	_recordedCommands.assign(_commandSlotCount, RecordedCommands{});
+
+	for (uint32_t segment{ 0 }; segment < segmentCount; segment++) {
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = _renderGraph.isAsyncSegment(segment) ? _computeCommandPool : _graphicsCommandPool;
+		info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // PRIMARY Executed by queue, can't be called by other buffers. 
+		// SECONDARY means buffer can't be called directly, called by other buffers via "vkCmdExecuteCommands" when recording commands in primary buffer.
+		info.commandBufferCount = _commandSlotCount;
+
+		// Allocate command buffers and place handles in array of buffers.
+		VkResult result{ vkAllocateCommandBuffers(_mainDevice.logicalDevice, &info, &_commandBuffers[segment * _commandSlotCount]) };
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate command buffers..");
+		}
+	}
+
+	// Per worker pools for the secondaries of each slot. Never reset buffer by buffer, so no reset flag.
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = getQueueFamilies(_mainDevice.physicalDevice).graphicsFamily;
+	_secondaryPools.resize(_commandSlotCount * _threadPool->getThreadCount());
+	for (size_t i{ 0 }; i < _secondaryPools.size(); i++) {
+		if (vkCreateCommandPool(_mainDevice.logicalDevice, &poolInfo, nullptr, &_secondaryPools[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create a secondary command pool.");
+		}
+	}
+	_secondaryBuffers.assign(_secondaryPools.size(), vector<VkCommandBuffer>{});
+	_secondaryUsed.assign(_secondaryPools.size(), 0);
+}
+
+void VulkanRenderer::freeCommandBuffers() {
+	const uint32_t segmentCount{ _renderGraph.getSegmentCount() };
+	for (uint32_t segment{ 0 }; segment < segmentCount; segment++) {
+		vkFreeCommandBuffers(_mainDevice.logicalDevice, _renderGraph.isAsyncSegment(segment) ? _computeCommandPool : _graphicsCommandPool,
+			_commandSlotCount, &_commandBuffers[segment * _commandSlotCount]);
+	}
+	_commandBuffers.clear();
+
+	// Frees the secondaries with them.
+	for (auto secondaryPool : _secondaryPools) {
+		vkDestroyCommandPool(_mainDevice.logicalDevice, secondaryPool, nullptr);
+	}
+	_secondaryPools.clear();
+}
+
+bool VulkanRenderer::isRecorded(const uint32_t &slot) {
+	// Everything else they depend on goes through invalidateCommands or rebuilds them.
+	const RecordedCommands &recorded{ _recordedCommands[slot] };
+	const VkExtent2D renderExtent{ getRenderExtent() };
+	return recorded.valid && recorded.transformOffset == _transformOffset
+		&& recorded.renderExtent.width == renderExtent.width && recorded.renderExtent.height == renderExtent.height;
+}
+
+void VulkanRenderer::invalidateCommands() {
+	for (auto &recorded : _recordedCommands) {
+		recorded.valid = false;
 	}
 }
 
@@ -797,234 +1239,267 @@ void VulkanRenderer::recordCommands(const uint32_t &currentImage) {
 	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	// commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // buffer can be resubmitted when it is already submitted and waiting execution.
 
-	// Info about how to begin the render pass. Only needed for graphical applications.
-	VkRenderPassBeginInfo renderPassBeginInfo{};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = _renderPass;
-	renderPassBeginInfo.renderArea.offset = { 0, 0 }; // Start point of render pass in pixels.
-	renderPassBeginInfo.renderArea.extent = _swapchainExtent; // Size of region to run render pass on (starting at offset).
-
-	// Lines up to attachments.
-	array<VkClearValue, 3> clearValues;
-	clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-	clearValues[1].color = { 0.6f, 0.65f, 0.4f, 1.0f }; // att 0 - color
-	clearValues[2].depthStencil.depth = 1.0f; // att 1 - depth.
-
-	renderPassBeginInfo.pClearValues = clearValues.data();
-	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size()); 
-
-	renderPassBeginInfo.framebuffer = _swapchainFramebuffers[currentImage];
-
-	// Start recording commands.
-	if (vkBeginCommandBuffer(_commandBuffers[currentImage], &commandBufferBeginInfo) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to start recording a command buffer.");
-	}		
-
-		// Begin Render Pass.
-		vkCmdBeginRenderPass(_commandBuffers[currentImage], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-			// Bind pipeline to be used in render pass.
-			vkCmdBindPipeline(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
-
-			for (size_t modelIdx{ 0 }; modelIdx < _models.size(); modelIdx++) {
-				MeshModel curModel{ _models[modelIdx] };
-
-				// Push constant given to shader stage directly. (no buffer).
-				vkCmdPushConstants(_commandBuffers[currentImage], 
-					_pipelineLayout,
-					VK_SHADER_STAGE_VERTEX_BIT, // Stage to push constant to.
-					0, // Offset of push constant to update.
-					sizeof(Model), // Size of data being pushed.
-					&curModel.getModel()); // Actual data being pushed (can be array).
-
-				for (size_t meshIdx{ 0 }; meshIdx < curModel.getMeshCount(); meshIdx++) {
-					Mesh *mesh{ curModel.getMesh(meshIdx) };
-					VkBuffer vertexBuffers []{ mesh->getVertexBuffer() }; // Buffers to bind.
-					VkDeviceSize offsets []{ 0 }; // Offsets into buffers being bound.
-					// For firstBinding var, imagine shader has a implicit binding = 0 value.
-					vkCmdBindVertexBuffers(_commandBuffers[currentImage], 0, 1, vertexBuffers, offsets); // Command to bind vertex buffer before drawing with them.
-
-					// Bind mesh index buffer with 0 offset and using uint32_t type.
-					vkCmdBindIndexBuffer(_commandBuffers[currentImage], mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-
-					// Dynamic Offset Amount
-					//uint32_t dynamicOffset{ static_cast<uint32_t>(_modelUniAlignment) * meshIdx };
-
-					array<VkDescriptorSet, 2> descSetGroup{ _descSets[currentImage],
-						_samplerDescSets[mesh->getTexId()] };
-
-					// Bind descriptor sets.
-					vkCmdBindDescriptorSets(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
-						0,
-						static_cast<uint32_t>(descSetGroup.size()),
-						descSetGroup.data(),
-						0,
-						nullptr);
-						//&dynamicOffset);
-
-					// Execute our pipeline.
-					vkCmdDrawIndexed(_commandBuffers[currentImage], mesh->getIndexCount(), 1
-						, 0 // "index" of index to start at.
-						, 0 // "offset" of vertex to start at.
-						, 0); // which instance of mesh is first. to draw		
-					// gl_InstanceIndex can be used in the shader for the instance count.
-				}
-			}
+	// The slot is only used by this frame and its point has been reached, so the secondaries recorded for it are done with.
+	const uint32_t slot{ _currentFrame * static_cast<uint32_t>(_swapchainImages.size()) + currentImage };
+	const uint32_t threadCount{ _threadPool->getThreadCount() };
+	for (uint32_t worker{ 0 }; worker < threadCount; worker++) {
+		const size_t poolIdx{ slot * threadCount + worker };
+		vkResetCommandPool(_mainDevice.logicalDevice, _secondaryPools[poolIdx], 0);
+		_secondaryUsed[poolIdx] = 0;
+	}
+
+	const uint32_t segmentCount{ _renderGraph.getSegmentCount() };
+	for (uint32_t segment{ 0 }; segment < segmentCount; segment++) {
+		const VkCommandBuffer commandBuffer{ _commandBuffers[segment * _commandSlotCount + slot] };
+
+		// Start recording commands.
+		if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to start recording a command buffer.");
+		}		
 
-			// Start second subpass.
-			vkCmdNextSubpass(_commandBuffers[currentImage], VK_SUBPASS_CONTENTS_INLINE);
+		// First and last segments are always on the graphics queue, where the frame timestamps are written.
+		if (_dynamicResolutionEnabled && segment == 0) {
+			_dynamicResolution.cmdBeginFrame(commandBuffer, _currentFrame);
+		}
 
-			vkCmdBindPipeline(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _secondPipeline);
+		// Render passes, subpasses and barriers all come from the graph.
+		_renderGraph.execute(commandBuffer, segment, _currentFrame, currentImage);
 
-			vkCmdBindDescriptorSets(_commandBuffers[currentImage], VK_PIPELINE_BIND_POINT_GRAPHICS, _secondPipelineLayout,
-				0, 1, &_inputDescSets[currentImage], 0, nullptr);
+		if (_dynamicResolutionEnabled && segment + 1 == segmentCount) {
+			_dynamicResolution.cmdEndFrame(commandBuffer, _currentFrame);
+		}
 
-			vkCmdDraw(_commandBuffers[currentImage], 3, 1, 0, 0);
+		// Stop recording		
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to stop recording a command buffer.");
+		}
+	}
 
-		vkCmdEndRenderPass(_commandBuffers[currentImage]);
+	RecordedCommands &recorded{ _recordedCommands[slot] };
+	recorded.valid = true;
+	recorded.renderExtent = getRenderExtent();
+	recorded.transformOffset = _transformOffset;
+}
 
-	// Stop recording		
-	if (vkEndCommandBuffer(_commandBuffers[currentImage]) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to stop recording a command buffer.");
+void VulkanRenderer::recordSceneDraws(const VkCommandBuffer &commandBuffer, const uint32_t &frame, const uint32_t &imageIndex) {
+	if (_drawList.empty()) {
+		return;
 	}
+
+	// At most a chunk per worker, small scenes stay on fewer of them.
+	const size_t drawCount{ _drawList.size() };
+	const uint32_t chunkCount{ static_cast<uint32_t>(min(static_cast<size_t>(_threadPool->getThreadCount()),
+		(drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK)) };
+
+	const VkCommandBufferInheritanceInfo inheritanceInfo{ _renderGraph.getInheritanceInfo(_scenePass, frame, imageIndex) };
+	const uint32_t slot{ frame * static_cast<uint32_t>(_swapchainImages.size()) + imageIndex };
+	vector<VkCommandBuffer> chunkBuffers(chunkCount);
+
+	_threadPool->parallelFor(chunkCount, [&](uint32_t chunk, uint32_t worker) {
+		const VkCommandBuffer secondary{ getSecondaryCommandBuffer(slot, worker) };
+
+		// Submitted again along with the primary, so not one time.
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+		if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to start recording a secondary command buffer.");
+		}
+
+		recordSceneChunk(secondary, frame, _transformOffset, drawCount * chunk / chunkCount, drawCount * (chunk + 1) / chunkCount);
+
+		if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to stop recording a secondary command buffer.");
+		}
+		chunkBuffers[chunk] = secondary;
+	});
+
+	// Chunks in order, so draw order is the same as recording it all inline.
+	vkCmdExecuteCommands(commandBuffer, chunkCount, chunkBuffers.data());
 }
 
-void VulkanRenderer::createRenderPass() {
-	// Array of our subpasses.
-	array<VkSubpassDescription, 2> subpasses{};
-	
-	// ATTACHMENTS
-
-	// Subpass 1 attachments + references (input attachments)
-	VkAttachmentDescription colorAtt{};
-	colorAtt.format = _colorBufFormat;
-	colorAtt.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAtt.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Depth attachment of (input)
-	VkAttachmentDescription depthAtt{};
-	depthAtt.format = _depthBufFormat;
-	depthAtt.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAtt.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	// REFERENCES
-	// Color Attachment (Input) reference
-	// Attachment reference uses an attachment index that refers to index in the attachment list passed to renderPassCreateInfo.
-	VkAttachmentReference colorAttRef{};
-	colorAttRef.attachment = 1; // Use zeroth attachment in list passed to render pass -> color attachment
-	colorAttRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// Depth Attachment Ref
-	VkAttachmentReference depthAttRef{};
-	depthAttRef.attachment = 2;
-	depthAttRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpasses[0].colorAttachmentCount = 1;
-	subpasses[0].pColorAttachments = &colorAttRef;
-	subpasses[0].pDepthStencilAttachment = &depthAttRef;
-
-	// Subpass 2 att and refs.	
-	// Swapchain color attachment.
-	VkAttachmentDescription swapchainColorAtt{};
-	swapchainColorAtt.format = _swapchainImageFormat; // Format to use for attachment. 
-	swapchainColorAtt.samples = VK_SAMPLE_COUNT_1_BIT; // Number of samples to write for multisampling.
-	swapchainColorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR; // Similar to glClear Op. Describes what to do with attachment before rendering.
-	swapchainColorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE; // Describes what to do with attachment after rendering. Store so then it will be drawn.
-	swapchainColorAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE; // Describes what to do with stencil before rendering.
-	swapchainColorAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE; // Describes what to do with stencil afterrendering.
-
-	// Framebuffer data will be stored as an image, but images can be given dfferent data layouts.
-	// to give optimal use for certain operations.
-	swapchainColorAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED; // Image data layout before render pass starts.
-	// there will be a subpass layout in between initial and final.
-	swapchainColorAtt.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; // Image data layout after render pass. (to change to)
-
-	// REFERENCES
-	// Attachment reference uses an attachment index that refers to index in the attachment list passed to renderPassCreateInfo.
-	VkAttachmentReference swapchainColorAttRef{};
-	swapchainColorAttRef.attachment = 0; // Use first attachment in list passed to render pass.
-	swapchainColorAttRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	// References to attachments that subpass will take input from.
-	array<VkAttachmentReference, 2> inputRefs;
-	inputRefs[0].attachment = 1;
-	inputRefs[0].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	inputRefs[1].attachment = 2;
-	inputRefs[1].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-	// Setup subpass 2.
-	subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpasses[1].colorAttachmentCount = 1;
-	subpasses[1].pColorAttachments = &swapchainColorAttRef;
-	subpasses[1].inputAttachmentCount = static_cast<uint32_t>(inputRefs.size());
-	subpasses[1].pInputAttachments = inputRefs.data();
-
-	//SUBPASS DEPENDENCIES.
-
-	// Need to determine when layout transitions occur using subpass dependencies.
-	array<VkSubpassDependency, 3> subpassDependencies;
-
-	// Conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL.
-	// Transition must happen after ...
-	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL; // Subpass index, subpass external means anything that takes place outside of render pass.
-	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT; // Pipeline stage: End of subpass external.
-	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT; // Stage access mask: Being read when presented to screen.
-	// Transition must happen before ...
-	subpassDependencies[0].dstSubpass = 0;
-	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	subpassDependencies[0].dependencyFlags = 0;
-
-	// Subpass 1 layout (color/depth) to subpass 2 layout (shader read).
-	// Transition must happen after ...
-	subpassDependencies[1].srcSubpass = 0;
-	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	// Transition must happen before ...
-	subpassDependencies[1].dstSubpass = 1;
-	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	subpassDependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	subpassDependencies[1].dependencyFlags = 0;
-
-	// Conversion from VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL to VK_IMAGE_LAYOUT_PRESENT_SRC_KHR.
-	// Transition must happen after ...
-	subpassDependencies[2].srcSubpass = 0; // Subpass index, subpass external means anything that takes place outside of render pass.
-	subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[2].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	// Transition must happen before ...
-	subpassDependencies[2].dstSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[2].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	subpassDependencies[2].dependencyFlags = 0;
-
-	array<VkAttachmentDescription, 3> renderPassAttachments{ swapchainColorAtt, colorAtt, depthAtt };
-
-	// Create info for render pass.
-	VkRenderPassCreateInfo createInfo{};
-	createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	createInfo.attachmentCount = static_cast<uint32_t>(renderPassAttachments.size());
-	createInfo.pAttachments = renderPassAttachments.data();
-	createInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
-	createInfo.pSubpasses = subpasses.data();
-	createInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
-	createInfo.pDependencies = subpassDependencies.data();
-
-	VkResult result{ vkCreateRenderPass(_mainDevice.logicalDevice, &createInfo, nullptr, &_renderPass) };
-	if (result != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create the render pass.");
+void VulkanRenderer::recordSceneChunk(const VkCommandBuffer &commandBuffer, const uint32_t &frame, const uint32_t &transformOffset,
+	const size_t &firstDraw, const size_t &lastDraw) {
+	// Nothing is inherited from the primary but the render pass, each secondary sets up its own state.
+	const VkExtent2D renderArea{ _renderGraph.getPassExtent(_scenePass) };
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)renderArea.width;
+	viewport.height = (float)renderArea.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = renderArea;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	// Bind pipeline to be used in render pass.
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+
+	// Bind descriptor sets once, meshes only change the texture index they push.
+	if (_pushDescriptors) {
+		// View projection goes straight into the command buffer, no set to allocate or keep updated.
+		VkDescriptorBufferInfo vpBufInfo{};
+		vpBufInfo.buffer = _vpUniformBuffers[frame];
+		vpBufInfo.offset = 0;
+		vpBufInfo.range = sizeof(UboViewProjection);
+
+		VkWriteDescriptorSet vpSetWrite{};
+		vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		vpSetWrite.dstBinding = 0;
+		vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		vpSetWrite.descriptorCount = 1;
+		vpSetWrite.pBufferInfo = &vpBufInfo;
+
+		_cmdPushDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1, &vpSetWrite);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+			1, 1, &_textureDescSet, 0, nullptr);
+	}
+	else {
+		array<VkDescriptorSet, 2> descSetGroup{ _descSets[frame], _textureDescSet };
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+			0,
+			static_cast<uint32_t>(descSetGroup.size()),
+			descSetGroup.data(),
+			0,
+			nullptr);
+	}
+
+	// Uniform and storage binding, both at the same offset.
+	array<uint32_t, 2> dynamicOffsets{ transformOffset, transformOffset };
+	VkDescriptorSet frameDescSet{ _frameAllocator.getDescriptorSet() };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+		2, 1, &frameDescSet,
+		static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+
+	for (size_t drawIdx{ firstDraw }; drawIdx < lastDraw; drawIdx++) {
+		const DrawItem &draw{ _drawList[drawIdx] };
+		Mesh *mesh{ _modelCache.get(_models[draw.model].asset).getMesh(draw.mesh) };
+		VkBuffer vertexBuffers []{ mesh->getVertexBuffer() }; // Buffers to bind.
+		VkDeviceSize offsets []{ 0 }; // Offsets into buffers being bound.
+		// For firstBinding var, imagine shader has a implicit binding = 0 value.
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // Command to bind vertex buffer before drawing with them.
+
+		// Bind mesh index buffer with 0 offset and using uint32_t type.
+		vkCmdBindIndexBuffer(commandBuffer, mesh->getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+		// Push constant given to shader stage directly. (no buffer).
+		PushModel pushModel{ draw.model, static_cast<uint32_t>(mesh->getTexId()) };
+		vkCmdPushConstants(commandBuffer,
+			_pipelineLayout,
+			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, // Stage to push constant to.
+			0, // Offset of push constant to update.
+			sizeof(PushModel), // Size of data being pushed.
+			&pushModel); // Actual data being pushed (can be array).
+
+		// Execute our pipeline.
+		vkCmdDrawIndexed(commandBuffer, mesh->getIndexCount(), 1
+			, 0 // "index" of index to start at.
+			, 0 // "offset" of vertex to start at.
+			, 0); // which instance of mesh is first. to draw		
+		// gl_InstanceIndex can be used in the shader for the instance count.
+	}
+}
+
+VkCommandBuffer VulkanRenderer::getSecondaryCommandBuffer(const uint32_t &slot, const uint32_t &worker) {
+	// Only ever touched from this worker, so the pool needs no lock.
+	const size_t poolIdx{ slot * _threadPool->getThreadCount() + worker };
+	vector<VkCommandBuffer> &buffers{ _secondaryBuffers[poolIdx] };
+
+	if (_secondaryUsed[poolIdx] == buffers.size()) {
+		VkCommandBufferAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		info.commandPool = _secondaryPools[poolIdx];
+		info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		info.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(_mainDevice.logicalDevice, &info, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate a secondary command buffer.");
+		}
+		buffers.push_back(commandBuffer);
+	}
+	return buffers[_secondaryUsed[poolIdx]++];
+}
+
+void VulkanRenderer::recordLightCull(const VkCommandBuffer &commandBuffer, const uint32_t &frame) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _lightCullPipeline);
+
+	VkDescriptorSet lightingDescSet{ _tiledLighting.getDescriptorSet(frame) };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _lightCullPipelineLayout,
+		0, 1, &lightingDescSet, 0, nullptr);
+
+	const PushLighting pushLighting{ _tiledLighting.getPush(_uboViewProj.proj, getRenderExtent()) };
+	vkCmdPushConstants(commandBuffer, _lightCullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(PushLighting), &pushLighting);
+
+	// One group per tile.
+	vkCmdDispatch(commandBuffer, pushLighting.tileCount.x, pushLighting.tileCount.y, 1);
+}
+
+void VulkanRenderer::recordLighting(const VkCommandBuffer &commandBuffer, const uint32_t &frame) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _lightingPipeline);
+
+	array<VkDescriptorSet, 2> lightingDescSets{ _renderGraph.getDescriptorSet(_lightingPass, frame), _tiledLighting.getDescriptorSet(frame) };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _lightingPipelineLayout,
+		0, static_cast<uint32_t>(lightingDescSets.size()), lightingDescSets.data(), 0, nullptr);
+
+	const PushLighting pushLighting{ _tiledLighting.getPush(_uboViewProj.proj, getRenderExtent()) };
+	vkCmdPushConstants(commandBuffer, _lightingPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(PushLighting), &pushLighting);
+
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void VulkanRenderer::recordPostEffect(const VkCommandBuffer &commandBuffer, const size_t &effect, const uint32_t &frame) {
+	const bool compute{ _postEffects[effect].mode != PostEffectMode::Fragment };
+	const VkPipelineBindPoint bindPoint{ compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS };
+	vkCmdBindPipeline(commandBuffer, bindPoint, _postPipelines[effect]);
+
+	VkDescriptorSet postDescSet{ _renderGraph.getDescriptorSet(_postPasses[effect], frame) };
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, _postPipelineLayouts[effect],
+		0, 1, &postDescSet, 0, nullptr);
+
+	// Effects only cover the scaled region with dynamic resolution.
+	const VkExtent2D extent{ getRenderExtent() };
+	PushPost pushPost{};
+	pushPost.extent = glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+	vkCmdPushConstants(commandBuffer, _postPipelineLayouts[effect], compute ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(PushPost), &pushPost);
+
+	if (compute) {
+		// 8x8 groups, rounded up. Shader skips pixels past the extent.
+		vkCmdDispatch(commandBuffer, (extent.width + 7) / 8, (extent.height + 7) / 8, 1);
 	}
+	else {
+		vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	}
+}
 
+void VulkanRenderer::recordUpscale(const VkCommandBuffer &commandBuffer, const uint32_t &frame) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _upscalePipeline);
+
+	VkDescriptorSet upscaleDescSet{ _renderGraph.getDescriptorSet(_finalPass, frame) };
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _upscalePipelineLayout,
+		0, 1, &upscaleDescSet, 0, nullptr);
+
+	// Scene images are swapchain sized, so output pixel -> uv is the render/output ratio over the image size.
+	// Without dynamic resolution that's 1:1, a plain copy.
+	const float width{ static_cast<float>(_swapchainExtent.width) };
+	const float height{ static_cast<float>(_swapchainExtent.height) };
+	const VkExtent2D renderExtent{ getRenderExtent() };
+	PushUpscale pushUpscale{};
+	pushUpscale.uvScale = glm::vec2(renderExtent.width / (width * width), renderExtent.height / (height * height));
+	pushUpscale.uvMax = glm::vec2((renderExtent.width - 0.5f) / width, (renderExtent.height - 0.5f) / height);
+	vkCmdPushConstants(commandBuffer, _upscalePipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+		0, sizeof(PushUpscale), &pushUpscale);
+
+	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
 }
 
 void VulkanRenderer::createDescriptorSetLayout() {
@@ -1036,21 +1511,12 @@ void VulkanRenderer::createDescriptorSetLayout() {
 	vpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Shader stage to bind to.
 	vpLayoutBinding.pImmutableSamplers = nullptr; // For texture: can make sampler data immutable.
 
-	/*
-	// Model binding info.
-	VkDescriptorSetLayoutBinding modelLayoutBinding{};
-	modelLayoutBinding.binding = 1;
-	modelLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-	modelLayoutBinding.descriptorCount = 1;
-	modelLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	modelLayoutBinding.pImmutableSamplers = nullptr;
-	*/
-
-	vector<VkDescriptorSetLayoutBinding> layoutBindings{ vpLayoutBinding }; // , modelLayoutBinding};
+	vector<VkDescriptorSetLayoutBinding> layoutBindings{ vpLayoutBinding };
 
 	// Create layout with given bindings.
 	VkDescriptorSetLayoutCreateInfo descSetLayoutCreateInfo{};
 	descSetLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	descSetLayoutCreateInfo.flags = _pushDescriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0; // Pushed, never allocated.
 	descSetLayoutCreateInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
 	descSetLayoutCreateInfo.pBindings = layoutBindings.data();
 
@@ -1058,17 +1524,50 @@ void VulkanRenderer::createDescriptorSetLayout() {
 		throw std::runtime_error("Failed to create the descriptor set layout.");
 	}
 
-	// Create texture sampler descriptor set layout.
+	// Fallback sets are written from a VkDescriptorBufferInfo through this, rebuilt with the swapchain.
+	if (!_pushDescriptors) {
+		VkDescriptorUpdateTemplateEntry vpTemplateEntry{};
+		vpTemplateEntry.dstBinding = 0;
+		vpTemplateEntry.dstArrayElement = 0;
+		vpTemplateEntry.descriptorCount = 1;
+		vpTemplateEntry.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		vpTemplateEntry.offset = 0;
+		vpTemplateEntry.stride = sizeof(VkDescriptorBufferInfo);
+
+		VkDescriptorUpdateTemplateCreateInfo templateCreateInfo{};
+		templateCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+		templateCreateInfo.descriptorUpdateEntryCount = 1;
+		templateCreateInfo.pDescriptorUpdateEntries = &vpTemplateEntry;
+		templateCreateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+		templateCreateInfo.descriptorSetLayout = _descSetLayout;
+
+		if (vkCreateDescriptorUpdateTemplate(_mainDevice.logicalDevice, &templateCreateInfo, nullptr, &_vpUpdateTemplate) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create the view projection descriptor update template.");
+		}
+	}
+
+	// Create texture sampler descriptor set layout. One array holding every texture.
 	VkDescriptorSetLayoutBinding samplerLayoutBinding{};
 	samplerLayoutBinding.binding = 0;
 	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.descriptorCount = 1;
+	samplerLayoutBinding.descriptorCount = _maxTextures;
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 
+	// Unwritten elements are fine as long as they aren't used, new textures can be written while the set is bound
+	// and while frames using other elements are still in flight.
+	VkDescriptorBindingFlags samplerBindingFlags{ VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+		| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT };
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = 1;
+	bindingFlagsCreateInfo.pBindingFlags = &samplerBindingFlags;
+
 	// Create a descriptor set layout with given bindings for texture.
 	VkDescriptorSetLayoutCreateInfo texLayoutCreateInfo{};
 	texLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	texLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	texLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
 	texLayoutCreateInfo.bindingCount = 1;
 	texLayoutCreateInfo.pBindings = &samplerLayoutBinding;
 
@@ -1076,43 +1575,17 @@ void VulkanRenderer::createDescriptorSetLayout() {
 	if (vkCreateDescriptorSetLayout(_mainDevice.logicalDevice, &texLayoutCreateInfo, nullptr, &_samplerSetLayout) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create the sampler descriptor set layout.");
 	}
-
-	// Create input attachment image descriptor set layout.
-	// Color input binding.
-	VkDescriptorSetLayoutBinding colorInputLayoutBinding{};
-	colorInputLayoutBinding.binding = 0;
-	colorInputLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	colorInputLayoutBinding.descriptorCount = 1;
-	colorInputLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	// Depth input binding.
-	VkDescriptorSetLayoutBinding depthInputLayoutBinding{};
-	depthInputLayoutBinding.binding = 1;
-	depthInputLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	depthInputLayoutBinding.descriptorCount = 1;
-	depthInputLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	array<VkDescriptorSetLayoutBinding, 2> inputBindings{ colorInputLayoutBinding, depthInputLayoutBinding };
-
-	// Create a descriptor set layout for input attachments.
-	VkDescriptorSetLayoutCreateInfo inputLayoutCreateInfo{};
-	inputLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	inputLayoutCreateInfo.bindingCount = static_cast<uint32_t>(inputBindings.size());
-	inputLayoutCreateInfo.pBindings = inputBindings.data();
-
-	// Create descriptor set layout
-	if (vkCreateDescriptorSetLayout(_mainDevice.logicalDevice, &inputLayoutCreateInfo, nullptr, &_inputSetLayout) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create the sampler descriptor set layout.");
-	}
 }
 
 void VulkanRenderer::createPushConstantRange() {
 	// Define push constant values. No create needed.
-	_pushConstRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Shader stage will go to.
+	// Model index for the vertex shader, texture index for the fragment shader.
+	_pushConstRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT; // Shader stage will go to.
 	_pushConstRange.offset = 0; // Offset into given data to push constant.
-	_pushConstRange.size = sizeof(Model); // Size of data being passed.
+	_pushConstRange.size = sizeof(PushModel); // Size of data being passed.
 }
 
-VkImage VulkanRenderer::createImage(const uint32_t &width, const uint32_t &height, const VkFormat &format, const VkImageTiling &tiling, const VkImageUsageFlags &usageFlags, const VkMemoryPropertyFlags &memPropFlags, VkDeviceMemory *imageMemory) {
+VkImage VulkanRenderer::createImage(const uint32_t &width, const uint32_t &height, const uint32_t &mipLevels, const VkFormat &format, const VkImageTiling &tiling, const VkImageUsageFlags &usageFlags, const VkMemoryPropertyFlags &memPropFlags, VkDeviceMemory *imageMemory) {
 	// CREATE IMAGE
 	// Image Creation Info
 	VkImageCreateInfo imageCreateInfo{};
@@ -1121,7 +1594,7 @@ VkImage VulkanRenderer::createImage(const uint32_t &width, const uint32_t &heigh
 	imageCreateInfo.extent.width = width; // Width of image extent.
 	imageCreateInfo.extent.height = height; // Height of image extent.
 	imageCreateInfo.extent.depth = 1; // Depth of image extent, just 1, no 3d aspect.
-	imageCreateInfo.mipLevels = 1; // # of mipmap levels.
+	imageCreateInfo.mipLevels = mipLevels; // # of mipmap levels.
 	imageCreateInfo.arrayLayers = 1; // number of levels in image array.
 	imageCreateInfo.format = format; // Format type of image.
 	imageCreateInfo.tiling = tiling; // how image data should be tiled(arranged for optimal reading).
@@ -1144,7 +1617,13 @@ VkImage VulkanRenderer::createImage(const uint32_t &width, const uint32_t &heigh
 	VkMemoryAllocateInfo memAllocInfo{};
 	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 	memAllocInfo.allocationSize = memReqs.size;
-	memAllocInfo.memoryTypeIndex = findMemoryTypeIndex(_mainDevice.physicalDevice, memReqs.memoryTypeBits, memPropFlags);
+	// Lazily allocated memory is optional, fall back to the same flags without it if there's no such memory type.
+	VkMemoryPropertyFlags imageMemPropFlags{ memPropFlags };
+	if ((imageMemPropFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+		&& !hasMemoryType(_mainDevice.physicalDevice, memReqs.memoryTypeBits, imageMemPropFlags)) {
+		imageMemPropFlags &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+	memAllocInfo.memoryTypeIndex = findMemoryTypeIndex(_mainDevice.physicalDevice, memReqs.memoryTypeBits, imageMemPropFlags);
 
 	if (vkAllocateMemory(_mainDevice.logicalDevice, &memAllocInfo, nullptr, imageMemory) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to allocate memory for image.");
@@ -1158,7 +1637,7 @@ VkImage VulkanRenderer::createImage(const uint32_t &width, const uint32_t &heigh
 	return image;
 }
 
-VkImageView VulkanRenderer::createImageView(const VkImage &image, const VkFormat &format, const VkImageAspectFlags &aspectFlags) {
+VkImageView VulkanRenderer::createImageView(const VkImage &image, const VkFormat &format, const VkImageAspectFlags &aspectFlags, const uint32_t &mipLevels) {
 	VkImageViewCreateInfo viewCreateInfo{};
 	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewCreateInfo.image = image; // Image to create view for.
@@ -1168,10 +1647,15 @@ VkImageView VulkanRenderer::createImageView(const VkImage &image, const VkFormat
 	viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
 	viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
 	viewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+	// Single channel textures read as grey.
+	if (format == VK_FORMAT_BC4_UNORM_BLOCK) {
+		viewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_R;
+		viewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_R;
+	}
 	// Subresources allow the view to view only a part of an image.
 	viewCreateInfo.subresourceRange.aspectMask = aspectFlags; // Which aspect of the image to view. (e.g. COLOR_BIT for viewing color.
 	viewCreateInfo.subresourceRange.baseMipLevel = 0; // Start mipmap level to view from.
-	viewCreateInfo.subresourceRange.levelCount = 1; // Number of mipmap levels to view.
+	viewCreateInfo.subresourceRange.levelCount = mipLevels; // Number of mipmap levels to view.
 	viewCreateInfo.subresourceRange.baseArrayLayer = 0; // Start array level to view from.
 	viewCreateInfo.subresourceRange.layerCount = 1; // number of array levels to view.
 
@@ -1233,19 +1717,15 @@ void VulkanRenderer::createDebugMessengerExtension() {
 void VulkanRenderer::createSync() {
 	_imageAvailable.resize(MAX_FRAME_DRAWS);
 	_renderFinished.resize(MAX_FRAME_DRAWS);
-	_drawFences.resize(MAX_FRAME_DRAWS);
+	_framePoints.assign(MAX_FRAME_DRAWS, TimelineScheduler::Point{});
 
+	// Binary, only for the swapchain. Everything else waits on timeline points.
 	VkSemaphoreCreateInfo info{};
 	info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for (size_t i{ 0 }; i < MAX_FRAME_DRAWS; i++) {
 		if (vkCreateSemaphore(_mainDevice.logicalDevice, &info, nullptr, &_imageAvailable[i]) != VK_SUCCESS
-			|| vkCreateSemaphore(_mainDevice.logicalDevice, &info, nullptr, &_renderFinished[i]) != VK_SUCCESS
-			|| vkCreateFence(_mainDevice.logicalDevice, &fenceInfo, nullptr, &_drawFences[i]) != VK_SUCCESS) {
+			|| vkCreateSemaphore(_mainDevice.logicalDevice, &info, nullptr, &_renderFinished[i]) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create a semaphore.");
 		}
 	}
@@ -1256,112 +1736,101 @@ void VulkanRenderer::createUniformBuffers() {
 	// Buffer size will be size of two variables. (will offset to access).
 	VkDeviceSize vpBufSize = sizeof(UboViewProjection);
 
-	// Model buffer size.
-	//VkDeviceSize modelBufSize = _modelUniAlignment * MAX_OBJECTS;
-
-	// One uniform buffer for each image (and by extension)
-	_vpUniformBuffers.resize(_swapchainImages.size());
-	_vpUniformBufMems.resize(_swapchainImages.size());
-
-	//_modelDynUniformBuffers.resize(_swapchainImages.size());
-	//_modelDynUniformBufMems.resize(_swapchainImages.size());
+	// One uniform buffer for each frame in flight. The CPU writes one while the GPU reads another.
+	_vpUniformBuffers.resize(MAX_FRAME_DRAWS);
+	_vpUniformBufMems.resize(MAX_FRAME_DRAWS);
+	_vpUniformMapped.resize(MAX_FRAME_DRAWS);
 
 	// create buffers
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
+	for (size_t i{ 0 }; i < MAX_FRAME_DRAWS; i++) {
 		createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, vpBufSize,
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 			&_vpUniformBuffers[i],
 			&_vpUniformBufMems[i]);
-		/*
-		createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, modelBufSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&_modelDynUniformBuffers[i],
-			&_modelDynUniformBufMems[i]);
-		*/
+
+		// Host coherent, so mapped once and written straight into every frame.
+		if (vkMapMemory(_mainDevice.logicalDevice, _vpUniformBufMems[i], 0, vpBufSize, 0, &_vpUniformMapped[i]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map a uniform buffer.");
+		}
 	}
 }
 
 void VulkanRenderer::createDescriptorPool() {
-	// Create uniform descriptor pool.
-	// Type of descriptors + how many DESCRIPTORS, not desc sets. (combined makes the pool size).
-	// View Projection Pool.
-	VkDescriptorPoolSize vpPoolSize{};
-	vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	vpPoolSize.descriptorCount = static_cast<uint32_t>(_vpUniformBuffers.size());
-
-	/*
-	// Mode Projection Pool (DYNAMIC)
-	VkDescriptorPoolSize modelPoolSize{};
-	modelPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-	modelPoolSize.descriptorCount = static_cast<uint32_t>(_modelDynUniformBuffers.size());
-	*/
+	createUniformDescriptorPool();
 
-	vector<VkDescriptorPoolSize> poolSizes{ vpPoolSize }; // , modelPoolSize };
-
-	VkDescriptorPoolCreateInfo descPoolCreateInfo{};
-	descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	descPoolCreateInfo.maxSets = static_cast<uint32_t>(_swapchainImages.size()); // Max # of descriptor sets that can be created from pool.
-	descPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size()); // Amount of pool sizes being passed.
-	descPoolCreateInfo.pPoolSizes = poolSizes.data(); // Pool sizes to create pool with.
-
-	if (vkCreateDescriptorPool(_mainDevice.logicalDevice, &descPoolCreateInfo, nullptr, &_descPool) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create a descriptor pool.");
-	}
-
-	// Create sampler descriptor pool
-	// Texture sampler pool.
-	VkDescriptorPoolSize samplerPoolSize{};
-	samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerPoolSize.descriptorCount = MAX_OBJECTS; // Creating image and desc set at the same time. Assuming each object will have only one texture.
+	// Create sampler descriptor pool
+	// Texture sampler pool. One set with the whole texture array.
+	VkDescriptorPoolSize samplerPoolSize{};
+	samplerPoolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	samplerPoolSize.descriptorCount = _maxTextures;
 
 	VkDescriptorPoolCreateInfo samplerPoolCreateInfo{};
 	samplerPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	samplerPoolCreateInfo.maxSets = MAX_OBJECTS;
-	samplerPoolCreateInfo.poolSizeCount = 1; // One set for each object.
+	samplerPoolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	samplerPoolCreateInfo.maxSets = 1;
+	samplerPoolCreateInfo.poolSizeCount = 1;
 	samplerPoolCreateInfo.pPoolSizes = &samplerPoolSize;
 
 	if (vkCreateDescriptorPool(_mainDevice.logicalDevice, &samplerPoolCreateInfo, nullptr, &_samplerDescPool) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create a sampler descriptor pool.");
 	}
 
-	// Create input attachment descriptor pool.
-	// Color attachment pool size.
-	VkDescriptorPoolSize colorInputPoolSize{};
-	colorInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	colorInputPoolSize.descriptorCount = static_cast<uint32_t>(_colorBufImageViews.size());
+	// Texture array set, filled in as textures are created. Lives as long as the pool, not the swapchain.
+	VkDescriptorSetAllocateInfo texSetAllocInfo{};
+	texSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	texSetAllocInfo.descriptorPool = _samplerDescPool;
+	texSetAllocInfo.descriptorSetCount = 1;
+	texSetAllocInfo.pSetLayouts = &_samplerSetLayout;
 
-	// Depth attachment pool size
-	VkDescriptorPoolSize depthInputPoolSize{};
-	depthInputPoolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-	depthInputPoolSize.descriptorCount = static_cast<uint32_t>(_depthBufImageViews.size());
+	if (vkAllocateDescriptorSets(_mainDevice.logicalDevice, &texSetAllocInfo, &_textureDescSet) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to allocate the texture descriptor set.");
+	}
+}
 
-	array<VkDescriptorPoolSize, 2> inputPoolSizes{ colorInputPoolSize, depthInputPoolSize };
+void VulkanRenderer::createUniformDescriptorPool() {
+	// Pushed descriptors need no sets.
+	if (_pushDescriptors) {
+		return;
+	}
 
-	VkDescriptorPoolCreateInfo inputPoolCreateInfo{};
-	inputPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	inputPoolCreateInfo.maxSets = static_cast<uint32_t>(_swapchainImages.size());
-	inputPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(inputPoolSizes.size());
-	inputPoolCreateInfo.pPoolSizes = inputPoolSizes.data();
+	// Create uniform descriptor pool.
+	// Type of descriptors + how many DESCRIPTORS, not desc sets. (combined makes the pool size).
+	// View Projection Pool.
+	VkDescriptorPoolSize vpPoolSize{};
+	vpPoolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	vpPoolSize.descriptorCount = static_cast<uint32_t>(_vpUniformBuffers.size());
 
-	if (vkCreateDescriptorPool(_mainDevice.logicalDevice, &inputPoolCreateInfo, nullptr, &_inputDescPool) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to create a input descriptor pool.");
+	vector<VkDescriptorPoolSize> poolSizes{ vpPoolSize };
+
+	VkDescriptorPoolCreateInfo descPoolCreateInfo{};
+	descPoolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	descPoolCreateInfo.maxSets = MAX_FRAME_DRAWS; // Max # of descriptor sets that can be created from pool.
+	descPoolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size()); // Amount of pool sizes being passed.
+	descPoolCreateInfo.pPoolSizes = poolSizes.data(); // Pool sizes to create pool with.
+
+	if (vkCreateDescriptorPool(_mainDevice.logicalDevice, &descPoolCreateInfo, nullptr, &_descPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create a descriptor pool.");
 	}
 }
 
 void VulkanRenderer::createDescriptorSets() {
+	// Pushed while recording instead.
+	if (_pushDescriptors) {
+		return;
+	}
+
 	// One for every uniform buffer.
-	_descSets.resize(_swapchainImages.size());
+	_descSets.resize(MAX_FRAME_DRAWS);
 
 	// Create copies of the original desc set layout for all desc sets.
-	vector<VkDescriptorSetLayout> descSetLayouts(_swapchainImages.size(), _descSetLayout);
+	vector<VkDescriptorSetLayout> descSetLayouts(MAX_FRAME_DRAWS, _descSetLayout);
 
 	// Desc Set Alloc Info.
 	VkDescriptorSetAllocateInfo descSetAllocInfo{};
 	descSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	descSetAllocInfo.descriptorPool = _descPool; // Pool to allocate desc set from.
-	descSetAllocInfo.descriptorSetCount = static_cast<uint32_t>(_swapchainImages.size()); // Number of sets to allocate.
+	descSetAllocInfo.descriptorSetCount = MAX_FRAME_DRAWS; // Number of sets to allocate.
 	descSetAllocInfo.pSetLayouts = descSetLayouts.data(); // Layouts to use to allocate sets. (1:1 relationship).
 
 	// Allocate desc sets (multiple)
@@ -1370,7 +1839,7 @@ void VulkanRenderer::createDescriptorSets() {
 	}
 
 	// Update all desc set buff bindings.
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
+	for (size_t i{ 0 }; i < MAX_FRAME_DRAWS; i++) {
 		// View projection descriptor. 
 		// Buffer info and offset info.
 		VkDescriptorBufferInfo vpBufInfo{};
@@ -1378,103 +1847,8 @@ void VulkanRenderer::createDescriptorSets() {
 		vpBufInfo.offset = 0; // Position of start of data.
 		vpBufInfo.range = sizeof(UboViewProjection);
 
-		// Data about connection between binding and buffer.
-		VkWriteDescriptorSet vpSetWrite{};
-		vpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		vpSetWrite.dstSet = _descSets[i]; // Des cset to update.
-		vpSetWrite.dstBinding = 0; // Binding to update. Matches with binding on layout/shader.
-		vpSetWrite.dstArrayElement = 0; // Index of array to update.
-		vpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Type of descriptor.
-		vpSetWrite.descriptorCount = 1; // How many descs we are updating.
-		vpSetWrite.pBufferInfo = &vpBufInfo; // Info about buffer data to bind.
-
-		/*
-		// Model descriptor.
-		// Model buffer binding info.
-		VkDescriptorBufferInfo modelBufInfo{};
-		modelBufInfo.buffer = _modelDynUniformBuffers[i];
-		modelBufInfo.offset = 0;
-		modelBufInfo.range = _modelUniAlignment;
-
-		VkWriteDescriptorSet modelSetWrite{};
-		modelSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		modelSetWrite.dstSet = _descSets[i];
-		modelSetWrite.dstBinding = 1;
-		modelSetWrite.dstArrayElement = 0;
-		modelSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-		modelSetWrite.descriptorCount = 1;
-		modelSetWrite.pBufferInfo = &modelBufInfo;
-		*/
-
-		vector<VkWriteDescriptorSet> writeDescSets{ vpSetWrite }; // , modelSetWrite };
-
-		// Update the desc sets with new buffer binding info.
-		vkUpdateDescriptorSets(_mainDevice.logicalDevice, 
-			static_cast<uint32_t>(writeDescSets.size()), 
-			writeDescSets.data(),
-			0,
-			nullptr);
-	}
-}
-
-void VulkanRenderer::createInputDescriptorSets() {
-	// Resize array to hold desc set for each swap chain image.
-	_inputDescSets.resize(_swapchainImages.size());
-
-	// Fill array of layouts ready for set creation. Copies of _inputSetLayout
-	vector<VkDescriptorSetLayout> setLayouts(_swapchainImages.size(), _inputSetLayout);
-
-	// Input attachment descriptor set allocation info.
-	VkDescriptorSetAllocateInfo setAllocInfo{};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = _inputDescPool;
-	setAllocInfo.descriptorSetCount = static_cast<uint32_t>(_swapchainImages.size());
-	setAllocInfo.pSetLayouts = setLayouts.data();
-
-	// Allocate descriptor sets.
-	if (vkAllocateDescriptorSets(_mainDevice.logicalDevice, &setAllocInfo, _inputDescSets.data()) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate input attachment descriptor sets.");
-	}
-
-	// Update each descriptor set with input attachment.
-	for (size_t i{ 0 }; i < _swapchainImages.size(); i++) {
-		// Color Attachment descriptor.
-		VkDescriptorImageInfo colorAttDesc{};
-		colorAttDesc.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		colorAttDesc.imageView = _colorBufImageViews[i];
-		colorAttDesc.sampler = VK_NULL_HANDLE;
-
-		// Color attachment descriptor write.
-		VkWriteDescriptorSet colorWrite{};
-		colorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		colorWrite.dstSet = _inputDescSets[i];
-		colorWrite.dstBinding = 0;
-		colorWrite.dstArrayElement = 0;
-		colorWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-		colorWrite.descriptorCount = 1;
-		colorWrite.pImageInfo = &colorAttDesc;
-
-		// Color Attachment descriptor.
-		VkDescriptorImageInfo depthAttDesc{};
-		depthAttDesc.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		depthAttDesc.imageView = _depthBufImageViews[i];
-		depthAttDesc.sampler = VK_NULL_HANDLE;
-
-		// Color attachment descriptor write.
-		VkWriteDescriptorSet depthWrite{};
-		depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		depthWrite.dstSet = _inputDescSets[i];
-		depthWrite.dstBinding = 1;
-		depthWrite.dstArrayElement = 0;
-		depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
-		depthWrite.descriptorCount = 1;
-		depthWrite.pImageInfo = &depthAttDesc;
-
-		// List of input descriptor set writes.
-		vector<VkWriteDescriptorSet> setWrites{ colorWrite, depthWrite };
-
-		// Update descriptor sets.
-		vkUpdateDescriptorSets(_mainDevice.logicalDevice, static_cast<uint32_t>(setWrites.size()), setWrites.data(), 0, nullptr);
+		// Update the desc set with new buffer binding info. Template knows the binding, just hand it the buffer info.
+		vkUpdateDescriptorSetWithTemplate(_mainDevice.logicalDevice, _descSets[i], _vpUpdateTemplate, &vpBufInfo);
 	}
 }
 
@@ -1492,59 +1866,64 @@ void VulkanRenderer::createTextureSampler() {
 	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR; // As we move away, the rate that fades as we move between mipmaps is linear. Will blend at a linear rate. Mipmap interpolation mode.
 	samplerCreateInfo.mipLodBias = 0.0f; // Add a bias, level of detail bias to mipmap level.
 	samplerCreateInfo.minLod = 0.0f; // Min level of detail to pick mip level
-	samplerCreateInfo.maxLod = 0.0f; // Max level of detail to pick mip level
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE; // Max level of detail to pick mip level. Every level textures have.
 	samplerCreateInfo.anisotropyEnable = VK_TRUE; // Overcomes stretching of mipmaps.
 	samplerCreateInfo.maxAnisotropy = 16; // Amount of samples being taken.
 
 	if (vkCreateSampler(_mainDevice.logicalDevice, &samplerCreateInfo, nullptr, &_textureSampler) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create a texture sampler.");
 	}
+
+	// Upscale sampler. Bilinear, clamped so the edge of the rendered region doesn't wrap.
+	VkSamplerCreateInfo upscaleSamplerCreateInfo{};
+	upscaleSamplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	upscaleSamplerCreateInfo.magFilter = VK_FILTER_LINEAR;
+	upscaleSamplerCreateInfo.minFilter = VK_FILTER_LINEAR;
+	upscaleSamplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	upscaleSamplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	upscaleSamplerCreateInfo.unnormalizedCoordinates = VK_FALSE;
+	upscaleSamplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	upscaleSamplerCreateInfo.minLod = 0.0f;
+	upscaleSamplerCreateInfo.maxLod = 0.0f;
+	upscaleSamplerCreateInfo.anisotropyEnable = VK_FALSE;
+
+	if (vkCreateSampler(_mainDevice.logicalDevice, &upscaleSamplerCreateInfo, nullptr, &_upscaleSampler) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create the upscale sampler.");
+	}
+}
+
+void VulkanRenderer::updateUniformBuffers(const uint32_t &frame) {
+	// Copy vp data. The frame's point has been reached, so nothing is reading this one.
+	memcpy(_vpUniformMapped[frame], &_uboViewProj, _uboViewProjSize);
 }
 
-void VulkanRenderer::updateUniformBuffers(const uint32_t &imageIndex) {
-	// Copy vp data.
-	void *data;
-	vkMapMemory(_mainDevice.logicalDevice, 
-		_vpUniformBufMems[imageIndex],
-		0, 
-		_uboViewProjSize,
-		0, 
-		&data);
-	memcpy(data, &_uboViewProj, _uboViewProjSize);
-	vkUnmapMemory(_mainDevice.logicalDevice, _vpUniformBufMems[imageIndex]);
+void VulkanRenderer::uploadTransforms() {
+	if (_models.empty()) {
+		return;
+	}
 
-	/*
-	// Copy model data.
-	for (size_t i{ 0 }; i < _meshes.size(); i++) {
-		// Add offset to where the alignment meets for the next object.
-		UboModel *thisModel{ (UboModel *)((uint64_t)_modelTransferSpace + (i * _modelUniAlignment)) };
-		*thisModel = _meshes[i].getModel();
-	}
-
-	const size_t modelUniDataSize = _modelUniAlignment * _meshes.size();
-
-	// Map the list of model data.
-	vkMapMemory(_mainDevice.logicalDevice,
-		_modelDynUniformBufMems[imageIndex],
-		0,
-		modelUniDataSize,
-		0,
-		&data);
-	memcpy(data, _modelTransferSpace, modelUniDataSize);
-	vkUnmapMemory(_mainDevice.logicalDevice, _modelDynUniformBufMems[imageIndex]);
-	*/
+	// Every model matrix for this frame in one allocation, read by index. First thing allocated after the reset,
+	// so the offset stays the same frame to frame and recorded commands can keep binding it.
+	FrameAllocator::Allocation transforms{ _frameAllocator.allocate(sizeof(glm::mat4) * _models.size()) };
+	glm::mat4 *modelMatrices{ static_cast<glm::mat4 *>(transforms.data) };
+	for (size_t modelIdx{ 0 }; modelIdx < _models.size(); modelIdx++) {
+		modelMatrices[modelIdx] = _models[modelIdx].model;
+	}
+	_transformOffset = transforms.offset;
 }
 
-void VulkanRenderer::allocateDynamicBufferTransferSpace() {
-	/*
-	// Calculate alignment of model data.
-	// ex _minUniBufOffset = 32 = 00100000
-	// ~(_uniBufOffset - 1) = Inverse of (00100000 - 1) -> inverse of 00011111 -> 11100000 = MASK
-	_modelUniAlignment = (sizeof(Model) + _minUniBufOffset - 1) & ~(_minUniBufOffset - 1);
+void VulkanRenderer::updateProjection() {
+	_uboViewProj.proj = glm::perspective(
+		glm::radians(45.0f),
+		(float)_swapchainExtent.width / (float)_swapchainExtent.height,
+		0.1f,
+		100.0f
+	);
 
-	// Create space in memory to hold dynamic buffer that is aligned to our required alignment and holds MAX_OBJECTS.
-	_modelTransferSpace = (Model *)_aligned_malloc(_modelUniAlignment * MAX_OBJECTS, _modelUniAlignment);
-	*/
+	// Y coordinate is inverted in Vulkan.
+	_uboViewProj.proj[1][1] *= -1;
 }
 
 void VulkanRenderer::getPhysicalDevice() {
@@ -1572,7 +1951,21 @@ void VulkanRenderer::getPhysicalDevice() {
 	// Get props of new device.
 	VkPhysicalDeviceProperties deviceProps{};
 	vkGetPhysicalDeviceProperties(_mainDevice.physicalDevice, &deviceProps);
-	//_minUniBufOffset = deviceProps.limits.minUniformBufferOffsetAlignment;	
+
+	// Texture array size, combined image samplers count as both a sampler and a sampled image.
+	VkPhysicalDeviceVulkan12Properties vulkan12Props{};
+	vulkan12Props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+	VkPhysicalDeviceProperties2 deviceProps2{};
+	deviceProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProps2.pNext = &vulkan12Props;
+	vkGetPhysicalDeviceProperties2(_mainDevice.physicalDevice, &deviceProps2);
+	_maxTextures = static_cast<uint32_t>(MAX_TEXTURES);
+	_maxTextures = min(_maxTextures, vulkan12Props.maxPerStageDescriptorUpdateAfterBindSamplers);
+	_maxTextures = min(_maxTextures, vulkan12Props.maxPerStageDescriptorUpdateAfterBindSampledImages);
+	_maxTextures = min(_maxTextures, vulkan12Props.maxDescriptorSetUpdateAfterBindSamplers);
+	_maxTextures = min(_maxTextures, vulkan12Props.maxDescriptorSetUpdateAfterBindSampledImages);
+
+	_pushDescriptors = isDeviceExtensionSupported(_mainDevice.physicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
 }
 
 vector<const char *> VulkanRenderer::getRequiredExtensions() {
@@ -1647,6 +2040,21 @@ bool VulkanRenderer::checkDeviceExtensionSupport(const VkPhysicalDevice &device)
 	return true;
 }
 
+bool VulkanRenderer::isDeviceExtensionSupported(const VkPhysicalDevice &device, const char *extensionName) {
+	uint32_t extensionCount{ 0 };
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+	vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+	for (const auto &extension : extensions) {
+		if (strcmp(extensionName, extension.extensionName) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
 bool VulkanRenderer::checkDeviceSuitable(const VkPhysicalDevice &device) {
 	
 	// Info about the device. (id, name, type, vendor ,etc)
@@ -1656,6 +2064,20 @@ bool VulkanRenderer::checkDeviceSuitable(const VkPhysicalDevice &device) {
 	// Info about what the device can do. (geo shader, tess shader, wide lines, etc)
 	VkPhysicalDeviceFeatures deviceFeatures;
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+
+	// Descriptor indexing, needed for the bindless texture array. Timeline semaphores for all submits.
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 deviceFeatures2{};
+	deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures2.pNext = &vulkan12Features;
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+	bool bindlessSupported{ deviceFeatures.shaderSampledImageArrayDynamicIndexing
+		&& vulkan12Features.descriptorBindingPartiallyBound
+		&& vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+		&& vulkan12Features.runtimeDescriptorArray
+		&& vulkan12Features.descriptorBindingUpdateUnusedWhilePending };
+	bool timelineSupported{ vulkan12Features.timelineSemaphore == VK_TRUE };
 	
 	QueueFamilyIndices indices{ getQueueFamilies(device) };
 
@@ -1664,7 +2086,7 @@ bool VulkanRenderer::checkDeviceSuitable(const VkPhysicalDevice &device) {
 	SwapchainDetails swapChainDetails{ getSwapChainDetails(device) };
 	bool swapChainValid{ !swapChainDetails.presentationModes.empty() && !swapChainDetails.formats.empty() };
 
-	return indices.isValid() && extensionsSupported && swapChainValid && deviceFeatures.samplerAnisotropy;
+	return indices.isValid() && extensionsSupported && swapChainValid && deviceFeatures.samplerAnisotropy && bindlessSupported && timelineSupported;
 }
 
 bool VulkanRenderer::checkValidationLayerSupport() {
@@ -1725,6 +2147,15 @@ QueueFamilyIndices VulkanRenderer::getQueueFamilies(const VkPhysicalDevice &devi
 		i++;
 	}
 
+	// Async compute wants a family without graphics, so it actually runs alongside the graphics queue.
+	for (size_t family{ 0 }; family < queueFamilyProps.size(); family++) {
+		if (queueFamilyProps[family].queueCount > 0 && (queueFamilyProps[family].queueFlags & VK_QUEUE_COMPUTE_BIT)
+			&& !(queueFamilyProps[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+			indices.computeFamily = static_cast<int>(family);
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -1806,6 +2237,11 @@ VkExtent2D VulkanRenderer::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &surf
 	}
 }
 
+VkExtent2D VulkanRenderer::getRenderExtent() {
+	// Part of the swapchain extent with dynamic resolution.
+	return _dynamicResolutionEnabled ? _dynamicResolution.getRenderExtent(_swapchainExtent) : _swapchainExtent;
+}
+
 VkFormat VulkanRenderer::chooseSupportedFormat(const vector<VkFormat> &formats, const VkImageTiling &tiling, const VkFormatFeatureFlags &featureFlags) {
 	// Loop through options to find compatible format.
 	for (const auto &format : formats) {
@@ -1826,119 +2262,473 @@ VkFormat VulkanRenderer::chooseSupportedFormat(const vector<VkFormat> &formats,
 	throw std::runtime_error("Failed to find a matching format.");
 }
 
-stbi_uc *VulkanRenderer::loadTextureFile(const string &fileName, int *width, int *height, VkDeviceSize *imageSize) {
-	// Number of channels image uses.
-	int channels{ 0 };
-	const int pixelChannels = 4;
-
-	// Load pixel data for image.
-	const string fileLoc{ "Textures/" + fileName };
-	stbi_uc *image{ 
-		stbi_load(fileLoc.c_str(), width, height, &channels, STBI_rgb_alpha) 
-	};
-
-	if (!image) {
-		throw std::runtime_error("Failed to load texture file=" + fileLoc);
+TextureDecoder::Image VulkanRenderer::loadTextureFile(const string &fileName, uint32_t maxSize) {
+	// Decoded into the staging buffer while there's room, the upload copies straight from there.
+	void *staged{ nullptr };
+	const TextureDecoder::DestinationFunc destination{ [this, &staged](VkDeviceSize size) {
+		staged = _textureStaging->allocate(size);
+		return staged;
+	} };
+	try {
+		// The offline encoder's block compressed version, if there is one in a format the device can sample.
+		if (!_compressedFormats.empty()) {
+			const string ktxFile{ "Textures/" + fileName.substr(0, fileName.find_last_of('.')) + ".ktx2" };
+			TextureDecoder::Image image{};
+			if (ifstream(ktxFile).good() && TextureDecoder::loadKtx2(ktxFile, _compressedFormats, destination, &image, maxSize)) {
+				return image;
+			}
+		}
+		return TextureDecoder::decodeFile("Textures/" + fileName, destination, maxSize);
+	} catch (...) {
+		if (staged) {
+			_textureStaging->release(staged);
+		}
+		throw;
 	}
-
-	// Calculate image size using given and known data.
-	// w * h * 4
-	// Each pixel has 4 channels.
-	*imageSize = *width * *height * pixelChannels;
-
-	return image;
 }
 
-int VulkanRenderer::createTextureImage(const string &fileName) {
-	int width, height;
-	VkDeviceSize imageSize;
-	stbi_uc *imageData{ 
-		loadTextureFile(fileName, &width, &height, &imageSize) 
-	};
+void VulkanRenderer::freeTexturePixels(stbi_uc *pixels) {
+	// Staged pixels give their space back, the rest came from stb's heap.
+	if (_textureStaging->owns(pixels)) {
+		_textureStaging->release(pixels);
+	}
+	else {
+		stbi_image_free(pixels);
+	}
+}
 
-	// Create staging buffer to hold loaded data, ready to copy to device.
-	VkBuffer imageStagingBuf;
-	VkDeviceMemory imageStagingBufMem;
-
-	createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, imageSize,
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		&imageStagingBuf,
-		&imageStagingBufMem);
-
-	// Copy image data to staging buf.
-	void *data;
-	vkMapMemory(_mainDevice.logicalDevice, imageStagingBufMem, 0,
-		imageSize,
-		0,
-		&data);
-	memcpy(data, imageData, static_cast<size_t>(imageSize));
-	vkUnmapMemory(_mainDevice.logicalDevice, imageStagingBufMem);
-
-	// Free original image data.
-	stbi_image_free(imageData);
-
-	// Create image to hold final texture.
+VkImage VulkanRenderer::createTextureImage(const TextureDecoder::Image &image, VkDeviceMemory *imageMemory, uint32_t *mipLevels) {
+	// Create image to hold final texture, with a full mip chain. Decoded images get theirs made here, compressed
+	// ones come with their mips, as many as were stored. A transfer source for the blits and for streaming.
+	const bool generateMips{ image.format == VK_FORMAT_R8G8B8A8_UNORM && image.levels.size() == 1 };
+	*mipLevels = generateMips ? getMipLevelCount(image.width, image.height) : static_cast<uint32_t>(image.levels.size());
 	VkDeviceMemory texImgMem;
 	VkImage texImg{
-		createImage(width, height,
-		VK_FORMAT_R8G8B8A8_UNORM,
+		createImage(image.width, image.height, *mipLevels,
+		image.format,
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		&texImgMem)
 	};
 
-	// Copy data to image.
-	// Transition image to be DST for copy operation.
-	transitionImageLayout(_mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool, texImg,
-		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	// Rest of the chain on the GPU when the format can be blitted with a linear filter. Otherwise it's box filtered
+	// on the CPU now and copied up with the base level.
+	VkFormatProperties formatProps{};
+	vkGetPhysicalDeviceFormatProperties(_mainDevice.physicalDevice, image.format, &formatProps);
+	const bool blitMips{ generateMips && (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) };
+	vector<TextureDecoder::Level> levels{ image.levels };
+	vector<uint8_t> chain;
+	if (generateMips && !blitMips) {
+		chain = buildMipChain(image.pixels, image.width, image.height, *mipLevels);
+		// Levels are packed in order after the base, same halving as buildMipChain.
+		VkDeviceSize offset{ image.size };
+		uint32_t width{ static_cast<uint32_t>(image.width) };
+		uint32_t height{ static_cast<uint32_t>(image.height) };
+		for (uint32_t level{ 1 }; level < *mipLevels; level++) {
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			levels.push_back({ offset, width, height });
+			offset += static_cast<VkDeviceSize>(width) * height * 4;
+		}
+	}
+
+	// Pixels are copied from the staging buffer when they're in it. The rest, and CPU made mips, go through a
+	// buffer of their own.
+	VkBuffer srcBuf{ _textureStaging->getBuffer() };
+	VkDeviceSize srcOffset{ 0 };
+	VkBuffer imageStagingBuf{ VK_NULL_HANDLE };
+	VkDeviceMemory imageStagingBufMem{ VK_NULL_HANDLE };
+	stbi_uc *stagedPixels{ nullptr };
+	if (_textureStaging->owns(image.pixels) && chain.empty()) {
+		srcOffset = _textureStaging->getOffset(image.pixels);
+		stagedPixels = image.pixels;
+	}
+	else {
+		const VkDeviceSize bufSize{ image.size + chain.size() };
+		createBuffer(_mainDevice.physicalDevice, _mainDevice.logicalDevice, bufSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&imageStagingBuf,
+			&imageStagingBufMem);
+
+		// Copy image data to staging buf.
+		void *data;
+		vkMapMemory(_mainDevice.logicalDevice, imageStagingBufMem, 0,
+			bufSize,
+			0,
+			&data);
+		memcpy(data, image.pixels, static_cast<size_t>(image.size));
+		if (!chain.empty()) {
+			memcpy(static_cast<uint8_t *>(data) + image.size, chain.data(), chain.size());
+		}
+		vkUnmapMemory(_mainDevice.logicalDevice, imageStagingBufMem);
+		srcBuf = imageStagingBuf;
+		freeTexturePixels(image.pixels);
+	}
+
+	// Queued, copied over as many frames as the upload budget takes. Block compressed levels go by rows of blocks.
+	vector<UploadScheduler::Step> steps;
+	const uint32_t levelCount{ *mipLevels };
+	steps.push_back({ 0, [texImg, levelCount](VkCommandBuffer commandBuffer) {
+		recordTransitionImageLayout(commandBuffer, texImg, levelCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	} });
+	const VkDeviceSize blockBytes{ Ktx2::getBlockSize(image.format) };
+	for (size_t level{ 0 }; level < levels.size(); level++) {
+		UploadScheduler::addImageCopy(steps, srcBuf, srcOffset + levels[level].offset, texImg, static_cast<uint32_t>(level),
+			levels[level].width, levels[level].height, blockBytes > 0 ? blockBytes : 4, blockBytes > 0 ? 4 : 1);
+	}
+	const uint32_t width{ static_cast<uint32_t>(image.width) };
+	const uint32_t height{ static_cast<uint32_t>(image.height) };
+	steps.push_back({ 0, [texImg, width, height, levelCount, blitMips](VkCommandBuffer commandBuffer) {
+		if (blitMips) {
+			recordGenerateMipmaps(commandBuffer, texImg, width, height, levelCount);
+		}
+		else {
+			recordTransitionImageLayout(commandBuffer, texImg, levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		}
+	} });
+
+	// Copies have landed, the pixels can go.
+	VkDevice device{ _mainDevice.logicalDevice };
+	_uploadScheduler.enqueue(steps, [this, device, stagedPixels, imageStagingBuf, imageStagingBufMem]() {
+		if (stagedPixels) {
+			freeTexturePixels(stagedPixels);
+		}
+		if (imageStagingBuf != VK_NULL_HANDLE) {
+			vkDestroyBuffer(device, imageStagingBuf, nullptr);
+			vkFreeMemory(device, imageStagingBufMem, nullptr);
+		}
+	});
+
+	*imageMemory = texImgMem;
+	return texImg;
+}
+
+TextureHandle VulkanRenderer::createTexture(const string &fileName) {
+	return createTextures({ fileName })[0];
+}
+
+vector<TextureHandle> VulkanRenderer::createTextures(const vector<string> &fileNames) {
+	// Path first, it saves decoding. A file named more than once is decoded once.
+	std::unordered_map<string, TextureHandle> byPath;
+	vector<string> decodeNames;
+	vector<string> decodePaths;
+	for (const auto &fileName : fileNames) {
+		const string path{ normalizeAssetPath(fileName) };
+		if (byPath.count(path)) {
+			continue;
+		}
+		byPath[path] = _textureCache.find(path);
+		if (!_textureCache.contains(byPath[path])) {
+			decodeNames.push_back(fileName);
+			decodePaths.push_back(path);
+		}
+	}
+
+	// Decoding is most of the load time, it all happens on the workers. Uploads and descriptor writes stay on
+	// this thread and start as soon as each image is ready. Only the small levels are loaded, the streamer brings
+	// in finer ones once something using the texture is drawn.
+	const bool contentHashing{ _textureCache.isContentHashing() };
+	vector<TextureDecoder::Image> decoded(decodeNames.size());
+	vector<uint64_t> contentHashes(decodeNames.size(), 0);
+	vector<bool> handed(decodeNames.size(), false); // Pixels given to addTexture, which owns them from then on.
+	vector<TextureHandle> added;
+	try {
+		_threadPool->parallelFor(static_cast<uint32_t>(decodeNames.size()),
+			[&](uint32_t index, uint32_t worker) {
+				if (contentHashing) {
+					MappedFile file{ "Textures/" + decodeNames[index] };
+					contentHashes[index] = hashBytes(file.getData(), file.getSize());
+				}
+				decoded[index] = loadTextureFile(decodeNames[index], TEXTURE_STREAMING_BASE_SIZE);
+			},
+			[&](uint32_t index) {
+				handed[index] = true;
+				byPath[decodePaths[index]] = addTexture(decodePaths[index], decodeNames[index], contentHashes[index], decoded[index]);
+				added.push_back(byPath[decodePaths[index]]);
+			});
+	} catch (...) {
+		// Decodes no handler took still hold their pixels, staged ones would hold back the staging ring. Textures
+		// added so far have no references yet, nothing else would release them.
+		for (size_t i{ 0 }; i < decoded.size(); i++) {
+			if (!handed[i] && decoded[i].pixels) {
+				freeTexturePixels(decoded[i].pixels);
+			}
+		}
+		for (const auto &texture : added) {
+			// Once per texture, a content hit can return one added earlier in this call.
+			if (_textureCache.contains(texture)) {
+				_textureCache.acquire(texture);
+				releaseTexture(texture);
+			}
+		}
+		throw;
+	}
+
+	vector<TextureHandle> textures;
+	for (const auto &fileName : fileNames) {
+		TextureHandle texture{ byPath[normalizeAssetPath(fileName)] };
+		_textureCache.acquire(texture);
+		textures.push_back(texture);
+	}
+	return textures;
+}
 
-	copyImageBuffer(_mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool,
-		imageStagingBuf, texImg, width, height);
+TextureHandle VulkanRenderer::addTexture(const string &path, const string &fileName, uint64_t contentHash,
+	const TextureDecoder::Image &image) {
+	// Same file under another name.
+	if (_textureCache.isContentHashing()) {
+		TextureHandle texture{ _textureCache.findByContent(contentHash) };
+		if (_textureCache.contains(texture)) {
+			freeTexturePixels(image.pixels);
+			_textureCache.addPath(texture, path);
+			return texture;
+		}
+	}
 
-	transitionImageLayout(_mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool, texImg,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	const Texture texture{ uploadTexture(image) };
+	const TextureHandle handle{ _textureCache.add(path, contentHash, texture) };
+	if (_elementTextures.size() <= static_cast<size_t>(texture.arrayElement)) {
+		_elementTextures.resize(texture.arrayElement + 1);
+	}
+	_elementTextures[texture.arrayElement] = handle;
+	_textureStreamer.add(handle, fileName, texture.format, image.fullWidth, image.fullHeight,
+		texture.baseLevel + texture.mipLevels, texture.baseLevel);
+	return handle;
+}
+
+Texture VulkanRenderer::uploadTexture(const TextureDecoder::Image &image) {
+	// Create texture image.
+	VkDeviceMemory texImgMem;
+	uint32_t mipLevels;
+	VkImage texImg{ createTextureImage(image, &texImgMem, &mipLevels) };
 
-	// Add texture data to vector for reference.
-	_textureImages.push_back(texImg);
-	_textureImageMems.push_back(texImgMem);
+	// Create image view.
+	VkImageView imageView{ createImageView(texImg, image.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels) };
 
-	vkDestroyBuffer(_mainDevice.logicalDevice, imageStagingBuf, nullptr);
-	vkFreeMemory(_mainDevice.logicalDevice, imageStagingBufMem, nullptr);
+	const int arrayElement{ allocateTextureElement() };
+	createTextureDescriptor(arrayElement, imageView);
 
-	// Return index of new texture image.
-	return _textureImages.size() - 1;
+	return { texImg, texImgMem, imageView, arrayElement, image.format,
+		static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height), image.baseLevel, mipLevels };
 }
 
-int VulkanRenderer::createTexture(const string &fileName) {
-	// Create texture image and get its location in array.
-	int texImageLoc{ createTextureImage(fileName) };
+bool VulkanRenderer::hasFreeTextureElement() {
+	return !_freeTextureElements.empty() || _textureElementCount < _maxTextures;
+}
 
-	// Create image view and add to list.
-	VkImageView imageView{ createImageView(_textureImages[texImageLoc], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT) };
-	_textureImageViews.push_back(imageView);
+int VulkanRenderer::allocateTextureElement() {
+	// Released elements only come back once nothing in flight uses them, so they can be rewritten.
+	if (!_freeTextureElements.empty()) {
+		const int arrayElement{ _freeTextureElements.back() };
+		_freeTextureElements.pop_back();
+		return arrayElement;
+	}
+	if (_textureElementCount >= _maxTextures) {
+		throw std::runtime_error("Texture array is full, max textures=" + std::to_string(_maxTextures));
+	}
+	return static_cast<int>(_textureElementCount++);
+}
 
-	int descLoc{ createTextureDescriptor(imageView) };
+void VulkanRenderer::releaseTexture(const TextureHandle &texture) {
+	// Other materials may still use it.
+	if (!_textureCache.release(texture)) {
+		return;
+	}
+	// A load still running for it is thrown away when it comes back.
+	_textureStreamer.remove(texture);
+	destroyTexture(_textureCache.remove(texture));
+}
 
-	// Return location of set with texture.
-	return descLoc;
+void VulkanRenderer::destroyTexture(const Texture &texture) {
+	// Element goes back on the free list with the objects, once the frames drawing with it are done.
+	deferDestroy([this, texture]() {
+		vkDestroyImageView(_mainDevice.logicalDevice, texture.view, nullptr);
+		vkDestroyImage(_mainDevice.logicalDevice, texture.image, nullptr);
+		vkFreeMemory(_mainDevice.logicalDevice, texture.memory, nullptr);
+		_freeTextureElements.push_back(texture.arrayElement);
+	});
 }
 
-int VulkanRenderer::createTextureDescriptor(VkImageView textureImage) {
-	VkDescriptorSet descSet;
-	
-	// Descriptor set Alloc info.
-	VkDescriptorSetAllocateInfo setAllocInfo{};
-	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	setAllocInfo.descriptorPool = _samplerDescPool;
-	setAllocInfo.descriptorSetCount = 1;
-	setAllocInfo.pSetLayouts = &_samplerSetLayout;
-	
-	if (vkAllocateDescriptorSets(_mainDevice.logicalDevice, &setAllocInfo, &descSet) != VK_SUCCESS) {
-		throw std::runtime_error("Failed to allocate texture descriptor sets.");
+void VulkanRenderer::updateTextureStreaming() {
+	_frameNumber++;
+
+	// How many pixels across each texture is drawn this frame, from the bounds of the meshes using it. Textures
+	// of meshes entirely behind the camera don't count as used.
+	const float pixelsPerUnit{ std::abs(_uboViewProj.proj[1][1]) * 0.5f * static_cast<float>(_swapchainExtent.height) };
+	for (const auto &draw : _drawList) {
+		const glm::mat4 &model{ _models[draw.model].model };
+		Mesh *mesh{ _modelCache.get(_models[draw.model].asset).getMesh(draw.mesh) };
+		const glm::vec3 center{ _uboViewProj.view * model * glm::vec4(mesh->getBoundsCenter(), 1.0f) };
+		const float scale{ max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))) };
+		const float radius{ mesh->getBoundsRadius() * scale };
+		if (center.z > radius) {
+			continue;
+		}
+		const float screenSize{ 2.0f * radius * pixelsPerUnit / max(glm::length(center), radius) };
+		_textureStreamer.markUsed(_elementTextures[mesh->getTexId()], screenSize, _frameNumber);
 	}
 
+	// Uploaded levels replace what's resident once they've landed. Ones for textures released since are dropped.
+	size_t keptSwaps{ 0 };
+	for (size_t i{ 0 }; i < _pendingSwaps.size(); i++) {
+		const PendingSwap &swap{ _pendingSwaps[i] };
+		if (!_uploadScheduler.isComplete(swap.uploadBatch)) {
+			_pendingSwaps[keptSwaps++] = swap;
+		}
+		else if (_textureStreamer.contains(swap.texture)) {
+			swapTexture(swap.texture, swap.newTexture);
+		}
+		else {
+			destroyTexture(swap.newTexture);
+		}
+	}
+	_pendingSwaps.resize(keptSwaps);
+
+	// Finished loads are queued for upload. Ones for released textures, failed ones, and ones there's no free
+	// array element for yet are dropped, they're asked for again if still wanted.
+	for (const auto &loaded : _textureStreamer.takeLoaded()) {
+		_streamingLoads--;
+		const bool streamed{ _textureStreamer.contains(loaded.texture) };
+		if (streamed && loaded.image.pixels && hasFreeTextureElement()) {
+			const Texture newTexture{ uploadTexture(loaded.image) };
+			_pendingSwaps.push_back({ _uploadScheduler.getLastBatch(), loaded.texture, newTexture });
+			continue;
+		}
+		if (loaded.image.pixels) {
+			freeTexturePixels(loaded.image.pixels);
+		}
+		if (streamed) {
+			_textureStreamer.setResident(loaded.texture, _textureCache.get(loaded.texture).baseLevel);
+		}
+	}
+
+	// Room is made first, then the most visible textures still short of levels get loads started.
+	for (const auto &request : _textureStreamer.getEvictions(_frameNumber)) {
+		const Texture texture{ _textureCache.get(request.texture) };
+		if (hasFreeTextureElement()) {
+			const Texture newTexture{ shrinkTexture(texture, request.baseLevel) };
+			_pendingSwaps.push_back({ _uploadScheduler.getLastBatch(), request.texture, newTexture });
+		}
+		else {
+			_textureStreamer.setResident(request.texture, texture.baseLevel);
+		}
+	}
+
+	// Whatever model load jobs left of the background share.
+	const uint32_t running{ _streamingLoads + _runningLoadJobs };
+	const uint32_t maxLoads{ getMaxBackgroundLoads() };
+	if (running < maxLoads) {
+		for (const auto &request : _textureStreamer.getStreamIns(_frameNumber, maxLoads - running)) {
+			streamTexture(request);
+		}
+	}
+}
+
+uint32_t VulkanRenderer::getMaxBackgroundLoads() {
+	// Half the workers at most, the rest are left for recording.
+	return max(_threadPool->getThreadCount() / 2, 1u);
+}
+
+void VulkanRenderer::streamTexture(const TextureStreamer::Request &request) {
+	// The level wanted is the first that fits in this size, same as the initial load picks its first one.
+	const TextureHandle texture{ request.texture };
+	const string fileName{ _textureStreamer.getFileName(texture) };
+	const uint32_t maxSize{ max(_textureStreamer.getSize(texture) >> request.baseLevel, 1u) };
+	_streamingLoads++;
+	_threadPool->submitBackground([this, texture, fileName, maxSize](uint32_t worker) {
+		TextureStreamer::Loaded loaded{ texture, {} };
+		try {
+			loaded.image = loadTextureFile(fileName, maxSize);
+		} catch (const std::exception &e) {
+			printf("ERROR: Streaming texture %s: %s\n", fileName.c_str(), e.what());
+			loaded.image.pixels = nullptr;
+		}
+		_textureStreamer.pushLoaded(loaded);
+	});
+}
+
+Texture VulkanRenderer::shrinkTexture(const Texture &texture, uint32_t baseLevel) {
+	const uint32_t dropped{ baseLevel - texture.baseLevel };
+	const uint32_t width{ max(texture.width >> dropped, 1u) };
+	const uint32_t height{ max(texture.height >> dropped, 1u) };
+	const uint32_t mipLevels{ texture.mipLevels - dropped };
+
+	VkDeviceMemory memory;
+	VkImage image{ createImage(width, height, mipLevels, texture.format, VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memory) };
+	// Queued like an upload, counted at the size it copies. The source stays sampled until the swap.
+	const VkImage srcImage{ texture.image };
+	UploadScheduler::Step step{};
+	step.bytes = TextureStreamer::getLevelsSize(texture.format, width, height, 0, mipLevels);
+	step.record = [srcImage, dropped, image, width, height, mipLevels](VkCommandBuffer commandBuffer) {
+		recordCopyImageLevels(commandBuffer, srcImage, dropped, image, width, height, mipLevels);
+	};
+	_uploadScheduler.enqueue({ step }, {});
+
+	VkImageView view{ createImageView(image, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels) };
+	const int arrayElement{ allocateTextureElement() };
+	createTextureDescriptor(arrayElement, view);
+
+	return { image, memory, view, arrayElement, texture.format, width, height, baseLevel, mipLevels };
+}
+
+void VulkanRenderer::swapTexture(const TextureHandle &texture, const Texture &newTexture) {
+	Texture &current{ _textureCache.get(texture) };
+	const Texture old{ current };
+	current = newTexture;
+
+	// Meshes move over to the new element. Frames in flight keep the old one until they're done, recorded
+	// commands have it baked in so they're recorded again.
+	for (auto &asset : _modelCache.getAssets()) {
+		for (size_t meshIdx{ 0 }; meshIdx < asset.meshModel.getMeshCount(); meshIdx++) {
+			Mesh *mesh{ asset.meshModel.getMesh(meshIdx) };
+			if (mesh->getTexId() == old.arrayElement) {
+				mesh->setTexId(newTexture.arrayElement);
+			}
+		}
+	}
+	if (_elementTextures.size() <= static_cast<size_t>(newTexture.arrayElement)) {
+		_elementTextures.resize(newTexture.arrayElement + 1);
+	}
+	_elementTextures[newTexture.arrayElement] = texture;
+
+	_textureStreamer.setResident(texture, newTexture.baseLevel);
+	destroyTexture(old);
+	invalidateCommands();
+}
+
+void VulkanRenderer::submitUploads() {
+	// This frame's buffer was last submitted ahead of the frame waited on in draw, so it's free to record again.
+	VkCommandBuffer commandBuffer{ _uploadCommandBuffers[_currentFrame] };
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to begin upload command buffer.");
+	}
+	const bool recorded{ _uploadScheduler.record(commandBuffer, _uploadBudget) };
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to end upload command buffer.");
+	}
+	if (recorded) {
+		_uploadScheduler.submitted(_scheduler.submit(TimelineScheduler::Queue::Graphics, commandBuffer, {}));
+	}
+}
+
+void VulkanRenderer::deferDestroy(std::function<void()> destroyFunc) {
+	// With uploads queued it goes as a batch of its own after them. Uploads are submitted on the graphics queue
+	// after the frames already in flight, so that covers those too.
+	if (!_uploadScheduler.isIdle()) {
+		_uploadScheduler.enqueue({}, destroyFunc);
+		return;
+	}
+	_deletionQueue.push(_scheduler.getLastSubmitted(TimelineScheduler::Queue::Graphics), destroyFunc);
+}
+
+void VulkanRenderer::createTextureDescriptor(const int &texId, VkImageView textureImage) {
 	// Texture image info.
 	VkDescriptorImageInfo imageInfo{};
 	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // Image layout when in use.
@@ -1947,61 +2737,467 @@ int VulkanRenderer::createTextureDescriptor(VkImageView textureImage) {
 
 	VkWriteDescriptorSet descWrite{};
 	descWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descWrite.dstSet = descSet;
+	descWrite.dstSet = _textureDescSet;
 	descWrite.dstBinding = 0;
-	descWrite.dstArrayElement = 0;
+	descWrite.dstArrayElement = static_cast<uint32_t>(texId);
 	descWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	descWrite.descriptorCount = 1;
 	descWrite.pImageInfo = &imageInfo;
 
-	// update new descriptor set
+	// Update after bind, so this is fine while earlier frames using the set are still in flight.
+	// Stays a plain write, a template would fix the array element.
 	vkUpdateDescriptorSets(_mainDevice.logicalDevice, 1, &descWrite, 0, nullptr);
+}
+
+ModelHandle VulkanRenderer::createMeshModel(string modelFile, const ModelImportOptions &options) {
+	// Already loaded under this path, or the same file under another, only needs a new instance.
+	const string path{ normalizeAssetPath(modelFile) };
+	AssetHandle asset{ _modelCache.find(path) };
+	if (!_modelCache.contains(asset)) {
+		const vector<char> fileData{ readFile(modelFile) };
+		const uint64_t contentHash{ hashBytes(fileData.data(), fileData.size()) };
+		asset = _modelCache.findByContent(contentHash);
+		if (_modelCache.contains(asset)) {
+			_modelCache.addPath(asset, path);
+		}
+		else {
+			ModelImport modelImport{ importModel(modelFile, options, getLoadedTexturePaths(), _threadPool.get()) };
+			asset = _modelCache.add(path, contentHash, createModel(modelFile, modelImport));
+		}
+	}
+
+	return addModelInstance(asset);
+}
+
+ModelLoad VulkanRenderer::createMeshModelAsync(string modelFile, const ModelImportOptions &options) {
+	std::shared_ptr<ModelLoadState> state{ std::make_shared<ModelLoadState>() };
+	state->modelFile = modelFile;
+	state->options = options;
+	_modelLoads.push_back(state);
+
+	// Already loaded under this path only needs a new instance, it's done once that can be drawn.
+	const AssetHandle asset{ _modelCache.find(normalizeAssetPath(modelFile)) };
+	if (_modelCache.contains(asset)) {
+		state->model = addModelInstance(asset);
+		state->stage = ModelLoadState::Stage::Uploading;
+		return ModelLoad{ state };
+	}
+
+	// Reading and importing the file is one job, which then queues one per texture to decode. They're started
+	// alongside streaming loads under the same limit, see startModelLoadJobs. Textures already loaded now aren't
+	// decoded again.
+	const std::set<string> loadedTextures{ getLoadedTexturePaths() };
+	const bool contentHashing{ _textureCache.isContentHashing() };
+	queueModelLoadJob([this, state, loadedTextures, contentHashing]() {
+		try {
+			if (!state->cancelRequested) {
+				const vector<char> fileData{ readFile(state->modelFile) };
+				state->contentHash = hashBytes(fileData.data(), fileData.size());
+				state->modelImport = importModel(state->modelFile, state->options, loadedTextures, nullptr);
+			}
+		} catch (const std::exception &e) {
+			std::lock_guard<std::mutex> lock(state->errorMutex);
+			state->error = e.what();
+		}
+
+		std::set<string> decodeNames;
+		for (const auto &textureName : state->modelImport.textureNames) {
+			if (!textureName.empty() && !state->modelImport.atlasPlacements.count(textureName)
+				&& !loadedTextures.count(normalizeAssetPath(textureName))) {
+				decodeNames.insert(textureName);
+			}
+		}
+		for (const auto &textureName : decodeNames) {
+			state->modelImport.textures.push_back({ textureName, 0, {} });
+		}
 
-	// Add descriptor set to list.
-	_samplerDescSets.push_back(descSet);
+		state->pendingJobs += static_cast<uint32_t>(decodeNames.size());
+		for (size_t i{ 0 }; i < decodeNames.size(); i++) {
+			queueModelLoadJob([this, state, i, contentHashing]() {
+				ModelImport::DecodedTexture &texture{ state->modelImport.textures[i] };
+				try {
+					if (!state->cancelRequested) {
+						if (contentHashing) {
+							MappedFile file{ "Textures/" + texture.fileName };
+							texture.contentHash = hashBytes(file.getData(), file.getSize());
+						}
+						texture.image = loadTextureFile(texture.fileName, TEXTURE_STREAMING_BASE_SIZE);
+					}
+				} catch (const std::exception &e) {
+					std::lock_guard<std::mutex> lock(state->errorMutex);
+					state->error = e.what();
+				}
+				finishModelLoadJob(state);
+			});
+		}
+		finishModelLoadJob(state);
+	});
+
+	return ModelLoad{ state };
+}
+
+void VulkanRenderer::queueModelLoadJob(const std::function<void()> &job) {
+	std::lock_guard<std::mutex> lock(_modelLoadMutex);
+	_queuedLoadJobs.push_back(job);
+}
+
+void VulkanRenderer::startModelLoadJobs() {
+	// Ahead of streaming, which takes what's left. A job can't be cut short, so a worker running one is lost to
+	// recording until it's done.
+	const uint32_t maxLoads{ getMaxBackgroundLoads() };
+	std::lock_guard<std::mutex> lock(_modelLoadMutex);
+	while (!_queuedLoadJobs.empty() && _streamingLoads + _runningLoadJobs < maxLoads) {
+		const std::function<void()> job{ _queuedLoadJobs.front() };
+		_queuedLoadJobs.pop_front();
+		_runningLoadJobs++;
+		_threadPool->submitBackground([this, job](uint32_t worker) {
+			job();
+			_runningLoadJobs--;
+		});
+	}
+}
+
+void VulkanRenderer::finishModelLoadJob(const std::shared_ptr<ModelLoadState> &state) {
+	if (--state->pendingJobs == 0) {
+		std::lock_guard<std::mutex> lock(_modelLoadMutex);
+		_importedModels.push_back(state);
+	}
+}
+
+void VulkanRenderer::updateModelLoads() {
+	startModelLoadJobs();
+
+	// Imports the workers handed back are created here, their copies queue behind everything else's.
+	vector<std::shared_ptr<ModelLoadState>> imported;
+	{
+		std::lock_guard<std::mutex> lock(_modelLoadMutex);
+		imported.swap(_importedModels);
+	}
+	for (const auto &state : imported) {
+		if (state->cancelRequested) {
+			state->stage = ModelLoadState::Stage::Cancelled;
+		}
+		else if (!state->error.empty()) {
+			state->stage = ModelLoadState::Stage::Failed;
+		}
+		else {
+			try {
+				// Another load may have brought in the same file meanwhile.
+				const string path{ normalizeAssetPath(state->modelFile) };
+				AssetHandle asset{ _modelCache.find(path) };
+				if (!_modelCache.contains(asset)) {
+					asset = _modelCache.findByContent(state->contentHash);
+					if (_modelCache.contains(asset)) {
+						_modelCache.addPath(asset, path);
+					}
+					else {
+						asset = _modelCache.add(path, state->contentHash, createModel(state->modelFile, state->modelImport));
+					}
+				}
+				state->model = addModelInstance(asset);
+				state->stage = ModelLoadState::Stage::Uploading;
+			} catch (const std::exception &e) {
+				std::lock_guard<std::mutex> lock(state->errorMutex);
+				state->error = e.what();
+				state->stage = ModelLoadState::Stage::Failed;
+			}
+		}
+		freeModelImport(state->modelImport);
+	}
 
-	return _samplerDescSets.size() - 1;
+	// Loads are done once their model can be drawn. Cancelled ones take their instance back out.
+	vector<std::shared_ptr<ModelLoadState>> finished;
+	size_t keptLoads{ 0 };
+	for (size_t i{ 0 }; i < _modelLoads.size(); i++) {
+		const std::shared_ptr<ModelLoadState> state{ _modelLoads[i] };
+		if (state->stage == ModelLoadState::Stage::Uploading) {
+			if (!_models.contains(state->model)) {
+				state->stage = ModelLoadState::Stage::Cancelled; // Destroyed by the caller already.
+			}
+			else if (state->cancelRequested) {
+				destroyMeshModel(state->model);
+				state->stage = ModelLoadState::Stage::Cancelled;
+			}
+			else if (_uploadScheduler.isComplete(_modelCache.get(_models.at(state->model).asset).getUploadBatch())) {
+				state->stage = ModelLoadState::Stage::Done;
+			}
+		}
+		if (state->stage == ModelLoadState::Stage::Importing || state->stage == ModelLoadState::Stage::Uploading) {
+			_modelLoads[keptLoads++] = state;
+		}
+		else {
+			finished.push_back(state);
+		}
+	}
+	_modelLoads.resize(keptLoads);
+
+	// Resumed last, they may well start more loads.
+	for (const auto &state : finished) {
+		if (state->continuation) {
+			std::coroutine_handle<> continuation{ state->continuation };
+			state->continuation = nullptr;
+			continuation.resume();
+		}
+	}
+}
+
+ModelHandle VulkanRenderer::addModelInstance(AssetHandle asset) {
+	_modelCache.acquire(asset);
+	ModelHandle model{ _models.insert({ asset, glm::mat4(1.0f) }) };
+
+	rebuildDrawList();
+	invalidateCommands();
+
+	return model;
 }
 
-int VulkanRenderer::createMeshModel(string modelFile) {
+std::set<string> VulkanRenderer::getLoadedTexturePaths() {
+	std::set<string> paths;
+	for (const auto &asset : _textureCache.getAssets()) {
+		paths.insert(asset.paths.begin(), asset.paths.end());
+	}
+	return paths;
+}
+
+ModelImport VulkanRenderer::importModel(const string &modelFile, const ModelImportOptions &options,
+	const std::set<string> &loadedTextures, ThreadPool *pool) {
 	// Import model scene.
 	Assimp::Importer importer;
 	const aiScene *scene{ 
 		importer.ReadFile(modelFile, 
-		aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices) 
+		aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals) 
 	};
 	if (!scene) {
 		throw std::runtime_error("Failed to load model scene=" + modelFile);
 	}
 
 	// Get vector of all mats with 1:1 ID placement.
-	vector<string> textureNames{ MeshModel::LoadMaterials(scene) };
+	ModelImport modelImport{};
+	modelImport.textureNames = MeshModel::LoadMaterials(scene);
+	if (options.atlasTextures) {
+		packTextureAtlas(modelImport, scene, loadedTextures, pool);
+	}
+
+	// Load in all our meshes.
+	modelImport.meshes = MeshModel::LoadNode(scene->mRootNode, scene);
+	return modelImport;
+}
+
+void VulkanRenderer::packTextureAtlas(ModelImport &modelImport, const aiScene *scene, const std::set<string> &loadedTextures,
+	ThreadPool *pool) {
+	// A texture is only packed when no material using it tiles, the atlas can't repeat it.
+	const vector<string> &textureNames{ modelImport.textureNames };
+	const vector<bool> tiled{ MeshModel::FindTiledMaterials(scene) };
+	std::set<string> tiledNames;
+	for (size_t i{ 0 }; i < textureNames.size(); i++) {
+		if (tiled[i]) {
+			tiledNames.insert(textureNames[i]);
+		}
+	}
+
+	// Already loaded ones are shared as they are, and ones with a compressed version stay compressed.
+	vector<string> candidates;
+	std::set<string> candidateNames;
+	for (const auto &textureName : textureNames) {
+		if (textureName.empty() || tiledNames.count(textureName) || candidateNames.count(textureName)
+			|| loadedTextures.count(normalizeAssetPath(textureName))) {
+			continue;
+		}
+		const string ktxFile{ "Textures/" + textureName.substr(0, textureName.find_last_of('.')) + ".ktx2" };
+		if (!_compressedFormats.empty() && ifstream(ktxFile).good()) {
+			continue;
+		}
+		candidateNames.insert(textureName);
+		candidates.push_back(textureName);
+	}
+
+	// The small ones are decoded whole, on the heap. Bigger ones are left to load on their own.
+	vector<TextureDecoder::Image> images(candidates.size());
+	const ThreadPool::IndexedJob decode{ [&](uint32_t index, uint32_t worker) {
+		const string filePath{ "Textures/" + candidates[index] };
+		uint32_t width, height;
+		if (TextureDecoder::getSize(filePath, &width, &height)
+			&& width <= ATLAS_MAX_TEXTURE_SIZE && height <= ATLAS_MAX_TEXTURE_SIZE) {
+			images[index] = TextureDecoder::decodeFile(filePath, nullptr);
+		}
+	} };
+	if (pool) {
+		pool->parallelFor(static_cast<uint32_t>(candidates.size()), decode);
+	}
+	else {
+		for (uint32_t i{ 0 }; i < candidates.size(); i++) {
+			decode(i, 0);
+		}
+	}
+
+	// Tallest first packs tightest. One texture alone saves nothing.
+	vector<size_t> order;
+	for (size_t i{ 0 }; i < images.size(); i++) {
+		if (images[i].pixels) {
+			order.push_back(i);
+		}
+	}
+	if (order.size() < 2) {
+		for (size_t index : order) {
+			stbi_image_free(images[index].pixels);
+		}
+		return;
+	}
+	std::sort(order.begin(), order.end(), [&images](size_t a, size_t b) {
+		return images[a].height > images[b].height;
+	});
+
+	TextureAtlas atlas{ ATLAS_PAGE_SIZE, ATLAS_PADDING };
+	vector<TextureAtlas::Rect> rects(images.size());
+	for (size_t index : order) {
+		rects[index] = atlas.add(images[index].pixels, static_cast<uint32_t>(images[index].width),
+			static_cast<uint32_t>(images[index].height));
+		stbi_image_free(images[index].pixels);
+	}
 
-	// Conversion from mat list ids to descriptor array ids.
-	vector<int> matToTex(textureNames.size());
+	for (size_t i{ 0 }; i < atlas.getPageCount(); i++) {
+		modelImport.atlasPages.push_back(atlas.takePage(i));
+	}
+	for (size_t index : order) {
+		modelImport.atlasPlacements[candidates[index]] = { rects[index].page, atlas.getUvTransform(rects[index]) };
+	}
+}
 
-	// Loop over texnames and create texture for them.
+MeshModel VulkanRenderer::createModel(const string &modelFile, ModelImport &modelImport) {
+	// Conversion from mat list ids to descriptor array ids, and to where their textures are. Atlased materials
+	// get theirs first.
+	const vector<string> &textureNames{ modelImport.textureNames };
+	vector<int> matToTex(textureNames.size(), -1);
+	vector<glm::vec4> matToUv(textureNames.size(), glm::vec4(0.0f, 0.0f, 1.0f, 1.0f));
+
+	// Pages go in the cache under the model's path, they're never streamed, every level is already there.
+	vector<TextureHandle> modelTextures;
+	for (size_t i{ 0 }; i < modelImport.atlasPages.size(); i++) {
+		TextureDecoder::Image &page{ modelImport.atlasPages[i] };
+		const uint64_t contentHash{ _textureCache.isContentHashing() ? hashBytes(page.pixels, static_cast<size_t>(page.size)) : 0 };
+		const TextureHandle texture{
+			addTexture(normalizeAssetPath(modelFile) + "#atlas" + std::to_string(i), "", contentHash, page)
+		};
+		page.pixels = nullptr;
+		_textureCache.acquire(texture);
+		modelTextures.push_back(texture);
+	}
+	for (size_t i{ 0 }; i < textureNames.size(); i++) {
+		const auto placement{ modelImport.atlasPlacements.find(textureNames[i]) };
+		if (placement != modelImport.atlasPlacements.end()) {
+			matToTex[i] = _textureCache.get(modelTextures[placement->second.page]).arrayElement;
+			matToUv[i] = placement->second.uvTransform;
+		}
+	}
+
+	// Textures decoded ahead go in unless the same path was loaded meanwhile.
+	for (auto &texture : modelImport.textures) {
+		if (!texture.image.pixels) {
+			continue;
+		}
+		const string path{ normalizeAssetPath(texture.fileName) };
+		if (_textureCache.contains(_textureCache.find(path))) {
+			freeTexturePixels(texture.image.pixels);
+		}
+		else {
+			addTexture(path, texture.fileName, texture.contentHash, texture.image);
+		}
+		texture.image.pixels = nullptr;
+	}
+
+	// Create textures for the rest at once, so whatever isn't cached decodes in parallel.
+	vector<string> modelTextureNames;
+	for (size_t i{ 0 }; i < textureNames.size(); i++) {
+		if (!textureNames[i].empty() && matToTex[i] < 0) {
+			modelTextureNames.push_back(textureNames[i]);
+		}
+	}
+	const vector<TextureHandle> fileTextures{ createTextures(modelTextureNames) };
+	modelTextures.insert(modelTextures.end(), fileTextures.begin(), fileTextures.end());
+
+	size_t nextTexture{ 0 };
 	for (size_t i{ 0 }; i < textureNames.size(); i++) {		
+		if (matToTex[i] >= 0) {
+			continue;
+		}
 		if (textureNames[i].empty()) {
-			matToTex[i] = 0; // use mat 0 for any blanks. 0 Will be reserved for a default tex.
+			matToTex[i] = _textureCache.get(_defaultTexture).arrayElement; // Blanks use the default tex.
 		}
 		else {
-			// Otherwise, create texture and set value to index of new tex.
-			matToTex[i] = createTexture(textureNames[i]);
+			// Otherwise, set value to its element in the texture array.
+			matToTex[i] = _textureCache.get(fileTextures[nextTexture++]).arrayElement;
 		}
 	}
 
-	// Load in all our meshes.
 	vector<Mesh> modelMeshes{
-		MeshModel::LoadNode(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _graphicsQueue, _graphicsCommandPool,
-		scene->mRootNode, scene, matToTex)
+		MeshModel::CreateMeshes(_mainDevice.physicalDevice, _mainDevice.logicalDevice, _uploadScheduler,
+		modelImport.meshes, matToTex, matToUv)
 	};
 
-	// Create meshModel and add to list.
+	// Everything it uploads was queued by now, textures from the cache before it.
 	MeshModel meshModel{ modelMeshes };
-	_models.push_back(meshModel);
+	meshModel.setTextures(modelTextures);
+	meshModel.setUploadBatch(_uploadScheduler.getLastBatch());
+	return meshModel;
+}
+
+void VulkanRenderer::freeModelImport(ModelImport &modelImport) {
+	for (auto &page : modelImport.atlasPages) {
+		if (page.pixels) {
+			freeTexturePixels(page.pixels);
+			page.pixels = nullptr;
+		}
+	}
+	for (auto &texture : modelImport.textures) {
+		if (texture.image.pixels) {
+			freeTexturePixels(texture.image.pixels);
+			texture.image.pixels = nullptr;
+		}
+	}
+}
+
+void VulkanRenderer::destroyMeshModel(const ModelHandle &model) {
+	// Throws on a stale handle.
+	const AssetHandle asset{ _models.at(model).asset };
+	_models.erase(model);
+
+	// Geometry stays while other instances use it.
+	if (_modelCache.release(asset)) {
+		releaseMeshModel(_modelCache.remove(asset));
+	}
+
+	rebuildDrawList();
+	invalidateCommands();
+}
+
+void VulkanRenderer::releaseMeshModel(MeshModel meshModel) {
+	// Drops its references, shared textures stay. Blank materials use the default texture, which isn't in the list.
+	for (const auto &texture : meshModel.getTextures()) {
+		releaseTexture(texture);
+	}
 
-	return _models.size() - 1;
+	// Frames already submitted may still draw it, cached command buffers stop doing so once re-recorded.
+	deferDestroy([meshModel]() mutable {
+		meshModel.destroyMeshModel();
+	});
+}
+
+void VulkanRenderer::rebuildDrawList() {
+	// By dense index, erasing a model moves another into its place so this runs after every add and remove.
+	_drawList.clear();
+	_drawListWaiting = false;
+	for (size_t modelIdx{ 0 }; modelIdx < _models.size(); modelIdx++) {
+		// Left out until its buffers and textures have landed.
+		MeshModel &meshModel{ _modelCache.get(_models[modelIdx].asset) };
+		if (!_uploadScheduler.isComplete(meshModel.getUploadBatch())) {
+			_drawListWaiting = true;
+			continue;
+		}
+		const size_t meshCount{ meshModel.getMeshCount() };
+		for (size_t meshIdx{ 0 }; meshIdx < meshCount; meshIdx++) {
+			_drawList.push_back({ static_cast<uint32_t>(modelIdx), static_cast<uint32_t>(meshIdx) });
+		}
+	}
 }
 
 UboViewProjection *VulkanRenderer::getViewProj() {
@@ -2009,5 +3205,66 @@ UboViewProjection *VulkanRenderer::getViewProj() {
 }
 
 void VulkanRenderer::setViewProj(const UboViewProjection *viewProj) {
+	// Lighting passes push projection parameters, only the view can change without re-recording.
+	if (viewProj->proj != _uboViewProj.proj) {
+		invalidateCommands();
+	}
 	_uboViewProj = *viewProj;
 }
+
+void VulkanRenderer::setDynamicResolution(const bool &enabled, const float &frameBudgetMs) {
+	const bool wasEnabled{ _dynamicResolutionEnabled };
+
+	// Without timestamps there's nothing to drive the scale, keep rendering natively.
+	_dynamicResolutionEnabled = enabled && _dynamicResolution.isSupported();
+	_dynamicResolution.setFrameBudget(frameBudgetMs);
+
+	// Switching path changes the passes declared, so the graph (and the pipelines built against it) is rebuilt.
+	if (_dynamicResolutionEnabled != wasEnabled) {
+		rebuildRenderGraph();
+	}
+}
+
+float VulkanRenderer::getResolutionScale() {
+	return _dynamicResolutionEnabled ? _dynamicResolution.getScale() : 1.0f;
+}
+
+void VulkanRenderer::addPostEffect(const string &name, const string &shaderFile, const PostEffectMode &mode) {
+	_postEffects.push_back({ name, shaderFile, mode });
+	rebuildRenderGraph();
+}
+
+void VulkanRenderer::clearPostEffects() {
+	_postEffects.clear();
+	rebuildRenderGraph();
+}
+
+vector<PassTiming> VulkanRenderer::getPassTimings() {
+	return _renderGraph.getTimings();
+}
+
+void VulkanRenderer::setTextureBudget(VkDeviceSize budget) {
+	_textureStreamer.setBudget(budget);
+}
+
+VkDeviceSize VulkanRenderer::getTextureMemory() {
+	return _textureStreamer.getResidentBytes();
+}
+
+void VulkanRenderer::setUploadBudget(VkDeviceSize bytesPerFrame) {
+	_uploadBudget = bytesPerFrame;
+}
+
+VkDeviceSize VulkanRenderer::getPendingUploadBytes() {
+	return _uploadScheduler.getPendingBytes();
+}
+
+TextureCache::Stats VulkanRenderer::getTextureCacheStats() {
+	return _textureCache.getStats();
+}
+
+void VulkanRenderer::setPointLights(const vector<PointLight> &lights) {
+	// Light count is pushed.
+	_tiledLighting.setLights(lights);
+	invalidateCommands();
+}
@@ -12,13 +12,34 @@
 #include <stdexcept>
 #include <vector>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 #include <array>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <deque>
 
 #include "Utilities.h"
 #include "Mesh.h"
 #include "stb_image.h"
+#include "TextureDecoder.h"
+#include "MappedFile.h"
+#include "StagingBuffer.h"
 #include "MeshModel.h"
+#include "DynamicResolution.h"
+#include "RenderGraph.h"
+#include "TiledLighting.h"
+#include "FrameAllocator.h"
+#include "ThreadPool.h"
+#include "DeletionQueue.h"
+#include "ModelCache.h"
+#include "TextureStreamer.h"
+#include "TextureAtlas.h"
+#include "UploadScheduler.h"
+#include "Ktx2.h"
+#include "ModelLoad.h"
 
 using std::vector;
 using std::set;
@@ -33,10 +54,32 @@ public:
 	VulkanRenderer();
 	~VulkanRenderer();
 	int init(GLFWwindow *newWindow);
-	void updateModel(const size_t &modelId, const glm::mat4 &model);
-	int createMeshModel(string modelFile);
+	void updateModel(const ModelHandle &model, const glm::mat4 &newModel);
+	// A file that's already loaded gets a new instance sharing its geometry and textures, the options it was first
+	// imported with stand.
+	ModelHandle createMeshModel(string modelFile, const ModelImportOptions &options = {});
+	// Same, without blocking. The file is imported and its textures decoded on the thread pool, then it's created
+	// and uploaded over the following frames, see ModelLoad.
+	ModelLoad createMeshModelAsync(string modelFile, const ModelImportOptions &options = {});
+	// The handle goes stale at once. Buffers and textures are destroyed with the asset's last instance, once frames
+	// in flight are done with them.
+	void destroyMeshModel(const ModelHandle &model);
 	UboViewProjection *getViewProj();
 	void setViewProj(const UboViewProjection *viewProj);
+	void setDynamicResolution(const bool &enabled, const float &frameBudgetMs);
+	float getResolutionScale();
+	// Post effects run in the order added. With none the scene draws straight to the swapchain.
+	void addPostEffect(const string &name, const string &shaderFile, const PostEffectMode &mode);
+	void clearPostEffects();
+	vector<PassTiming> getPassTimings();
+	TextureCache::Stats getTextureCacheStats();
+	// GPU memory textures' streamed levels can use, least recently used ones give theirs back past it.
+	void setTextureBudget(VkDeviceSize budget);
+	VkDeviceSize getTextureMemory();
+	// Bytes of queued buffer and image copies recorded each frame, at least one chunk goes every frame.
+	void setUploadBudget(VkDeviceSize bytesPerFrame);
+	VkDeviceSize getPendingUploadBytes();
+	void setPointLights(const vector<PointLight> &lights);
 
 	void draw();
 	void destroy();
@@ -48,37 +91,53 @@ private:
 	void createLogicalDevice();
 	void createSurface();
 	void createSwapChain();
-	void createRenderPass();
+	void recreateSwapChain();
+	void cleanupSwapChain();
+	void createRenderGraph();
+	void rebuildRenderGraph();
 	void createDescriptorSetLayout();
 	void createPushConstantRange();
 	void createGraphicsPipeline();
-	void createColorBufferImages();
-	void createDepthBufferImage();
-	void createFramebuffers();
+	void destroyGraphicsPipeline();
 	void createCommandPool();
 	void createCommandBuffers();
+	void freeCommandBuffers();
 	void recordCommands(const uint32_t &currentImage);
+	void recordSceneDraws(const VkCommandBuffer &commandBuffer, const uint32_t &frame, const uint32_t &imageIndex);
+	void recordSceneChunk(const VkCommandBuffer &commandBuffer, const uint32_t &frame, const uint32_t &transformOffset,
+		const size_t &firstDraw, const size_t &lastDraw);
+	VkCommandBuffer getSecondaryCommandBuffer(const uint32_t &slot, const uint32_t &worker);
+	bool isRecorded(const uint32_t &slot);
+	void invalidateCommands();
+	void recordLightCull(const VkCommandBuffer &commandBuffer, const uint32_t &frame);
+	void recordLighting(const VkCommandBuffer &commandBuffer, const uint32_t &frame);
+	void recordPostEffect(const VkCommandBuffer &commandBuffer, const size_t &effect, const uint32_t &frame);
+	void recordUpscale(const VkCommandBuffer &commandBuffer, const uint32_t &frame);
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT &createInfo);
 	void createDebugMessengerExtension();
 	void createSync();
 	void createUniformBuffers();
 	void createDescriptorPool();
+	void createUniformDescriptorPool();
 	void createDescriptorSets();
-	void createInputDescriptorSets();
 	void createTextureSampler();
-	void updateUniformBuffers(const uint32_t &imageIndex);
-	void allocateDynamicBufferTransferSpace();
+	void updateUniformBuffers(const uint32_t &frame);
+	void uploadTransforms();
+	void updateProjection();
+	// - callback functions
+	static void framebufferResizeCallback(GLFWwindow *window, int width, int height);
 	// - get functions
 	void getPhysicalDevice();
 	// - support functions
-	VkImage createImage(const uint32_t &width, const uint32_t &height, const VkFormat &format, const VkImageTiling &tiling,
+	VkImage createImage(const uint32_t &width, const uint32_t &height, const uint32_t &mipLevels, const VkFormat &format, const VkImageTiling &tiling,
 		const VkImageUsageFlags &usageFlags, const VkMemoryPropertyFlags &memPropFlags, VkDeviceMemory *imageMemory);
-	VkImageView createImageView(const VkImage &image, const VkFormat &format, const VkImageAspectFlags &aspectFlags);
+	VkImageView createImageView(const VkImage &image, const VkFormat &format, const VkImageAspectFlags &aspectFlags, const uint32_t &mipLevels);
 	VkShaderModule createShaderModule(const vector<char> &code);
 	vector<const char *> getRequiredExtensions();
 	// -- checker functions
 	bool checkInstanceExtensionSupport(const vector<const char *> *checkExtensions);
 	bool checkDeviceExtensionSupport(const VkPhysicalDevice &device);
+	bool isDeviceExtensionSupported(const VkPhysicalDevice &device, const char *extensionName);
 	bool checkDeviceSuitable(const VkPhysicalDevice &device);
 	bool checkValidationLayerSupport();
 	// -- Getter functions.
@@ -88,28 +147,76 @@ private:
 	VkSurfaceFormatKHR chooseBestSurfaceFormat(const vector<VkSurfaceFormatKHR> &formats);
 	VkPresentModeKHR chooseBestPresMode(const vector <VkPresentModeKHR> presModes);
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR &surfaceCapabilities);
+	VkExtent2D getRenderExtent();
 	VkFormat chooseSupportedFormat(const vector<VkFormat> &formats, const VkImageTiling &tiling, const VkFormatFeatureFlags &featureFlags);
 	// -- Loader functions
-	stbi_uc *loadTextureFile(const string &fileName, int *width, int *height, VkDeviceSize *imageSize);
+	// Levels bigger than maxSize on either side are left out.
+	TextureDecoder::Image loadTextureFile(const string &fileName, uint32_t maxSize);
+	void freeTexturePixels(stbi_uc *pixels);
 	
-	int createTextureImage(const string &fileName);
-	int createTexture(const string &fileName);
-	int createTextureDescriptor(VkImageView texImg);
+	VkImage createTextureImage(const TextureDecoder::Image &image, VkDeviceMemory *imageMemory, uint32_t *mipLevels);
+	// Shared with earlier loads of the same path or pixels, each call is a reference to release.
+	TextureHandle createTexture(const string &fileName);
+	// Decodes whatever isn't cached on the thread pool. One handle per name, in order.
+	vector<TextureHandle> createTextures(const vector<string> &fileNames);
+	TextureHandle addTexture(const string &path, const string &fileName, uint64_t contentHash, const TextureDecoder::Image &image);
+	Texture uploadTexture(const TextureDecoder::Image &image);
+	bool hasFreeTextureElement();
+	int allocateTextureElement();
+	void createTextureDescriptor(const int &texId, VkImageView texImg);
+	void releaseTexture(const TextureHandle &texture);
+	// Once frames in flight are done with it, array element included.
+	void destroyTexture(const Texture &texture);
+	// - Texture streaming
+	void updateTextureStreaming();
+	void streamTexture(const TextureStreamer::Request &request);
+	// Same texture with its finer levels dropped. The copy is queued on the upload scheduler, swap it in once that
+	// batch lands.
+	Texture shrinkTexture(const Texture &texture, uint32_t baseLevel);
+	void swapTexture(const TextureHandle &texture, const Texture &newTexture);
+	// Streaming and model load jobs running at once, together.
+	uint32_t getMaxBackgroundLoads();
+	// - Uploads
+	void submitUploads();
+	// Once nothing in flight or queued to upload can use what it destroys.
+	void deferDestroy(std::function<void()> destroyFunc);
+	// - Model loading
+	// Safe on any thread. Atlas candidates decode on pool when given one, worker jobs can't wait on it so pass none.
+	// Textures in loadedTextures, by normalized path, are left to the cache.
+	ModelImport importModel(const string &modelFile, const ModelImportOptions &options, const std::set<string> &loadedTextures,
+		ThreadPool *pool);
+	// Packs the small textures of materials that don't tile into atlas pages.
+	void packTextureAtlas(ModelImport &modelImport, const aiScene *scene, const std::set<string> &loadedTextures, ThreadPool *pool);
+	std::set<string> getLoadedTexturePaths();
+	// Takes the pixels it uses out of modelImport, whatever it doesn't need is left for freeModelImport.
+	MeshModel createModel(const string &modelFile, ModelImport &modelImport);
+	void freeModelImport(ModelImport &modelImport);
+	ModelHandle addModelInstance(AssetHandle asset);
+	// Thread safe. Started from draw() while there's room under getMaxBackgroundLoads.
+	void queueModelLoadJob(const std::function<void()> &job);
+	void startModelLoadJobs();
+	void finishModelLoadJob(const std::shared_ptr<ModelLoadState> &state);
+	// Creates what the workers imported, and finishes loads whose uploads landed.
+	void updateModelLoads();
+	void releaseMeshModel(MeshModel meshModel);
+	void rebuildDrawList();
 
 	// VARS
 	int _currentFrame{ 0 };
 	GLFWwindow *_window;
+	bool _framebufferResized{ false }; // Set by glfw when the window framebuffer changes size.
 
 	// vulkan components
 	VkInstance _instance;
 	VkQueue _graphicsQueue;
 	VkQueue _presentationQueue;
+	VkQueue _computeQueue{ VK_NULL_HANDLE }; // Only with a separate compute family.
 	struct {
 		VkPhysicalDevice physicalDevice;
 		VkDevice logicalDevice;
 	} _mainDevice;
 	VkSurfaceKHR _surface;
-	VkSwapchainKHR _swapchain;
+	VkSwapchainKHR _swapchain{ VK_NULL_HANDLE };
 
 	// UTILITY
 	VkFormat _swapchainImageFormat;
@@ -117,77 +224,148 @@ private:
 	VkDebugUtilsMessengerEXT _debugMessenger;
 	
 
+	// RENDER GRAPH
+	// Owns the render passes, framebuffers and color/depth attachments, built from the passes declared in createRenderGraph.
+	RenderGraph _renderGraph;
+	int _lightCullPass{ -1 };
+	int _scenePass{ -1 }; // Writes the G-buffer.
+	int _lightingPass{ -1 }; // Input attachment subpass shading the G-buffer.
+	vector<int> _postPasses; // One per post effect.
+	int _finalPass{ -1 }; // Upscale/copy to the swapchain, only when the scene or last effect can't write it directly.
+
+	vector<PostEffect> _postEffects;
+
 	// PIPELINE
-	VkRenderPass _renderPass;
 	VkPipelineLayout _pipelineLayout;
 	VkPipeline _graphicsPipeline;
 
-	VkPipeline _secondPipeline;
-	VkPipelineLayout _secondPipelineLayout;
+	vector<VkPipeline> _postPipelines;
+	vector<VkPipelineLayout> _postPipelineLayouts;
+
+	VkPipeline _upscalePipeline{ VK_NULL_HANDLE };
+	VkPipelineLayout _upscalePipelineLayout{ VK_NULL_HANDLE };
+
+	// Deferred lighting: tiled light culling in compute, then shading in the G-buffer's render pass.
+	TiledLighting _tiledLighting;
+	VkPipeline _lightCullPipeline;
+	VkPipelineLayout _lightCullPipelineLayout;
+	VkPipeline _lightingPipeline;
+	VkPipelineLayout _lightingPipelineLayout;
+
+	// Dynamic resolution: scene renders into part of the color/depth images, then gets sampled up to the swapchain.
+	DynamicResolution _dynamicResolution;
+	bool _dynamicResolutionEnabled{ false };
+
+	// Per frame uploads (model matrices for now), bound at set 2 of the scene pipeline with dynamic offsets.
+	FrameAllocator _frameAllocator;
 
 	// POOLS
 	VkCommandPool _graphicsCommandPool;
+	VkCommandPool _computeCommandPool{ VK_NULL_HANDLE };
+
+	// Scene draws are recorded in chunks on the worker threads, into secondary buffers from the worker's own pool.
+	// Pools are reset whole when their slot is re-recorded, the buffers in them are kept and reused.
+	std::unique_ptr<ThreadPool> _threadPool;
+	std::unique_ptr<StagingBuffer> _textureStaging; // Textures decode into it, see loadTextureFile.
+	vector<VkCommandPool> _secondaryPools; // [slot * thread count + worker].
+	vector<vector<VkCommandBuffer>> _secondaryBuffers; // Per pool.
+	vector<uint32_t> _secondaryUsed; // Per pool, taken so far this frame.
 
 	// DESCRIPTORS
 	VkDescriptorSetLayout _descSetLayout;
 	VkDescriptorSetLayout _samplerSetLayout;
-	VkDescriptorSetLayout _inputSetLayout;
-	VkDescriptorPool _descPool;
+	VkDescriptorPool _descPool{ VK_NULL_HANDLE };
 	VkDescriptorPool _samplerDescPool;
-	VkDescriptorPool _inputDescPool;
-
-	//VkDeviceSize _minUniBufOffset;
-	//size_t _modelUniAlignment;
-	//UboModel *_modelTransferSpace;
 
 	VkPushConstantRange _pushConstRange;
 	VkFormat _colorBufFormat;
+	VkFormat _normalBufFormat; // Octahedral encoded, two channels.
 	VkFormat _depthBufFormat;
 
 
 	VkSampler _textureSampler;
+	VkSampler _upscaleSampler;
 	
 	UboViewProjection _uboViewProj;
 
 	const size_t _uboViewProjSize = sizeof(UboViewProjection);
 
-	vector<VkImage> _colorBufImages;
-	vector<VkDeviceMemory> _colorBufImageMems;
-	vector<VkImageView> _colorBufImageViews;
-
-	vector<VkImage> _depthBufImages;
-	vector<VkDeviceMemory> _depthBufImageMems;
-	vector<VkImageView> _depthBufImageViews;
-
 	// variable length vars.
 	// Scene Objects
 	//vector<Mesh> _meshes;
 
-	// - Need one for each command buffer
+	// - One per frame in flight, mapped for as long as they live.
 	vector<VkBuffer> _vpUniformBuffers;
 	vector<VkDeviceMemory> _vpUniformBufMems;
+	vector<void *> _vpUniformMapped;
 	
-	//vector<VkBuffer> _modelDynUniformBuffers;
-	//vector<VkDeviceMemory> _modelDynUniformBufMems;
-	
-	vector<VkDescriptorSet> _descSets;
-	vector<VkDescriptorSet> _samplerDescSets;
-	vector<VkDescriptorSet> _inputDescSets;
+	vector<VkDescriptorSet> _descSets; // Per frame in flight.
+	VkDescriptorSet _textureDescSet{ VK_NULL_HANDLE }; // Every texture, indexed by push constant.
+
+	// View projection set is pushed while recording when VK_KHR_push_descriptor is there, otherwise it's
+	// one set per frame in flight written through the template.
+	bool _pushDescriptors{ false };
+	PFN_vkCmdPushDescriptorSetKHR _cmdPushDescriptorSet{ nullptr };
+	VkDescriptorUpdateTemplate _vpUpdateTemplate{ VK_NULL_HANDLE };
+	uint32_t _maxTextures{ 0 };
+	std::set<VkFormat> _compressedFormats; // Supported BC formats, empty without textureCompressionBC.
 
 	// - Assets
-	vector<VkImage> _textureImages;
-	vector<VkDeviceMemory> _textureImageMems;
-	vector<VkImageView> _textureImageViews;
-	vector<MeshModel> _models;
+	TextureCache _textureCache;
+	TextureHandle _defaultTexture;
+	uint32_t _textureElementCount{ 0 }; // Texture array elements handed out so far.
+	vector<int> _freeTextureElements; // Released elements nothing in flight uses any more.
+	vector<TextureHandle> _elementTextures; // Texture at each array element, for the meshes drawing with it.
+	TextureStreamer _textureStreamer;
+	uint32_t _streamingLoads{ 0 }; // Started on the workers and not yet taken back.
+	uint64_t _frameNumber{ 0 }; // Frames drawn, for how recently textures were used.
+	// Streamed in or shrunk textures waiting for their copies to land before they're swapped in.
+	struct PendingSwap {
+		uint64_t uploadBatch;
+		TextureHandle texture;
+		Texture newTexture;
+	};
+	vector<PendingSwap> _pendingSwaps;
+	ModelCache _modelCache;
+	SlotMap<ModelInstance> _models; // Draws and the transform array go by dense index.
+	vector<std::shared_ptr<ModelLoadState>> _modelLoads; // Not finished yet.
+	std::mutex _modelLoadMutex;
+	vector<std::shared_ptr<ModelLoadState>> _importedModels; // Handed back by the workers, guarded by _modelLoadMutex.
+	std::deque<std::function<void()>> _queuedLoadJobs; // Waiting for room, guarded by _modelLoadMutex.
+	std::atomic<uint32_t> _runningLoadJobs{ 0 };
+
+	// Every mesh of every instance, in draw order. Split into chunks for recording. Rebuilt when models come and go.
+	struct DrawItem {
+		uint32_t model;
+		uint32_t mesh;
+	};
+	vector<DrawItem> _drawList;
+	bool _drawListWaiting{ false }; // Some models were left out until their uploads land.
+
+	// Uploads are recorded into this frame's buffer and submitted ahead of it.
+	UploadScheduler _uploadScheduler;
+	VkDeviceSize _uploadBudget{ UPLOAD_FRAME_BUDGET };
+	vector<VkCommandBuffer> _uploadCommandBuffers; // Per frame in flight.
 
 	// SYNC
 	vector<VkSemaphore> _imageAvailable;
 	vector<VkSemaphore> _renderFinished;
-	vector<VkFence> _drawFences;
+	TimelineScheduler _scheduler;
+	DeletionQueue _deletionQueue; // Collected each frame.
+	vector<TimelineScheduler::Point> _framePoints; // Last submit of each frame in flight, waited on before reusing it.
 
 	vector<SwapchainImage> _swapchainImages;
-	vector<VkFramebuffer> _swapchainFramebuffers;
+	// A slot per frame in flight and swapchain image, [frame * image count + image]. One buffer per graph segment
+	// for each, [segment * slot count + slot], kept while what was recorded into them still holds.
+	uint32_t _commandSlotCount{ 0 };
 	vector<VkCommandBuffer> _commandBuffers;
+	struct RecordedCommands {
+		bool valid{ false };
+		VkExtent2D renderExtent{}; // Scaled with dynamic resolution.
+		uint32_t transformOffset{ 0 };
+	};
+	vector<RecordedCommands> _recordedCommands; // Per slot.
+	uint32_t _transformOffset{ 0 }; // This frame's model matrices in the frame allocator.
 
 	const vector<const char *> _validationLayers {
 		"VK_LAYER_KHRONOS_validation",
@@ -1,5 +1,3 @@
-#define STB_IMAGE_IMPLEMENTATION
-
 #define GLFW_INCLUDE_VULKAN
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
@@ -30,7 +28,8 @@ void initWindow(string wName = "Test Window", const int width = 800, const int h
 	}
 	// set glfw to not work with opengl
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	// Renderer rebuilds its swapchain when the framebuffer changes size.
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 	window = glfwCreateWindow(width, height, wName.c_str(), nullptr, nullptr);
 }
 
@@ -47,17 +46,48 @@ int main() {
 		return EXIT_FAILURE;
 	}
 
+	// Drop scene resolution rather than frames when the GPU can't keep up.
+	vulkanRenderer->setDynamicResolution(true, FPS);
+
+	// Depth view on the right half of the screen.
+	vulkanRenderer->addPostEffect("depthSplit", "Shaders/second_frag.spv", PostEffectMode::Fragment);
+
+	// Grid of small coloured lights under the model, plus a big white one from the camera side.
+	vector<PointLight> lights;
+	for (int z = 0; z < 32; z++) {
+		for (int x = 0; x < 32; x++) {
+			PointLight light{};
+			light.position = { -30.0f + x * (60.0f / 31.0f), -5.0f, -40.0f + z * (60.0f / 31.0f) };
+			light.radius = 8.0f;
+			light.color = { (x % 3) * 0.5f, ((x + z) % 3) * 0.5f, (z % 3) * 0.5f };
+			light.intensity = 1.0f;
+			lights.push_back(light);
+		}
+	}
+	PointLight keyLight{};
+	keyLight.position = { 10.0f, 0.0f, 20.0f };
+	keyLight.radius = 100.0f;
+	keyLight.color = { 1.0f, 1.0f, 1.0f };
+	keyLight.intensity = 1.0f;
+	lights.push_back(keyLight);
+	vulkanRenderer->setPointLights(lights);
+
 	float angle{ 0.0f };
 	float deltaTime{ 0.0f };
 	float lastTime{ 0.0f };
+#ifdef PRINT_FRAME_STATS
+	float timingPrintTime{ 0.0f };
+#endif
 
-	int man{ vulkanRenderer->createMeshModel("Models/FinalBaseMesh.obj") };
+	ModelHandle man{ vulkanRenderer->createMeshModel("Models/FinalBaseMesh.obj") };
 	
-	//int ironMan{ vulkanRenderer->createMeshModel("Models/IronMan.obj") };
+	//ModelHandle ironMan{ vulkanRenderer->createMeshModel("Models/IronMan.obj") };
+	// Or without holding up the loop, drawn once it's in. Poll isDone, or co_await it from a coroutine.
+	//ModelLoad ironManLoad{ vulkanRenderer->createMeshModelAsync("Models/IronMan.obj") };
 
 	//vulkanRenderer->createMeshModel("Models/chopper.obj");
-	//int audi{ vulkanRenderer->createMeshModel("Models/Audi_R8_2017.obj") };
-		
+	//ModelHandle audi{ vulkanRenderer->createMeshModel("Models/Audi_R8_2017.obj") };
+
 	// game loop
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
@@ -123,6 +153,18 @@ int main() {
 
 		vulkanRenderer->draw();
 
+#ifdef PRINT_FRAME_STATS
+		// What each pass costs on the GPU, about once a second.
+		timingPrintTime += deltaTime;
+		if (timingPrintTime > 1.0f) {
+			timingPrintTime = 0.0f;
+			for (const auto &timing : vulkanRenderer->getPassTimings()) {
+				printf("%s %.3fms ", timing.name.c_str(), timing.gpuTimeMs);
+			}
+			printf("textures %.1fMB uploads %.1fMB\n", vulkanRenderer->getTextureMemory() / (1024.0 * 1024.0),
+				vulkanRenderer->getPendingUploadBytes() / (1024.0 * 1024.0));
+		}
+#endif
 	}
 
 	vulkanRenderer->destroy();